@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <V2P/metrics/MetricsRegistry.h>
+#include <V2P/metrics/Tracer.h>
+#include <V2P/utils/JsonEscape.h>
+#include <V2P/writer/ThumbnailExtractor.h>
+
+#include "Headless/HeadlessPlayer.h"
+
+namespace {
+    std::atomic<bool> stopRequested = false;
+    std::atomic<ThumbnailExtractor*> thumbnailExtractor = nullptr;
+
+    void onSignal(int) {
+        stopRequested = true;
+        if (ThumbnailExtractor* extractor = thumbnailExtractor.load()) {
+            extractor->abort();
+        }
+    }
+
+    void printUsage() {
+        std::cerr << "Usage: V2P_Headless [options] <url>...\n"
+                  << "  --fast                 Take frames as soon as they are decoded (default: real time)\n"
+                  << "  --duration <s>         Stop after this many seconds (default: when every stream ends)\n"
+                  << "  --repeat <n>           Open every URL n times\n"
+                  << "  --workers <n>          Decode worker threads (default: one per core)\n"
+                  << "  --decoder-threads <n>  Decoder thread budget (default: one per core)\n"
+                  << "  --fast-start           Open asynchronously, probe less, show the first frame at once\n"
+                  << "  --record <file>        Stream-copy every stream to <file> with its index added\n"
+                  << "  --record-split <s>     With --record, start a new file every <s> seconds\n"
+                  << "  --report <s>           Seconds between progress lines on stderr, 0 for none (default: 5)\n"
+                  << "  --prometheus <file>    Also write the final metrics in Prometheus text format\n"
+                  << "  --trace <file>         Record a Chrome trace-event timeline, written at exit\n"
+                  << "  --trace-stall <ms>     With --trace, also write it whenever a vsync tick is this late\n"
+                  << "  --thumbnails <dir>     Write keyframe sprite sheets of every URL to <dir> instead of playing\n"
+                  << "  --thumb-width <px>     Thumbnail width (default: 160)\n"
+                  << "  --thumb-interval <s>   Seconds between thumbnails (default: 10)\n"
+                  << "  --thumb-single         One JPEG per thumbnail instead of sprite sheets"
+                  << std::endl;
+    }
+
+    void writeThumbnailReport(std::ostream& out, const ThumbnailStats& stats) {
+        out << "{\"mode\":\"thumbnails\""
+            << ",\"inputs\":" << stats.inputs
+            << ",\"failed\":" << stats.failed
+            << ",\"seconds\":" << stats.seconds
+            << ",\"thumbnails\":" << stats.thumbnails
+            << ",\"thumbnails_per_second\":" << stats.thumbnailsPerSecond
+            << ",\"files\":" << stats.files
+            << ",\"keyframes_decoded\":" << stats.keyframesDecoded
+            << ",\"packets_skipped\":" << stats.packetsSkipped
+            << ",\"per_input\":[";
+        for (size_t i = 0; i < stats.results.size(); ++i) {
+            const ThumbnailResult& result = stats.results[i];
+            out << (i ? "," : "")
+                << "{\"url\":\"" << escapeJson(result.input) << "\""
+                << ",\"ok\":" << (result.ok ? "true" : "false")
+                << ",\"thumbnails\":" << result.thumbnails
+                << ",\"files\":" << result.files
+                << ",\"keyframes_decoded\":" << result.keyframesDecoded
+                << ",\"packets_skipped\":" << result.packetsSkipped
+                << ",\"seconds\":" << result.seconds << "}";
+        }
+        out << "]}" << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    HeadlessOptions options;
+    std::string prometheusPath;
+    std::string tracePath;
+    double traceStallMs = 0.0;
+    ThumbnailConfig thumbnails;
+    bool extractThumbnails = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (arg == "--fast") {
+            options.realtime = false;
+        } else if (arg == "--fast-start") {
+            options.fastStart = true;
+        } else if (arg == "--record" && hasValue) {
+            options.recordPath = argv[++i];
+        } else if (arg == "--record-split" && hasValue) {
+            options.recordSplitSeconds = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--duration" && hasValue) {
+            options.duration = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--repeat" && hasValue) {
+            options.repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--workers" && hasValue) {
+            options.decodeWorkers = std::atoi(argv[++i]);
+        } else if (arg == "--decoder-threads" && hasValue) {
+            options.decoderThreads = std::atoi(argv[++i]);
+        } else if (arg == "--report" && hasValue) {
+            options.reportInterval = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--prometheus" && hasValue) {
+            prometheusPath = argv[++i];
+        } else if (arg == "--trace" && hasValue) {
+            tracePath = argv[++i];
+        } else if (arg == "--trace-stall" && hasValue) {
+            traceStallMs = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--thumbnails" && hasValue) {
+            extractThumbnails = true;
+            thumbnails.outputDirectory = argv[++i];
+        } else if (arg == "--thumb-width" && hasValue) {
+            thumbnails.width = std::max(2, std::atoi(argv[++i]));
+        } else if (arg == "--thumb-interval" && hasValue) {
+            thumbnails.intervalSeconds = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--thumb-single") {
+            thumbnails.layout = ThumbnailLayout::SINGLE;
+        } else if (arg.rfind("--", 0) == 0) {
+            printUsage();
+            return 1;
+        } else {
+            options.urls.push_back(arg);
+        }
+    }
+
+    if (options.urls.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    // The report goes to stdout; the engine's own logging is moved to stderr
+    std::ostream report(std::cout.rdbuf());
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    if (!tracePath.empty()) {
+        Tracer::setThreadName("main");
+        Tracer::global().setStallThreshold(traceStallMs / 1000.0);
+        Tracer::global().start(tracePath);
+    }
+
+    if (extractThumbnails) {
+        thumbnails.threads = options.decodeWorkers;
+        ThumbnailExtractor extractor(thumbnails);
+        thumbnailExtractor = &extractor;
+        ThumbnailStats stats = extractor.run(options.urls);
+        thumbnailExtractor = nullptr;
+        writeThumbnailReport(report, stats);
+
+        if (Tracer::enabled()) {
+            Tracer::global().stop();
+            Tracer::global().dump();
+        }
+        return stats.failed < stats.inputs ? 0 : 1;
+    }
+
+    HeadlessPlayer player(std::move(options));
+    if (!player.open()) {
+        std::cerr << "No stream could be opened." << std::endl;
+        player.writeReport(report);
+        return 1;
+    }
+
+    player.run(stopRequested);
+    player.writeReport(report);
+
+    if (Tracer::enabled()) {
+        Tracer::global().stop();
+        if (!Tracer::global().dump()) {
+            return 1;
+        }
+    }
+
+    if (!prometheusPath.empty()) {
+        std::ofstream prometheus(prometheusPath);
+        prometheus << MetricsRegistry::global().snapshot().toPrometheus();
+        if (!prometheus) {
+            std::cerr << "Could not write " << prometheusPath << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
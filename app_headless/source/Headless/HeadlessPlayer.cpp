@@ -0,0 +1,273 @@
+#include "HeadlessPlayer.h"
+
+#include <chrono>
+#include <iostream>
+
+#include <V2P/managers/PresentationScheduler.h>
+#include <V2P/metrics/MetricsRegistry.h>
+#include <V2P/metrics/Tracer.h>
+#include <V2P/utils/JsonEscape.h>
+
+namespace {
+    constexpr double VSYNC_INTERVAL = 1.0 / 60.0;
+
+    // What IStreamStrategy::readAudio() produces: 44.1 kHz, 16-bit, stereo
+    constexpr int AUDIO_BYTES_PER_SECOND = 44100 * 2 * 2;
+    constexpr int AUDIO_BYTES_PER_SAMPLE = 4;
+    constexpr double AUDIO_PERIOD = 0.010;
+}
+
+HeadlessPlayer::HeadlessPlayer(HeadlessOptions options)
+    : m_options(std::move(options)) {}
+
+HeadlessPlayer::~HeadlessPlayer() {
+    m_audioRunning = false;
+    if (m_audioThread.joinable()) {
+        m_audioThread.join();
+    }
+}
+
+bool HeadlessPlayer::open() {
+    m_manager = std::make_unique<VideoStreamManager>(m_options.decoderThreads, m_options.decodeWorkers);
+
+    // Every stream decodes the decoder's own format; a null sink has no use for RGBA
+    StreamOptions streamOptions;
+    streamOptions.acceptedFormats = { PixelFormat::IYUV, PixelFormat::NV12, PixelFormat::RGBA };
+
+    // Drained as fast as possible, every stream looks decode-bound to the ABR
+    streamOptions.prefetch.adaptive = m_options.realtime;
+
+    // Streams then open side by side, each on its own thread
+    streamOptions.startup.fastStart = m_options.fastStart;
+    streamOptions.startup.asyncOpen = m_options.fastStart;
+
+    int opened = 0;
+    for (int round = 0; round < m_options.repeat; ++round) {
+        for (const std::string& url : m_options.urls) {
+            VideoStreamer* streamer = m_manager->addStream(url, streamOptions);
+            if (!streamer) {
+                std::cerr << "Unsupported input: " << url << std::endl;
+                ++m_failedStreams;
+                continue;
+            }
+
+            // A stream that failed to open stays in the manager, already ended.
+            // One still opening asynchronously ends later if it fails.
+            m_streamUrls.push_back(url);
+            if (streamer->hasEnded()) {
+                std::cerr << "Failed to open " << url << std::endl;
+                ++m_failedStreams;
+                continue;
+            }
+
+            if (m_options.realtime) {
+                // The sink takes audio in periods of this length
+                streamer->setAudioOutputLatency(AUDIO_PERIOD);
+            }
+            if (!m_options.recordPath.empty()) {
+                RecorderConfig record;
+                record.path = recordPath(m_streamUrls.size() - 1);
+                record.maxSeconds = m_options.recordSplitSeconds;
+                if (!streamer->startRecording(record)) {
+                    std::cerr << "Could not record " << url << std::endl;
+                }
+            }
+            ++opened;
+        }
+    }
+    m_framesConsumed.assign(m_manager->getStreamCount(), 0);
+
+    return opened > 0;
+}
+
+std::string HeadlessPlayer::recordPath(size_t index) const {
+    const std::string& path = m_options.recordPath;
+    size_t slash = path.find_last_of("/\\");
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        dot = path.size();
+    }
+    return path.substr(0, dot) + "_" + std::to_string(index) + path.substr(dot);
+}
+
+void HeadlessPlayer::run(const std::atomic<bool>& stop) {
+    if (!m_manager)
+        return;
+
+    if (m_options.realtime) {
+        m_audioRunning = true;
+        m_audioThread = std::thread(&HeadlessPlayer::audioSinkLoop, this);
+    }
+
+    const double start = PresentationScheduler::monotonicNow();
+    m_cpuStart = std::clock();
+    double nextReport = start + m_options.reportInterval;
+    double nextVsync = start + VSYNC_INTERVAL;
+    double lastTick = start;
+
+    while (!stop && !allEnded()) {
+        double now = PresentationScheduler::monotonicNow();
+        if (m_options.duration > 0.0 && now - start >= m_options.duration)
+            break;
+
+        if (m_options.realtime) {
+            // A tick that comes late would be a visible stutter on a display
+            Tracer::global().reportStall("tick stall", now - lastTick);
+            lastTick = now;
+            stepRealtime(now, nextVsync);
+
+            // The null display "presents" at the vsync; catch up if we fell behind
+            std::this_thread::sleep_for(std::chrono::duration<double>(nextVsync - now));
+            nextVsync += VSYNC_INTERVAL;
+            if (nextVsync < PresentationScheduler::monotonicNow())
+                nextVsync = PresentationScheduler::monotonicNow() + VSYNC_INTERVAL;
+        } else if (!stepFast()) {
+            // Every queue is empty; the decoders are the bottleneck
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        if (m_options.reportInterval > 0.0 && now >= nextReport) {
+            printProgress(now - start);
+            nextReport += m_options.reportInterval;
+        }
+    }
+
+    m_elapsed = PresentationScheduler::monotonicNow() - start;
+    m_cpuSeconds = static_cast<double>(std::clock() - m_cpuStart) / CLOCKS_PER_SEC;
+
+    m_audioRunning = false;
+    if (m_audioThread.joinable()) {
+        m_audioThread.join();
+    }
+}
+
+void HeadlessPlayer::stepRealtime(double now, double nextVsync) {
+    // Frames the scheduler picks are dropped at its next tick, like on a real display
+    m_manager->updateAll(now, nextVsync);
+
+    if (Tracer::enabled()) {
+        TraceScope trace("null present");
+        for (size_t i = 0; i < m_manager->getStreamCount(); ++i) {
+            bool changed = false;
+            const VideoFrame* frame = m_manager->getFrame(i, &changed);
+            if (frame && changed) {
+                Tracer::flow(TraceFlow::END, frame->traceId);
+            }
+        }
+    }
+}
+
+bool HeadlessPlayer::stepFast() {
+    bool gotFrame = false;
+    VideoFrame frame;
+    for (size_t i = 0; i < m_manager->getStreamCount(); ++i) {
+        VideoStreamer* streamer = m_manager->getStream(i);
+        while (streamer->getNextVideoFrame(frame)) {
+            TraceScope trace("consume");
+            trace.flow(TraceFlow::END, frame.traceId);
+            frame.reset();
+            ++m_framesConsumed[i];
+            gotFrame = true;
+        }
+    }
+    return gotFrame;
+}
+
+bool HeadlessPlayer::allEnded() const {
+    for (size_t i = 0; i < m_manager->getStreamCount(); ++i) {
+        VideoStreamer* streamer = m_manager->getStream(i);
+        if (!streamer->hasEnded() || streamer->getQueueDepths().videoFrames > 0)
+            return false;
+    }
+    return true;
+}
+
+uint64_t HeadlessPlayer::totalFramesDecoded() const {
+    uint64_t frames = 0;
+    for (const DecodeStats& stats : m_manager->getDecodeStats()) {
+        frames += stats.framesDecoded;
+    }
+    return frames;
+}
+
+void HeadlessPlayer::printProgress(double elapsed) const {
+    double cpu = static_cast<double>(std::clock() - m_cpuStart) / CLOCKS_PER_SEC;
+    uint64_t frames = totalFramesDecoded();
+    std::cerr << "[" << elapsed << " s] streams=" << m_manager->getStreamCount()
+              << " frames=" << frames
+              << " fps=" << (elapsed > 0.0 ? static_cast<double>(frames) / elapsed : 0.0)
+              << " cpu=" << (elapsed > 0.0 ? cpu / elapsed * 100.0 : 0.0) << "%" << std::endl;
+}
+
+void HeadlessPlayer::audioSinkLoop() {
+    std::vector<uint8_t> buffer;
+    double last = PresentationScheduler::monotonicNow();
+    double owed = 0.0; // Bytes due but not pulled yet
+
+    while (m_audioRunning) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(AUDIO_PERIOD));
+
+        double now = PresentationScheduler::monotonicNow();
+        owed += (now - last) * AUDIO_BYTES_PER_SECOND;
+        last = now;
+
+        // Whole sample frames only, as a device would
+        int bytes = static_cast<int>(owed) / AUDIO_BYTES_PER_SAMPLE * AUDIO_BYTES_PER_SAMPLE;
+        if (bytes <= 0)
+            continue;
+        owed -= bytes;
+
+        buffer.resize(bytes);
+        for (size_t i = 0; i < m_manager->getStreamCount(); ++i) {
+            m_manager->getStream(i)->readAudio(buffer.data(), bytes);
+        }
+    }
+}
+
+void HeadlessPlayer::writeReport(std::ostream& out) const {
+    if (!m_manager) {
+        out << "{}" << std::endl;
+        return;
+    }
+
+    uint64_t frames = totalFramesDecoded();
+    DecodePoolStats pool = m_manager->getDecodePoolStats();
+    std::vector<DecodeStats> decodeStats = m_manager->getDecodeStats();
+
+    out << "{\"mode\":\"" << (m_options.realtime ? "realtime" : "fast") << "\""
+        << ",\"streams\":" << m_manager->getStreamCount()
+        << ",\"failed\":" << m_failedStreams
+        << ",\"seconds\":" << m_elapsed
+        << ",\"cpu_seconds\":" << m_cpuSeconds
+        << ",\"frames\":" << frames
+        << ",\"fps\":" << (m_elapsed > 0.0 ? static_cast<double>(frames) / m_elapsed : 0.0)
+        << ",\"cpu_ms_per_frame\":" << (frames ? m_cpuSeconds * 1000.0 / static_cast<double>(frames) : 0.0)
+        << ",\"pool\":{\"workers\":" << pool.workers
+        << ",\"steps\":" << pool.steps
+        << ",\"steals\":" << pool.steals
+        << ",\"idle_waits\":" << pool.idleWaits << "}"
+        << ",\"per_stream\":[";
+
+    for (size_t i = 0; i < m_manager->getStreamCount(); ++i) {
+        const DecodeStats& decode = decodeStats[i];
+        PresentationStats presentation = m_manager->getPresentationStats(i);
+        out << (i ? "," : "")
+            << "{\"url\":\"" << escapeJson(m_streamUrls[i]) << "\""
+            << ",\"ended\":" << (m_manager->getStream(i)->hasEnded() ? "true" : "false")
+            << ",\"decoded\":" << decode.framesDecoded
+            << ",\"avg_decode_ms\":" << decode.averageDecodeMs()
+            << ",\"consumed\":" << m_framesConsumed[i]
+            << ",\"presented\":" << presentation.presented
+            << ",\"late\":" << presentation.late
+            << ",\"dropped\":" << presentation.dropped
+            << ",\"repeated\":" << presentation.repeated;
+        if (!m_options.recordPath.empty()) {
+            RecorderStats record = m_manager->getStream(i)->getRecorderStats();
+            out << ",\"recorded_bytes\":" << record.bytesWritten
+                << ",\"recorded_files\":" << record.filesWritten
+                << ",\"record_drops\":" << record.packetsDropped;
+        }
+        out << "}";
+    }
+    out << "],\"metrics\":" << MetricsRegistry::global().snapshot().toJson() << "}" << std::endl;
+}
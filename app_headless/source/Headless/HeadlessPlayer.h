@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <V2P/managers/VideoStreamManager.h>
+
+/**
+ * @brief Settings of a headless run.
+ */
+struct HeadlessOptions {
+    std::vector<std::string> urls;
+    int repeat = 1;              // Opens every URL this many times
+
+    // Real-time: frames are presented against a virtual 60 Hz vsync and audio
+    // is pulled at the device rate. Otherwise frames are taken as soon as
+    // they are decoded and audio is left to the engine, which drops it.
+    bool realtime = true;
+
+    double duration = 0.0;       // Seconds; 0 runs until every stream has ended
+    double reportInterval = 5.0; // Seconds between progress lines on stderr; 0 disables them
+
+    int decodeWorkers = 0;       // See VideoStreamManager
+    int decoderThreads = 0;
+
+    bool fastStart = false;      // StartupConfig::fastStart, with asynchronous opens
+
+    // Stream-copies every stream while it plays; stream 3 of "rec.ts" goes
+    // to "rec_3.ts". Empty records nothing.
+    std::string recordPath;
+    double recordSplitSeconds = 0.0; // See RecorderConfig::maxSeconds
+};
+
+/**
+ * @brief Plays streams through the engine with null video and audio sinks.
+ *
+ * Nothing is rendered or heard; frames are dropped the moment a display
+ * would have shown them. What remains is the engine's own cost, which makes
+ * this the driver for soak tests and throughput runs on render-less machines.
+ */
+class HeadlessPlayer {
+public:
+    explicit HeadlessPlayer(HeadlessOptions options);
+    ~HeadlessPlayer();
+
+    /**
+     * @brief Opens every input. Inputs that fail are reported and skipped.
+     * @return True if at least one stream opened.
+     */
+    bool open();
+
+    /**
+     * @brief Plays until the duration is over, every stream has ended, or `stop` is set.
+     */
+    void run(const std::atomic<bool>& stop);
+
+    /**
+     * @brief Writes the totals, per-stream counters and stage latency
+     * histograms (see MetricsRegistry) as a JSON object.
+     */
+    void writeReport(std::ostream& out) const;
+
+private:
+    void stepRealtime(double now, double nextVsync);
+    bool stepFast();
+    bool allEnded() const;
+    uint64_t totalFramesDecoded() const;
+    void printProgress(double elapsed) const;
+    std::string recordPath(size_t index) const;
+
+    // Null audio sink: pulls every stream's audio at the device rate
+    void audioSinkLoop();
+
+    HeadlessOptions m_options;
+    std::unique_ptr<VideoStreamManager> m_manager;
+    std::vector<std::string> m_streamUrls;    // Per stream index
+    std::vector<uint64_t> m_framesConsumed;   // Per stream index, fast mode
+    int m_failedStreams = 0;
+
+    std::thread m_audioThread;
+    std::atomic<bool> m_audioRunning = false;
+
+    double m_elapsed = 0.0;
+    std::clock_t m_cpuStart = 0;
+    double m_cpuSeconds = 0.0;
+};
@@ -1,7 +1,35 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <V2P/metrics/Tracer.h>
+
 #include "SDL/SDLWindow.h"
 
-int main()
+int main(int argc, char** argv)
 {
+    // --trace <file> records a timeline; F12 writes it, and so does any
+    // present gap of at least --trace-stall milliseconds.
+    std::string tracePath;
+    double traceStallMs = 0.0;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--trace-stall" && i + 1 < argc) {
+            traceStallMs = std::strtod(argv[++i], nullptr);
+        } else {
+            std::cerr << "Usage: V2P [--trace <file>] [--trace-stall <ms>]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!tracePath.empty()) {
+        Tracer::global().setStallThreshold(traceStallMs / 1000.0);
+        Tracer::global().start(tracePath);
+    }
+
+    Tracer::setThreadName("ui");
     SDLWindow window("V2P", 680, 480);
     window.run();
 }
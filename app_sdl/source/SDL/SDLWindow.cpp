@@ -1,10 +1,13 @@
 #include "SDLWindow.h"
 
 #include <SDL_audio.h>
+#include <cmath>
 #include <iostream>
 #include <V2P/stream/VideoStreamFactory.h>
 #include <V2P/stream/VideoFrame.h>
 #include <V2P/stream/IStreamStrategy.h>
+#include <V2P/metrics/StreamMetrics.h>
+#include <V2P/metrics/Tracer.h>
 
 SDLWindow::SDLWindow(const std::string& title, int minWidth, int minHeight) {
     if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
@@ -24,6 +27,13 @@ SDLWindow::SDLWindow(const std::string& title, int minWidth, int minHeight) {
 
     SDL_SetWindowMinimumSize(m_Window, minWidth, minHeight);
 
+    SDL_DisplayMode displayMode;
+    if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(m_Window), &displayMode) == 0 &&
+        displayMode.refresh_rate > 0) {
+        m_vsyncInterval = 1.0 / displayMode.refresh_rate;
+    }
+    m_lastPresentTime = PresentationScheduler::monotonicNow();
+
     m_Renderer = SDL_CreateRenderer(m_Window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
 
     if (!m_Renderer) {
@@ -41,7 +51,8 @@ SDLWindow::SDLWindow(const std::string& title, int minWidth, int minHeight) {
     desiredSpec.format = AUDIO_S16SYS; // This is AV_SAMPLE_FMT_S16
     desiredSpec.channels = 2;          // This is AV_CH_LAYOUT_STEREO
     desiredSpec.samples = 4096;        // Buffer size
-    desiredSpec.callback = nullptr;
+    desiredSpec.callback = &SDLWindow::audioCallback; // Pull mode: the device asks the engine for audio
+    desiredSpec.userdata = this;
 
     // Note: A "real" app would pass this ID to the engine
     m_audioDeviceID = SDL_OpenAudioDevice(nullptr, 0, &desiredSpec, &m_audioSpec, 0);
@@ -55,25 +66,51 @@ SDLWindow::SDLWindow(const std::string& title, int minWidth, int minHeight) {
     }
 
     const std::string videoUrl = "https://fast-tailor.3catdirectes.cat/v1/channel/ccma-channel2/hls.m3u8";
-    auto streamer = VideoStreamFactory::createVideoStreamer(videoUrl);
+
+    // SDL renders planar and semi-planar YUV natively, so most streams
+    // can skip the RGBA conversion entirely.
+    StreamOptions options;
+    options.acceptedFormats = { PixelFormat::IYUV, PixelFormat::NV12, PixelFormat::RGBA };
+    SDL_GetRendererOutputSize(m_Renderer, &options.displayWidth, &options.displayHeight);
+
+    // The window keeps responding while the channel connects, and shows its
+    // first keyframe without waiting for audio to line up
+    options.startup.fastStart = true;
+    options.startup.asyncOpen = true;
+
+    // The channel is live: space pauses, the arrows rewind and skip, End returns to live
+    options.timeShift.enabled = true;
+    auto streamer = VideoStreamFactory::createVideoStreamer(videoUrl, options);
 
     if (!streamer) {
         std::cout << "Failed to create streamer for URL: " << videoUrl << std::endl;
         m_keepWindowOpen = false;
+        return;
     } else {
         std::cout << "Streamer created for: " << videoUrl << std::endl;
     }
 
-    streamer->setAudioCallback([this](uint8_t* data, int size) -> bool {
-        // Queue audio data to SDL
-        if (SDL_QueueAudio(m_audioDeviceID, data, size) < 0) {
-            std::cerr << "Failed to queue audio data: " << SDL_GetError() << std::endl;
-            return false;
-        }
-        return true;
-    });
+    // Samples handed over in one callback start playing about one device buffer later
+    if (m_audioDeviceID > 0) {
+        streamer->setAudioOutputLatency((double)m_audioSpec.samples / (double)m_audioSpec.freq);
+    }
 
+    // The audio callback reads m_streamers on SDL's audio thread
+    m_scheduler.addStream(streamer.get());
+    SDL_LockAudioDevice(m_audioDeviceID);
     m_streamers.push_back(std::move(streamer));
+    SDL_UnlockAudioDevice(m_audioDeviceID);
+}
+
+void SDLWindow::audioCallback(void* userdata, Uint8* stream, int len) {
+    auto* window = static_cast<SDLWindow*>(userdata);
+
+    // The first stream is the audible one
+    if (window->m_streamers.empty() || !window->m_streamers.front()) {
+        memset(stream, 0, len);
+        return;
+    }
+    window->m_streamers.front()->readAudio(stream, len);
 }
 
 SDLWindow::~SDLWindow() {
@@ -82,8 +119,8 @@ SDLWindow::~SDLWindow() {
     }
 
     for (auto& pair : m_videoTextures) {
-        if (pair.second)
-            SDL_DestroyTexture(pair.second);
+        if (pair.second.texture)
+            SDL_DestroyTexture(pair.second.texture);
     }
     if (m_Renderer) {
         SDL_DestroyRenderer(m_Renderer);
@@ -108,62 +145,134 @@ void SDLWindow::handleEvents() {
         if (e.type == SDL_QUIT) {
             m_keepWindowOpen = false;
         }
+        else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F12 && Tracer::enabled()) {
+            // On-demand trace of the last few seconds
+            if (Tracer::global().dump()) {
+                std::cout << "Trace written." << std::endl;
+            }
+        }
+        else if (e.type == SDL_KEYDOWN) {
+            handleTimeShiftKey(e.key.keysym.sym);
+        }
+    }
+}
+
+void SDLWindow::handleTimeShiftKey(SDL_Keycode key) {
+    for (auto& streamer : m_streamers) {
+        // Where playback is: the audio clock, or else what the buffer last fed
+        double position = streamer->getClock();
+        if (position <= 0.0) {
+            position = streamer->getTimeShiftRange().position;
+        }
+
+        switch (key) {
+            case SDLK_SPACE:
+                streamer->setPaused(!streamer->isPaused());
+                break;
+            case SDLK_LEFT:
+                streamer->seek(position - TIME_SHIFT_STEP);
+                break;
+            case SDLK_RIGHT:
+                streamer->seek(position + TIME_SHIFT_STEP);
+                break;
+            case SDLK_END:
+                streamer->seekToLive();
+                break;
+            default:
+                break;
+        }
     }
 }
 
 void SDLWindow::updateFrame() {
     if (m_streamers.empty()) return;
 
-    VideoFrame frame;
+    // Whatever is uploaded now becomes visible at the vsync after the last present
+    double now = PresentationScheduler::monotonicNow();
+    double nextVsync = m_lastPresentTime + m_vsyncInterval;
+    if (nextVsync <= now) {
+        double missed = std::ceil((now - m_lastPresentTime) / m_vsyncInterval);
+        nextVsync = m_lastPresentTime + missed * m_vsyncInterval;
+    }
+
+    // Never waits: frames that are not due yet stay with the scheduler
+    m_scheduler.tick(now, nextVsync);
+
+    m_updatedStreamers.clear();
     for (auto& streamer : m_streamers) {
-        // This function processes audio (via your callback) while
-        // it searches for the next video frame.
-        if (streamer->getNextVideoFrame(frame)) {
-            double video_timestamp = frame.timestamp;
-            if (video_timestamp == 0.0) return;
-
-            double audio_clock = streamer->getClock();
-            Uint32 buffered_bytes = SDL_GetQueuedAudioSize(m_audioDeviceID);
-            int bytes_per_second = m_audioSpec.freq * m_audioSpec.channels * 2;
-            double buffered_seconds = (double)buffered_bytes / (double)bytes_per_second;
-
-            double actual_audio_time = audio_clock - buffered_seconds;
-            double delay = video_timestamp - actual_audio_time;
-
-            const double SMALL_EARLY_THRESHOLD = 0.010;
-            const double DROP_LATE_THRESHOLD    = -0.050;
-            const double MAX_WAIT_MS            = 50.0;
-
-            if (delay > SMALL_EARLY_THRESHOLD) {
-                // Wait for the audio to catch up
-                double wait_ms = delay * 1000.0;
-                if (wait_ms > MAX_WAIT_MS) wait_ms = MAX_WAIT_MS;
-                SDL_Delay((Uint32)wait_ms);
-            } else if (delay < -DROP_LATE_THRESHOLD) { // Video is > 100ms late?
-                // This frame is too old, drop it and get the next one
-                std::cout << "Dropping late video frame to catch up." << std::endl;
-                return;
+        bool changed = false;
+        const VideoFrame* frame = m_scheduler.getCurrentFrame(streamer.get(), &changed);
+        if (frame && changed) {
+            int64_t uploadStart = StreamMetrics::now();
+            {
+                TraceScope trace("texture upload", frame->traceId);
+                uploadFrame(streamer.get(), *frame);
             }
-
-            // If we're here, the frame is in sync (or only slightly late), so we render it.
-            auto videoTexture = m_videoTextures[streamer.get()];
-
-            if (!videoTexture) {
-                videoTexture = SDL_CreateTexture(m_Renderer,
-                                                   SDL_PIXELFORMAT_RGBA32,
-                                                   SDL_TEXTUREACCESS_STREAMING,
-                                                   frame.width, frame.height);
-                m_videoTextures[streamer.get()] = videoTexture;
-                if (videoTexture) {
-                    SDL_SetWindowSize(m_Window, frame.width, frame.height);
-                }
+            if (StreamMetrics* metrics = streamer->getMetrics()) {
+                metrics->record(MetricStage::TEXTURE_UPLOAD, StreamMetrics::now() - uploadStart);
             }
+            m_updatedStreamers.push_back(streamer.get());
+        }
+    }
+}
 
-            if (videoTexture) {
-                SDL_UpdateTexture(videoTexture, nullptr, frame.data.data(), frame.width * 4);
-            }
+static Uint32 toSDLPixelFormat(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::IYUV: return SDL_PIXELFORMAT_IYUV;
+        case PixelFormat::NV12: return SDL_PIXELFORMAT_NV12;
+        case PixelFormat::RGBA: return SDL_PIXELFORMAT_RGBA32;
+    }
+    return SDL_PIXELFORMAT_RGBA32;
+}
+
+void SDLWindow::uploadFrame(VideoStreamer* streamer, const VideoFrame& frame) {
+    VideoTexture& videoTexture = m_videoTextures[streamer];
+
+    // (Re)create the texture whenever the stream's layout changes
+    if (!videoTexture.texture || videoTexture.format != frame.format ||
+        videoTexture.width != frame.width || videoTexture.height != frame.height) {
+        bool firstTexture = videoTexture.texture == nullptr;
+        if (videoTexture.texture) {
+            SDL_DestroyTexture(videoTexture.texture);
+        }
+
+        videoTexture.texture = SDL_CreateTexture(m_Renderer,
+                                                 toSDLPixelFormat(frame.format),
+                                                 SDL_TEXTUREACCESS_STREAMING,
+                                                 frame.width, frame.height);
+        videoTexture.format = frame.format;
+        videoTexture.width = frame.width;
+        videoTexture.height = frame.height;
+        if (!videoTexture.reduced) {
+            videoTexture.sourceWidth = frame.width;
+            videoTexture.sourceHeight = frame.height;
+        }
+
+        if (!videoTexture.texture) {
+            std::cerr << "Failed to create video texture: " << SDL_GetError() << std::endl;
+            return;
+        }
+        if (firstTexture) {
+            SDL_SetWindowSize(m_Window, frame.width, frame.height);
         }
     }
+
+    switch (frame.format) {
+        case PixelFormat::IYUV:
+            SDL_UpdateYUVTexture(videoTexture.texture, nullptr,
+                                 frame.planes[0], frame.strides[0],
+                                 frame.planes[1], frame.strides[1],
+                                 frame.planes[2], frame.strides[2]);
+            break;
+        case PixelFormat::NV12:
+            SDL_UpdateNVTexture(videoTexture.texture, nullptr,
+                                frame.planes[0], frame.strides[0],
+                                frame.planes[1], frame.strides[1]);
+            break;
+        case PixelFormat::RGBA:
+            SDL_UpdateTexture(videoTexture.texture, nullptr, frame.planes[0], frame.strides[0]);
+            break;
+    }
 }
 
 void SDLWindow::render() {
@@ -171,7 +280,7 @@ void SDLWindow::render() {
     SDL_RenderClear(m_Renderer);
 
     for (auto& pair : m_videoTextures) {
-        SDL_Texture* tex = pair.second;
+        SDL_Texture* tex = pair.second.texture;
         if (!tex) continue;
 
         SDL_Rect dst;
@@ -182,8 +291,51 @@ void SDLWindow::render() {
         dst.w = w;
         dst.h = h;
 
+        // Adaptive streams stop fetching more pixels than the tile shows
+        VideoTexture& videoTexture = pair.second;
+        const bool resized = videoTexture.displayWidth != dst.w || videoTexture.displayHeight != dst.h;
+        if (resized) {
+            videoTexture.displayWidth = dst.w;
+            videoTexture.displayHeight = dst.h;
+            pair.first->setDisplaySize(dst.w, dst.h);
+        }
+
+        // The GPU scales for free, so the decoder's frames pass through as
+        // they are; only a tile of half the size or less is worth converting
+        // (or decoding at reduced resolution) down to
+        const bool reduce = videoTexture.sourceWidth > 0 &&
+                            dst.w * 2 <= videoTexture.sourceWidth && dst.h * 2 <= videoTexture.sourceHeight;
+        if (reduce && (resized || !videoTexture.reduced)) {
+            pair.first->setOutputSize(dst.w, dst.h);
+        } else if (!reduce && videoTexture.reduced) {
+            pair.first->setOutputSize(0, 0);
+        }
+        videoTexture.reduced = reduce;
+
         SDL_RenderCopy(m_Renderer, tex, nullptr, &dst);
     }
 
-    SDL_RenderPresent(m_Renderer);
+    // Blocks until the vsync; the next frame is scheduled against it
+    int64_t presentStart = StreamMetrics::now();
+    {
+        TraceScope trace("SDL_RenderPresent");
+        for (VideoStreamer* streamer : m_updatedStreamers) {
+            if (const VideoFrame* frame = m_scheduler.getCurrentFrame(streamer)) {
+                Tracer::flow(TraceFlow::END, frame->traceId);
+            }
+        }
+        SDL_RenderPresent(m_Renderer);
+    }
+    double previousPresent = m_lastPresentTime;
+    m_lastPresentTime = PresentationScheduler::monotonicNow();
+
+    // More than a couple of refreshes between presents is a visible stutter
+    Tracer::global().reportStall("present stall", m_lastPresentTime - previousPresent);
+
+    int64_t presentNs = StreamMetrics::now() - presentStart;
+    for (VideoStreamer* streamer : m_updatedStreamers) {
+        if (StreamMetrics* metrics = streamer->getMetrics()) {
+            metrics->record(MetricStage::PRESENT, presentNs);
+        }
+    }
 }
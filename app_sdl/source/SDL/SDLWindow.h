@@ -6,8 +6,10 @@
 #include <unordered_map>
 #include <vector>
 
+#include <V2P/stream/VideoFrame.h>
+#include <V2P/managers/PresentationScheduler.h>
+
 class VideoStreamer;
-struct VideoFrame;
 
 class SDLWindow{
 public:
@@ -20,8 +22,26 @@ public:
 private:
     // Helper functions for the main loop
     void handleEvents();
+    void handleTimeShiftKey(SDL_Keycode key);
     void updateFrame();
     void render();
+    void uploadFrame(VideoStreamer* streamer, const VideoFrame& frame);
+
+    // SDL audio callback (runs on SDL's audio thread)
+    static void audioCallback(void* userdata, Uint8* stream, int len);
+
+    // A streaming texture plus the frame layout it was created for
+    struct VideoTexture {
+        SDL_Texture* texture = nullptr;
+        PixelFormat format = PixelFormat::RGBA;
+        int width = 0;
+        int height = 0;
+        int displayWidth = 0;  // Last size reported to the streamer
+        int displayHeight = 0;
+        int sourceWidth = 0;   // Decoded size, seen while no output size is requested
+        int sourceHeight = 0;
+        bool reduced = false;  // An output size is requested
+    };
 
     // SDL members
     SDL_Window* m_Window = nullptr;
@@ -31,8 +51,16 @@ private:
     SDL_AudioSpec m_audioSpec = {};
 
     std::vector<std::unique_ptr<VideoStreamer>> m_streamers;
-    std::unordered_map<VideoStreamer*, SDL_Texture*> m_videoTextures;
+    std::unordered_map<VideoStreamer*, VideoTexture> m_videoTextures;
+
+    PresentationScheduler m_scheduler;
+    double m_vsyncInterval = 1.0 / 60.0;
+    double m_lastPresentTime = 0.0;
+
+    static constexpr double TIME_SHIFT_STEP = 10.0; // Seconds per arrow key
+
+    // Streams with a new frame in the upcoming present, for its metrics
+    std::vector<VideoStreamer*> m_updatedStreamers;
 
-    Uint32 m_playbackStartTime = 0;
     bool m_keepWindowOpen = true;
 };
@@ -0,0 +1,173 @@
+#include "AbrBenchmark.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <V2P/stream/VideoStreamFactory.h>
+
+#include "HttpStandInServer.h"
+#include "MediaGenerator.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr double LATENCY_SECONDS = 0.02;
+    constexpr double REBUFFER_SECONDS = 0.1;
+
+    struct AbrScenario {
+        const char* name;
+        double linkKbps;       // 0: unthrottled
+        double dropKbps;       // Link speed from halfway through; 0 keeps it
+        int displayWidth;
+        int displayHeight;
+    };
+
+    struct HeightChange {
+        double seconds;        // Media time
+        int height;
+    };
+
+    struct AbrResult {
+        AbrScenario scenario;
+        uint64_t frames = 0;
+        uint64_t rebuffers = 0;
+        double rebufferMs = 0.0;
+        std::vector<HeightChange> heights;
+        PrefetchStats stats;
+    };
+
+    double secondsBetween(Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration<double>(to - from).count();
+    }
+
+    bool runScenario(const std::string& directory, const std::string& playlist, double seconds, AbrResult& result) {
+        const AbrScenario& scenario = result.scenario;
+        HttpStandInServer server(directory, LATENCY_SECONDS, scenario.linkKbps * 1000.0 / 8.0);
+        if (!server.start())
+            return false;
+
+        StreamOptions options;
+        options.acceptedFormats = { PixelFormat::IYUV, PixelFormat::NV12, PixelFormat::RGBA };
+        options.displayWidth = scenario.displayWidth;
+        options.displayHeight = scenario.displayHeight;
+        auto streamer = VideoStreamFactory::createVideoStreamer(server.url(playlist), options);
+        if (!streamer || streamer->hasEnded())
+            return false;
+
+        // Frames are consumed when due; time spent waiting for a late frame
+        // pauses the playback clock, as a player would while rebuffering
+        VideoFrame frame;
+        bool haveFrame = false;
+        bool started = false;
+        bool dropped = false;
+        double firstPts = 0.0;
+        Clock::time_point playStart;
+        const Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(seconds * 2.0 + 10.0));
+
+        while (Clock::now() < deadline) {
+            bool ended = streamer->hasEnded();
+            if (!haveFrame) {
+                haveFrame = streamer->getNextVideoFrame(frame);
+            }
+            if (!haveFrame) {
+                if (ended)
+                    break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                continue;
+            }
+
+            if (!started) {
+                started = true;
+                firstPts = frame.timestamp;
+                playStart = Clock::now();
+            }
+
+            const double mediaTime = frame.timestamp - firstPts;
+            const Clock::time_point due = playStart + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(mediaTime));
+            const Clock::time_point now = Clock::now();
+            if (now < due) {
+                std::this_thread::sleep_for(std::min<Clock::duration>(due - now, std::chrono::milliseconds(5)));
+                continue;
+            }
+
+            double lateness = secondsBetween(due, now);
+            if (lateness > REBUFFER_SECONDS) {
+                result.rebuffers++;
+                result.rebufferMs += lateness * 1000.0;
+                playStart += now - due;
+            }
+
+            if (result.heights.empty() || result.heights.back().height != frame.height) {
+                result.heights.push_back({ mediaTime, frame.height });
+            }
+            if (scenario.dropKbps > 0.0 && !dropped && mediaTime >= seconds / 2.0) {
+                server.setBytesPerSecond(scenario.dropKbps * 1000.0 / 8.0);
+                dropped = true;
+            }
+
+            result.frames++;
+            frame.reset();
+            haveFrame = false;
+        }
+
+        result.stats = streamer->getPrefetchStats();
+        return true;
+    }
+
+    void writeResult(const AbrResult& r, std::ostream& out) {
+        out << "{\"scenario\":\"" << r.scenario.name << "\""
+            << ",\"link_kbps\":" << r.scenario.linkKbps
+            << ",\"drop_kbps\":" << r.scenario.dropKbps
+            << ",\"display\":\"" << r.scenario.displayWidth << "x" << r.scenario.displayHeight << "\""
+            << ",\"frames\":" << r.frames
+            << ",\"rebuffers\":" << r.rebuffers
+            << ",\"rebuffer_ms\":" << r.rebufferMs
+            << ",\"heights\":[";
+        for (size_t i = 0; i < r.heights.size(); ++i) {
+            out << (i ? "," : "") << "{\"t\":" << r.heights[i].seconds << ",\"height\":" << r.heights[i].height << "}";
+        }
+        out << "],\"variant_switches\":" << r.stats.variantSwitches
+            << ",\"final_variant_height\":" << r.stats.variantHeight
+            << ",\"estimated_kbps\":" << r.stats.estimatedBandwidth / 1000.0
+            << ",\"segments_fetched\":" << r.stats.segmentsFetched
+            << ",\"reader_waits\":" << r.stats.readerWaits
+            << "}";
+    }
+}
+
+void runAbrBenchmark(const std::string& directory, double seconds, double linkKbps, std::ostream& out) {
+    const std::string playlist = generateLadder(directory, seconds);
+
+    const AbrScenario scenarios[] = {
+        { "throttled", linkKbps, 0.0, 1920, 1080 },
+        { "throttle_drop", 0.0, linkKbps, 1920, 1080 },
+        { "small_tile", 0.0, 0.0, 640, 360 },
+        { "large_tile", 0.0, 0.0, 1920, 1080 },
+    };
+
+    std::vector<AbrResult> results;
+    std::vector<std::string> skipped;
+    for (const AbrScenario& scenario : scenarios) {
+        AbrResult result;
+        result.scenario = scenario;
+        if (!playlist.empty() && runScenario(directory, playlist, seconds, result)) {
+            results.push_back(result);
+        } else {
+            skipped.push_back(scenario.name);
+        }
+    }
+
+    out << "{\"benchmark\":\"abr\",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        out << (i ? "," : "");
+        writeResult(results[i], out);
+    }
+    out << "],\"skipped\":[";
+    for (size_t i = 0; i < skipped.size(); ++i) {
+        out << (i ? "," : "") << "\"" << skipped[i] << "\"";
+    }
+    out << "]}" << std::endl;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+/**
+ * @brief Plays the ladder of generateLadder() through an HttpStandInServer
+ * and reports what the adaptive bitrate logic did.
+ *
+ * Each scenario plays the master playlist in real time (frames are taken
+ * when their pts is due), so the buffers behave as they would on screen:
+ * - throttled: the link is limited to `linkKbps`, the tile is 1080p;
+ * - throttle_drop: unlimited, then `linkKbps` from halfway through;
+ * - small_tile: unlimited, drawn at 640x360;
+ * - large_tile: unlimited, drawn at 1920x1080.
+ * Reported per scenario: the frame heights over time (where the switches
+ * landed), rebuffers (frames due more than 100 ms before they were
+ * decoded) and the prefetcher's switch count and bandwidth estimate.
+ *
+ * @param directory Where the ladder is kept between runs.
+ * @param seconds Duration of the ladder, and of each scenario.
+ * @param linkKbps Throttled link speed in kilobits per second.
+ * @param out Stream receiving the results as a JSON object.
+ */
+void runAbrBenchmark(const std::string& directory, double seconds, double linkKbps, std::ostream& out);
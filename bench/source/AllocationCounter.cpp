@@ -0,0 +1,109 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> heapAllocations{0};
+
+    void* countedAllocate(std::size_t size) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        if (void* p = std::malloc(size ? size : 1))
+            return p;
+        throw std::bad_alloc();
+    }
+
+    void* countedAllocate(std::size_t size, std::align_val_t alignment) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        std::size_t align = static_cast<std::size_t>(alignment);
+        std::size_t rounded = (size + align - 1) / align * align;
+        if (void* p = std::aligned_alloc(align, rounded ? rounded : align))
+            return p;
+        throw std::bad_alloc();
+    }
+}
+
+uint64_t allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+// glibc's own entry points, which the interposed C allocator forwards to.
+// Everything in the process goes through these: the engine, FFmpeg
+// (av_malloc is posix_memalign) and the C++ allocation functions below.
+extern "C" {
+    void* __libc_malloc(std::size_t size);
+    void* __libc_calloc(std::size_t count, std::size_t size);
+    void* __libc_realloc(void* p, std::size_t size);
+    void* __libc_memalign(std::size_t alignment, std::size_t size);
+    void __libc_free(void* p);
+
+    void* malloc(std::size_t size) {
+        heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t count, std::size_t size) {
+        heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* p, std::size_t size) {
+        // Growing may move the block, so every call counts
+        heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_realloc(p, size);
+    }
+
+    void* memalign(std::size_t alignment, std::size_t size) {
+        heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(std::size_t alignment, std::size_t size) {
+        heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** out, std::size_t alignment, std::size_t size) {
+        if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+        heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        void* p = __libc_memalign(alignment, size);
+        if (!p)
+            return ENOMEM;
+        *out = p;
+        return 0;
+    }
+
+    void free(void* p) {
+        __libc_free(p);
+    }
+}
+
+uint64_t heapAllocationCount() {
+    return heapAllocations.load(std::memory_order_relaxed);
+}
+#else
+uint64_t heapAllocationCount() {
+    return allocationCount();
+}
+#endif
+
+// Replaceable global allocation functions. The nothrow forms of the
+// standard library forward to these.
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAllocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return countedAllocate(size, alignment); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
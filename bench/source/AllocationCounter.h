@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Number of global operator new calls made by any thread so far.
+ *
+ * The bench replaces the global allocation functions to count them, so
+ * this covers every C++ allocation in the engine.
+ */
+uint64_t allocationCount();
+
+/**
+ * @brief Number of heap allocations of any kind made by any thread so far:
+ * malloc, calloc, realloc and the aligned forms, which is also what
+ * operator new and FFmpeg's av_malloc end up in.
+ *
+ * The bench interposes the C allocator for this on glibc; elsewhere it
+ * only sees C++ allocations and equals allocationCount().
+ */
+uint64_t heapAllocationCount();
@@ -0,0 +1,237 @@
+#include "DecodeBenchmark.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <V2P/stream/FrameShellPool.h>
+#include <V2P/stream/M3U8StreamStrategy.h>
+#include <V2P/stream/VideoStreamFactory.h>
+
+#include "AllocationCounter.h"
+#include "MediaGenerator.h"
+
+namespace {
+    // Frames decoded before the allocation counters start, so one-off setup is not counted
+    constexpr uint64_t WARMUP_FRAMES = 10;
+
+    // Heap allocations per video frame left to FFmpeg once warm. Every
+    // AVPacket, AVFrame and frame buffer of the engine's own is pooled, so
+    // what remains happens inside FFmpeg and follows the media:
+    // - av_read_frame(): each packet's payload with its AVBuffer and
+    //   AVBufferRef (3), once more where a parser repackages the packet
+    // - the decoder: an AVBufferRef for every plane and per-picture table it
+    //   references, for the output, the reference list and each frame thread
+    // - the AVBufferRef wrapping each pooled conversion buffer (rgba only)
+    // - the audio decoded alongside, about 1.5 AAC frames per video frame
+    // A run above it has gained an allocation somewhere in the frame path.
+    constexpr double FFMPEG_ALLOCATIONS_PER_FRAME = 32.0;
+
+    struct DecodeResult {
+        std::string asset;
+        std::string driver;
+        std::string output;
+        uint64_t frames = 0;
+        double seconds = 0.0;
+        DecodeStats stats;
+        double allocationsPerFrame = 0.0;     // C++ operator new
+        double heapAllocationsPerFrame = 0.0; // Any malloc, FFmpeg's included
+        double poolMissesPerFrame = 0.0;
+        double packetMissesPerFrame = 0.0;
+        double shellMissesPerFrame = 0.0;     // AVFrames, see FrameShellPool
+
+        // No C++ allocation, frame buffer, AVFrame or packet per frame once warm
+        bool noCppAllocations() const {
+            return allocationsPerFrame == 0.0 && poolMissesPerFrame == 0.0 &&
+                   packetMissesPerFrame == 0.0 && shellMissesPerFrame == 0.0;
+        }
+
+        // And nothing else allocates beyond what FFmpeg needs for itself
+        bool withinHeapAllowance() const {
+            return heapAllocationsPerFrame <= FFMPEG_ALLOCATIONS_PER_FRAME;
+        }
+    };
+
+    std::vector<PixelFormat> outputFormats(const std::string& output) {
+        if (output == "rgba")
+            return { PixelFormat::RGBA };
+        return { PixelFormat::IYUV, PixelFormat::NV12, PixelFormat::RGBA };
+    }
+
+    // Counts frames and takes the warm-up snapshot; shared by both drivers
+    class FrameCounter {
+    public:
+        void onFrame(const FramePoolStats& pool, const PacketPoolStats& packets) {
+            if (++frames == WARMUP_FRAMES) {
+                warmAllocations = allocationCount();
+                warmHeapAllocations = heapAllocationCount();
+                warmPoolMisses = pool.misses;
+                warmPacketMisses = packets.misses;
+                warmShellMisses = FrameShellPool::global().getStats().misses;
+            }
+        }
+
+        void finish(DecodeResult& result, const FramePoolStats& pool, const PacketPoolStats& packets) const {
+            result.frames = frames;
+            if (frames > WARMUP_FRAMES) {
+                double measured = static_cast<double>(frames - WARMUP_FRAMES);
+                result.allocationsPerFrame = static_cast<double>(allocationCount() - warmAllocations) / measured;
+                result.heapAllocationsPerFrame = static_cast<double>(heapAllocationCount() - warmHeapAllocations) / measured;
+                result.poolMissesPerFrame = static_cast<double>(pool.misses - warmPoolMisses) / measured;
+                result.packetMissesPerFrame = static_cast<double>(packets.misses - warmPacketMisses) / measured;
+                result.shellMissesPerFrame =
+                    static_cast<double>(FrameShellPool::global().getStats().misses - warmShellMisses) / measured;
+            }
+        }
+
+    private:
+        uint64_t frames = 0;
+        uint64_t warmAllocations = 0;
+        uint64_t warmHeapAllocations = 0;
+        uint64_t warmPoolMisses = 0;
+        uint64_t warmPacketMisses = 0;
+        uint64_t warmShellMisses = 0;
+    };
+
+    bool runStrategy(const std::string& playlist, DecodeResult& result) {
+        M3U8StreamStrategy strategy;
+        strategy.setAcceptedFormats(outputFormats(result.output));
+        strategy.enableAudio();
+        if (!strategy.open(playlist))
+            return false;
+
+        FrameCounter counter;
+        VideoFrame frame;
+        auto start = std::chrono::steady_clock::now();
+        while (strategy.processNextFrame(frame) == PacketType::VIDEO) {
+            frame.reset(); // Dropped as soon as a client would have shown it
+            counter.onFrame(strategy.getFramePoolStats(), strategy.getPacketPoolStats());
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        counter.finish(result, strategy.getFramePoolStats(), strategy.getPacketPoolStats());
+        result.stats = strategy.getDecodeStats();
+        return true;
+    }
+
+    bool runStreamer(const std::string& playlist, DecodeResult& result) {
+        StreamOptions options;
+        options.acceptedFormats = outputFormats(result.output);
+        auto streamer = VideoStreamFactory::createVideoStreamer(playlist, options);
+        if (!streamer || streamer->hasEnded())
+            return false;
+
+        FrameCounter counter;
+        VideoFrame frame;
+        auto start = std::chrono::steady_clock::now();
+        while (true) {
+            // Check for the end first: frames queued before it are still drained
+            bool ended = streamer->hasEnded();
+            if (streamer->getNextVideoFrame(frame)) {
+                frame.reset();
+                counter.onFrame(streamer->getFramePoolStats(), streamer->getPacketPoolStats());
+            } else if (ended) {
+                break;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        counter.finish(result, streamer->getFramePoolStats(), streamer->getPacketPoolStats());
+        result.stats = streamer->getDecodeStats();
+        return true;
+    }
+
+    double microsecondsPer(double totalMs, uint64_t count) {
+        return count ? totalMs * 1000.0 / static_cast<double>(count) : 0.0;
+    }
+
+    void writeResult(const DecodeResult& r, std::ostream& out) {
+        out << "{\"asset\":\"" << r.asset << "\""
+            << ",\"driver\":\"" << r.driver << "\""
+            << ",\"output\":\"" << r.output << "\""
+            << ",\"frames\":" << r.frames
+            << ",\"seconds\":" << r.seconds
+            << ",\"fps\":" << (r.seconds > 0.0 ? static_cast<double>(r.frames) / r.seconds : 0.0)
+            << ",\"decoder_threads\":" << r.stats.threadCount
+            << ",\"us_per_stage\":{"
+            << "\"demux\":" << microsecondsPer(r.stats.totalDemuxMs, r.stats.packetsDemuxed)
+            << ",\"decode\":" << microsecondsPer(r.stats.totalDecodeMs, r.stats.framesDecoded)
+            << ",\"convert\":" << microsecondsPer(r.stats.totalConvertMs, r.stats.framesConverted)
+            << ",\"queue\":" << microsecondsPer(r.stats.totalQueueMs, r.stats.framesQueued)
+            << "}"
+            << ",\"allocations_per_frame\":" << r.allocationsPerFrame
+            << ",\"heap_allocations_per_frame\":" << r.heapAllocationsPerFrame
+            << ",\"pool_misses_per_frame\":" << r.poolMissesPerFrame
+            << ",\"packet_misses_per_frame\":" << r.packetMissesPerFrame
+            << ",\"shell_misses_per_frame\":" << r.shellMissesPerFrame
+            << ",\"no_cpp_allocations\":" << (r.noCppAllocations() ? "true" : "false")
+            << ",\"within_heap_allowance\":" << (r.withinHeapAllowance() ? "true" : "false")
+            << "}";
+    }
+}
+
+bool runDecodeBenchmark(const std::string& directory, double seconds,
+                        const std::string& filter, std::ostream& out) {
+    std::vector<DecodeResult> results;
+    std::vector<std::string> skipped;
+
+    for (const MediaAsset& asset : defaultMediaAssets()) {
+        if (!filter.empty() && asset.name.find(filter) == std::string::npos)
+            continue;
+
+        const std::string playlist = asset.playlistPath(directory);
+        if (!std::filesystem::exists(playlist) && !generateMediaAsset(asset, directory, seconds)) {
+            skipped.push_back(asset.name);
+            continue;
+        }
+
+        for (const char* driver : { "strategy", "streamer" }) {
+            for (const char* output : { "native", "rgba" }) {
+                DecodeResult result;
+                result.asset = asset.name;
+                result.driver = driver;
+                result.output = output;
+
+                bool ok = result.driver == "strategy" ? runStrategy(playlist, result)
+                                                      : runStreamer(playlist, result);
+                if (ok) {
+                    results.push_back(result);
+                } else {
+                    skipped.push_back(asset.name + "/" + driver + "/" + output);
+                }
+            }
+        }
+    }
+
+    out << "{\"benchmark\":\"decode\",\"asset_seconds\":" << seconds
+        << ",\"heap_allocation_allowance\":" << FFMPEG_ALLOCATIONS_PER_FRAME << ",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        out << (i ? "," : "");
+        writeResult(results[i], out);
+    }
+    out << "],\"skipped\":[";
+    for (size_t i = 0; i < skipped.size(); ++i) {
+        out << (i ? "," : "") << "\"" << skipped[i] << "\"";
+    }
+    out << "]}" << std::endl;
+
+    bool clean = true;
+    for (const DecodeResult& result : results) {
+        if (!result.noCppAllocations()) {
+            std::cerr << result.asset << "/" << result.driver << "/" << result.output
+                      << " still makes C++ allocations or pool misses after warm-up." << std::endl;
+            clean = false;
+        }
+        if (!result.withinHeapAllowance()) {
+            std::cerr << result.asset << "/" << result.driver << "/" << result.output << " makes "
+                      << result.heapAllocationsPerFrame << " heap allocations per frame, more than the "
+                      << FFMPEG_ALLOCATIONS_PER_FRAME << " allowed for FFmpeg." << std::endl;
+            clean = false;
+        }
+    }
+    return clean;
+}
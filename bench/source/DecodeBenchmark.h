@@ -0,0 +1,29 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+/**
+ * @brief Measures the video pipeline on locally generated HLS streams.
+ *
+ * Every asset of defaultMediaAssets() whose name contains `filter` is
+ * generated into `directory` (unless it is already there) and then played
+ * as fast as possible, twice per output mode:
+ * - "strategy": M3U8StreamStrategy::processNextFrame driven directly.
+ * - "streamer": a VideoStreamer from VideoStreamFactory, drained by a polling consumer.
+ * Output modes are "native" (the decoder's YUV passed through) and "rgba"
+ * (converted). For each run it reports frames/s, microseconds per stage
+ * (demux per packet, decode/convert/queue per frame) and, per frame after
+ * a short warm-up: C++ allocations, heap allocations of any kind (FFmpeg's
+ * included), and frame buffer, AVFrame and packet pool misses.
+ *
+ * @param directory Where the assets are kept between runs.
+ * @param seconds Duration of generated assets.
+ * @param filter Substring selecting assets; empty selects all.
+ * @param out Stream receiving the results as a JSON object.
+ * @return False if any run still made C++ allocations or pool misses once
+ * warm, or more heap allocations per frame than the documented allowance
+ * for FFmpeg's own (payloads and buffer references, see DecodeBenchmark.cpp).
+ */
+bool runDecodeBenchmark(const std::string& directory, double seconds,
+                        const std::string& filter, std::ostream& out);
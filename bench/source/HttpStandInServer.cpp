@@ -0,0 +1,182 @@
+#include "HttpStandInServer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    constexpr size_t SEND_CHUNK = 16 * 1024;
+    constexpr int ACCEPT_POLL_MS = 100;
+
+    bool sendAll(int socket, const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t sent = ::send(socket, data, size, MSG_NOSIGNAL);
+            if (sent <= 0)
+                return false;
+            data += sent;
+            size -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    const char* contentType(const std::string& path) {
+        auto endsWith = [&path](const char* suffix) {
+            std::string s(suffix);
+            return path.size() >= s.size() && path.compare(path.size() - s.size(), s.size(), s) == 0;
+        };
+        if (endsWith(".m3u8")) return "application/vnd.apple.mpegurl";
+        if (endsWith(".ts")) return "video/mp2t";
+        if (endsWith(".mp4") || endsWith(".m4s")) return "video/mp4";
+        return "application/octet-stream";
+    }
+}
+
+HttpStandInServer::HttpStandInServer(std::string rootDirectory, double latency, double bytesPerSecond)
+    : rootDirectory(std::move(rootDirectory)),
+      latency(latency),
+      bytesPerSecond(bytesPerSecond) {}
+
+HttpStandInServer::~HttpStandInServer() {
+    stop();
+}
+
+bool HttpStandInServer::start() {
+    listenSocket = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSocket < 0) {
+        std::cerr << "Could not create the stand-in server socket." << std::endl;
+        return false;
+    }
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if (::bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listenSocket, 64) < 0 ||
+        ::getsockname(listenSocket, reinterpret_cast<sockaddr*>(&address), &length) < 0) {
+        std::cerr << "Could not listen on 127.0.0.1." << std::endl;
+        ::close(listenSocket);
+        listenSocket = -1;
+        return false;
+    }
+
+    port = ntohs(address.sin_port);
+    running = true;
+    acceptThread = std::thread(&HttpStandInServer::acceptLoop, this);
+    return true;
+}
+
+void HttpStandInServer::stop() {
+    running = false;
+    if (acceptThread.joinable()) {
+        acceptThread.join();
+    }
+
+    std::vector<std::thread> finishing;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        finishing.swap(connections);
+    }
+    for (std::thread& connection : finishing) {
+        connection.join();
+    }
+
+    if (listenSocket >= 0) {
+        ::close(listenSocket);
+        listenSocket = -1;
+    }
+}
+
+std::string HttpStandInServer::url(const std::string& path) const {
+    return "http://127.0.0.1:" + std::to_string(port) + "/" + path;
+}
+
+void HttpStandInServer::acceptLoop() {
+    while (running) {
+        // Polls, so that stop() does not have to close the socket under accept()
+        pollfd listener = { listenSocket, POLLIN, 0 };
+        if (::poll(&listener, 1, ACCEPT_POLL_MS) <= 0)
+            continue;
+
+        int connection = ::accept(listenSocket, nullptr, nullptr);
+        if (connection < 0)
+            continue;
+
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        connections.emplace_back(&HttpStandInServer::serve, this, connection);
+    }
+}
+
+void HttpStandInServer::serve(int connection) {
+    // Only the request line matters; headers are read and ignored
+    std::string request;
+    char buffer[4096];
+    while (request.find("\r\n\r\n") == std::string::npos) {
+        ssize_t received = ::recv(connection, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            ::close(connection);
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(received));
+    }
+    requests++;
+
+    std::istringstream requestLine(request.substr(0, request.find("\r\n")));
+    std::string method, target;
+    requestLine >> method >> target;
+    std::string path = target.substr(0, target.find('?'));
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(latency));
+
+    std::string body;
+    bool found = false;
+    if ((method == "GET" || method == "HEAD") && path.size() > 1 && path.find("..") == std::string::npos) {
+        std::ifstream file(rootDirectory + path, std::ios::binary);
+        if (file) {
+            body.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            found = true;
+        }
+    }
+
+    std::ostringstream header;
+    header << (found ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 404 Not Found\r\n")
+           << "Content-Type: " << contentType(path) << "\r\n"
+           << "Content-Length: " << (found ? body.size() : 0) << "\r\n"
+           << "Connection: close\r\n\r\n";
+    const std::string headerText = header.str();
+
+    bool ok = sendAll(connection, headerText.data(), headerText.size());
+    if (ok && found && method == "GET") {
+        for (size_t offset = 0; ok && offset < body.size() && running; offset += SEND_CHUNK) {
+            size_t count = std::min(SEND_CHUNK, body.size() - offset);
+
+            // Pace the body: hand each chunk over once the link would have carried it
+            std::this_thread::sleep_until(reserveLink(count));
+            ok = sendAll(connection, body.data() + offset, count);
+        }
+    }
+
+    ::close(connection);
+}
+
+std::chrono::steady_clock::time_point HttpStandInServer::reserveLink(size_t bytes) {
+    auto now = std::chrono::steady_clock::now();
+    double speed = bytesPerSecond;
+    if (speed <= 0.0)
+        return now;
+
+    // Chunks queue up behind each other, whichever connection they belong to
+    std::lock_guard<std::mutex> lock(linkMutex);
+    linkFreeAt = std::max(linkFreeAt, now) + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(bytes) / speed));
+    return linkFreeAt;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A minimal HTTP/1.1 file server on 127.0.0.1 that stands in for a
+ * CDN, with artificial latency and bandwidth.
+ *
+ * Every GET waits `latency` seconds before the response starts. If
+ * `bytesPerSecond` is set, bodies are paced as if they shared one link of
+ * that speed, so parallel downloads split it like they would on a real
+ * connection. One thread per connection, Connection: close. POSIX sockets only.
+ */
+class HttpStandInServer {
+public:
+    HttpStandInServer(std::string rootDirectory, double latency, double bytesPerSecond = 0.0);
+    ~HttpStandInServer();
+
+    /**
+     * @brief Starts listening on an ephemeral port.
+     */
+    bool start();
+    void stop();
+
+    int getPort() const { return port; }
+
+    /**
+     * @brief The URL that serves `path` (relative to the root directory).
+     */
+    std::string url(const std::string& path) const;
+
+    uint64_t getRequestCount() const { return requests.load(); }
+
+    /**
+     * @brief Changes the link speed for the bytes sent from now on; 0 unthrottles.
+     */
+    void setBytesPerSecond(double value) { bytesPerSecond = value; }
+
+private:
+    void acceptLoop();
+    void serve(int connection);
+
+    // When `bytes` sent now would have crossed the shared link
+    std::chrono::steady_clock::time_point reserveLink(size_t bytes);
+
+    std::string rootDirectory;
+    double latency;
+    std::atomic<double> bytesPerSecond;
+
+    std::mutex linkMutex;
+    std::chrono::steady_clock::time_point linkFreeAt;
+
+    int listenSocket = -1;
+    int port = 0;
+    std::atomic<bool> running = false;
+    std::atomic<uint64_t> requests = 0;
+
+    std::thread acceptThread;
+    std::mutex connectionsMutex;
+    std::vector<std::thread> connections;
+};
@@ -0,0 +1,327 @@
+#include "MediaGenerator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/opt.h>
+#include <libavutil/channel_layout.h>
+}
+
+namespace {
+    constexpr int FRAME_RATE = 30;
+    constexpr int SEGMENT_SECONDS = 2;
+    constexpr int AUDIO_SAMPLE_RATE = 48000;
+    constexpr const char* LADDER_PLAYLIST = "ladder.m3u8";
+
+    struct OutputStream {
+        AVCodecContext* codecCtx = nullptr;
+        AVStream* stream = nullptr;
+        AVFrame* frame = nullptr;
+        int64_t nextPts = 0;
+    };
+
+    void closeOutputStream(OutputStream& output) {
+        avcodec_free_context(&output.codecCtx);
+        av_frame_free(&output.frame);
+    }
+
+    bool openVideo(OutputStream& output, AVFormatContext* formatContext, const MediaAsset& asset) {
+        AVCodecID codecId = asset.codec == "hevc" ? AV_CODEC_ID_HEVC : AV_CODEC_ID_H264;
+        const AVCodec* codec = avcodec_find_encoder(codecId);
+        if (!codec) {
+            std::cerr << "No " << asset.codec << " encoder in this FFmpeg build." << std::endl;
+            return false;
+        }
+
+        output.codecCtx = avcodec_alloc_context3(codec);
+        if (!output.codecCtx)
+            return false;
+
+        AVCodecContext* ctx = output.codecCtx;
+        ctx->width = asset.width;
+        ctx->height = asset.height;
+        ctx->time_base = { 1, FRAME_RATE };
+        ctx->framerate = { FRAME_RATE, 1 };
+        ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+        ctx->gop_size = FRAME_RATE * SEGMENT_SECONDS; // One keyframe per segment
+        ctx->max_b_frames = 2;
+        ctx->bit_rate = static_cast<int64_t>(asset.width) * asset.height * 2; // Roughly broadcast quality
+        if (formatContext->oformat->flags & AVFMT_GLOBALHEADER)
+            ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+        // Generation speed matters more than compression here
+        av_opt_set(ctx->priv_data, "preset", "ultrafast", 0);
+
+        if (avcodec_open2(ctx, codec, nullptr) < 0) {
+            std::cerr << "Could not open the " << asset.codec << " encoder." << std::endl;
+            return false;
+        }
+
+        output.stream = avformat_new_stream(formatContext, nullptr);
+        output.frame = av_frame_alloc();
+        if (!output.stream || !output.frame)
+            return false;
+
+        avcodec_parameters_from_context(output.stream->codecpar, ctx);
+        output.stream->time_base = ctx->time_base;
+
+        output.frame->format = ctx->pix_fmt;
+        output.frame->width = ctx->width;
+        output.frame->height = ctx->height;
+        return av_frame_get_buffer(output.frame, 0) >= 0;
+    }
+
+    bool openAudio(OutputStream& output, AVFormatContext* formatContext) {
+        const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_AAC);
+        if (!codec) {
+            std::cerr << "No AAC encoder in this FFmpeg build." << std::endl;
+            return false;
+        }
+
+        output.codecCtx = avcodec_alloc_context3(codec);
+        if (!output.codecCtx)
+            return false;
+
+        AVCodecContext* ctx = output.codecCtx;
+        ctx->sample_fmt = AV_SAMPLE_FMT_FLTP; // The native AAC encoder's only format
+        ctx->sample_rate = AUDIO_SAMPLE_RATE;
+        ctx->bit_rate = 128000;
+        ctx->time_base = { 1, AUDIO_SAMPLE_RATE };
+        av_channel_layout_default(&ctx->ch_layout, 2);
+        if (formatContext->oformat->flags & AVFMT_GLOBALHEADER)
+            ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+        if (avcodec_open2(ctx, codec, nullptr) < 0) {
+            std::cerr << "Could not open the AAC encoder." << std::endl;
+            return false;
+        }
+
+        output.stream = avformat_new_stream(formatContext, nullptr);
+        output.frame = av_frame_alloc();
+        if (!output.stream || !output.frame)
+            return false;
+
+        avcodec_parameters_from_context(output.stream->codecpar, ctx);
+        output.stream->time_base = ctx->time_base;
+
+        output.frame->format = ctx->sample_fmt;
+        output.frame->sample_rate = ctx->sample_rate;
+        output.frame->nb_samples = ctx->frame_size;
+        av_channel_layout_copy(&output.frame->ch_layout, &ctx->ch_layout);
+        return av_frame_get_buffer(output.frame, 0) >= 0;
+    }
+
+    // Bits per second of the rung's largest segment, as EXT-X-STREAM-INF wants the peak
+    int64_t measurePeakBandwidth(const MediaAsset& asset, const std::string& directory) {
+        uintmax_t largest = 0;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            const std::string file = entry.path().filename().string();
+            if (file.rfind(asset.name + "_", 0) == 0 && entry.path().extension() == ".ts") {
+                largest = std::max(largest, entry.file_size(error));
+            }
+        }
+        return static_cast<int64_t>(largest) * 8 / SEGMENT_SECONDS;
+    }
+
+    // Diagonal luma bands and drifting chroma, so every frame has real motion to encode
+    void fillVideoFrame(AVFrame* frame, int64_t index) {
+        const int shift = static_cast<int>(index * 4);
+        for (int y = 0; y < frame->height; ++y) {
+            uint8_t* row = frame->data[0] + y * frame->linesize[0];
+            for (int x = 0; x < frame->width; ++x)
+                row[x] = static_cast<uint8_t>(x + y + shift);
+        }
+        for (int y = 0; y < frame->height / 2; ++y) {
+            uint8_t* u = frame->data[1] + y * frame->linesize[1];
+            uint8_t* v = frame->data[2] + y * frame->linesize[2];
+            for (int x = 0; x < frame->width / 2; ++x) {
+                u[x] = static_cast<uint8_t>(128 + y + shift / 2);
+                v[x] = static_cast<uint8_t>(64 + x - shift / 2);
+            }
+        }
+    }
+
+    // A 440 Hz tone on both channels
+    void fillAudioFrame(AVFrame* frame, int64_t firstSample) {
+        for (int channel = 0; channel < frame->ch_layout.nb_channels; ++channel) {
+            auto* samples = reinterpret_cast<float*>(frame->data[channel]);
+            for (int i = 0; i < frame->nb_samples; ++i) {
+                double t = static_cast<double>(firstSample + i) / AUDIO_SAMPLE_RATE;
+                samples[i] = static_cast<float>(0.2 * std::sin(2.0 * M_PI * 440.0 * t));
+            }
+        }
+    }
+
+    // Sends one frame (or nullptr to flush) and writes every packet that comes out
+    bool encode(AVFormatContext* formatContext, OutputStream& output, const AVFrame* frame, AVPacket* packet) {
+        if (avcodec_send_frame(output.codecCtx, frame) < 0)
+            return false;
+
+        while (true) {
+            int ret = avcodec_receive_packet(output.codecCtx, packet);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+                return true;
+            if (ret < 0)
+                return false;
+
+            av_packet_rescale_ts(packet, output.codecCtx->time_base, output.stream->time_base);
+            packet->stream_index = output.stream->index;
+            if (av_interleaved_write_frame(formatContext, packet) < 0)
+                return false;
+        }
+    }
+}
+
+std::string MediaAsset::playlistPath(const std::string& directory) const {
+    return directory + "/" + name + ".m3u8";
+}
+
+std::vector<MediaAsset> defaultMediaAssets() {
+    struct Resolution { const char* label; int width; int height; };
+    const Resolution resolutions[] = { { "480p", 854, 480 }, { "1080p", 1920, 1080 }, { "2160p", 3840, 2160 } };
+
+    std::vector<MediaAsset> assets;
+    for (const Resolution& resolution : resolutions) {
+        for (const char* codec : { "h264", "hevc" }) {
+            for (const char* container : { "ts", "fmp4" }) {
+                for (bool audio : { true, false }) {
+                    MediaAsset asset;
+                    asset.name = std::string(codec) + "_" + resolution.label + "_" + container +
+                                 (audio ? "_aac" : "_noaudio");
+                    asset.codec = codec;
+                    asset.container = container;
+                    asset.width = resolution.width;
+                    asset.height = resolution.height;
+                    asset.audio = audio;
+                    assets.push_back(asset);
+                }
+            }
+        }
+    }
+    return assets;
+}
+
+bool generateMediaAsset(const MediaAsset& asset, const std::string& directory, double seconds) {
+    const std::string playlist = asset.playlistPath(directory);
+    const bool fmp4 = asset.container == "fmp4";
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    AVFormatContext* formatContext = nullptr;
+    if (avformat_alloc_output_context2(&formatContext, nullptr, "hls", playlist.c_str()) < 0 || !formatContext) {
+        std::cerr << "Could not create the HLS muxer for " << playlist << std::endl;
+        return false;
+    }
+
+    OutputStream video;
+    OutputStream audio;
+    AVPacket* packet = av_packet_alloc();
+    bool ok = packet && openVideo(video, formatContext, asset) &&
+              (!asset.audio || openAudio(audio, formatContext));
+
+    if (ok) {
+        AVDictionary* options = nullptr;
+        const std::string segmentPattern = directory + "/" + asset.name + (fmp4 ? "_%03d.m4s" : "_%03d.ts");
+        av_dict_set_int(&options, "hls_time", SEGMENT_SECONDS, 0);
+        av_dict_set(&options, "hls_playlist_type", "vod", 0);
+        av_dict_set(&options, "hls_segment_type", fmp4 ? "fmp4" : "mpegts", 0);
+        av_dict_set(&options, "hls_segment_filename", segmentPattern.c_str(), 0);
+        if (fmp4)
+            av_dict_set(&options, "hls_fmp4_init_filename", (asset.name + "_init.mp4").c_str(), 0);
+
+        ok = avformat_write_header(formatContext, &options) >= 0;
+        av_dict_free(&options);
+        if (!ok)
+            std::cerr << "Could not write the HLS header for " << playlist << std::endl;
+    }
+
+    // Interleave: audio is always encoded up to the video's position
+    const int64_t totalFrames = static_cast<int64_t>(seconds * FRAME_RATE);
+    while (ok && video.nextPts < totalFrames) {
+        if (av_frame_make_writable(video.frame) < 0) {
+            ok = false;
+            break;
+        }
+        fillVideoFrame(video.frame, video.nextPts);
+        video.frame->pts = video.nextPts++;
+        ok = encode(formatContext, video, video.frame, packet);
+
+        while (ok && asset.audio &&
+               audio.nextPts * FRAME_RATE < video.nextPts * AUDIO_SAMPLE_RATE) {
+            if (av_frame_make_writable(audio.frame) < 0) {
+                ok = false;
+                break;
+            }
+            fillAudioFrame(audio.frame, audio.nextPts);
+            audio.frame->pts = audio.nextPts;
+            audio.nextPts += audio.frame->nb_samples;
+            ok = encode(formatContext, audio, audio.frame, packet);
+        }
+    }
+
+    if (ok) {
+        ok = encode(formatContext, video, nullptr, packet) &&
+             (!asset.audio || encode(formatContext, audio, nullptr, packet)) &&
+             av_write_trailer(formatContext) >= 0;
+    }
+
+    closeOutputStream(video);
+    closeOutputStream(audio);
+    av_packet_free(&packet);
+    avformat_free_context(formatContext); // The HLS muxer opens and closes its own files
+
+    if (!ok)
+        std::cerr << "Failed to generate " << playlist << std::endl;
+    return ok;
+}
+
+std::vector<MediaAsset> ladderMediaAssets() {
+    struct Rung { const char* label; int width; int height; };
+    const Rung rungs[] = { { "360p", 640, 360 }, { "720p", 1280, 720 }, { "1080p", 1920, 1080 } };
+
+    std::vector<MediaAsset> assets;
+    for (const Rung& rung : rungs) {
+        MediaAsset asset;
+        asset.name = std::string("ladder_") + rung.label;
+        asset.codec = "h264";
+        asset.container = "ts";
+        asset.width = rung.width;
+        asset.height = rung.height;
+        asset.audio = true;
+        assets.push_back(asset);
+    }
+    return assets;
+}
+
+std::string generateLadder(const std::string& directory, double seconds) {
+    std::ostringstream master;
+    master << "#EXTM3U\n#EXT-X-VERSION:3\n";
+
+    for (const MediaAsset& asset : ladderMediaAssets()) {
+        if (!std::filesystem::exists(asset.playlistPath(directory)) &&
+            !generateMediaAsset(asset, directory, seconds)) {
+            return "";
+        }
+        master << "#EXT-X-STREAM-INF:BANDWIDTH=" << measurePeakBandwidth(asset, directory)
+               << ",RESOLUTION=" << asset.width << "x" << asset.height << "\n"
+               << asset.name << ".m3u8\n";
+    }
+
+    std::ofstream file(directory + "/" + LADDER_PLAYLIST);
+    file << master.str();
+    if (!file) {
+        std::cerr << "Could not write " << directory << "/" << LADDER_PLAYLIST << std::endl;
+        return "";
+    }
+    return LADDER_PLAYLIST;
+}
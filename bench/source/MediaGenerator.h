@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Describes one locally generated HLS test stream.
+ */
+struct MediaAsset {
+    std::string name;        // Also the playlist's file name, without extension
+    std::string codec;       // "h264" or "hevc"
+    std::string container;   // "ts" or "fmp4" segments
+    int width = 0;
+    int height = 0;
+    bool audio = false;      // Adds a stereo AAC track
+
+    std::string playlistPath(const std::string& directory) const;
+};
+
+/**
+ * @brief The benchmark matrix: 480p/1080p/4K x H.264/HEVC x TS/fMP4 x with/without audio.
+ */
+std::vector<MediaAsset> defaultMediaAssets();
+
+/**
+ * @brief Encodes a synthetic moving pattern (and a tone) into an HLS playlist
+ * with FFmpeg's own encoders and HLS muxer. Nothing touches the network.
+ * @param asset What to generate.
+ * @param directory Where the playlist and its segments are written.
+ * @param seconds Duration at 30 fps, with a keyframe and segment every 2 seconds.
+ * @return True on success; false if an encoder is missing or writing failed.
+ */
+bool generateMediaAsset(const MediaAsset& asset, const std::string& directory, double seconds);
+
+/**
+ * @brief An adaptive bitrate ladder: 360p, 720p and 1080p H.264/TS with AAC.
+ * The rungs share frame rate and keyframe interval, so their segments line up.
+ */
+std::vector<MediaAsset> ladderMediaAssets();
+
+/**
+ * @brief Generates the ladder's assets (unless present) and a master playlist
+ * over them. Each BANDWIDTH is measured from the rung's largest segment.
+ * @return The master playlist's file name within `directory`, or an empty
+ * string on failure.
+ */
+std::string generateLadder(const std::string& directory, double seconds);
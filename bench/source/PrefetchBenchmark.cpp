@@ -0,0 +1,133 @@
+#include "PrefetchBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include <V2P/stream/VideoStreamFactory.h>
+
+#include "HttpStandInServer.h"
+#include "MediaGenerator.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct PrefetchResult {
+        std::string asset;
+        bool prefetch = false;
+        uint64_t frames = 0;
+        double openMs = 0.0;
+        double firstFrameMs = 0.0;  // From the start of open()
+        double totalMs = 0.0;
+        double maxFrameGapMs = 0.0;
+        uint64_t requests = 0;
+        PrefetchStats stats;
+    };
+
+    double millisecondsBetween(Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    bool runOnce(const std::string& url, const HttpStandInServer& server, PrefetchResult& result) {
+        StreamOptions options;
+        options.acceptedFormats = { PixelFormat::IYUV, PixelFormat::NV12, PixelFormat::RGBA };
+        options.prefetch.enabled = result.prefetch;
+
+        const uint64_t requestsBefore = server.getRequestCount();
+        auto start = Clock::now();
+        auto streamer = VideoStreamFactory::createVideoStreamer(url, options);
+        if (!streamer || streamer->hasEnded())
+            return false;
+        result.openMs = millisecondsBetween(start, Clock::now());
+
+        VideoFrame frame;
+        Clock::time_point lastFrame;
+        while (true) {
+            // Check for the end first: frames queued before it are still drained
+            bool ended = streamer->hasEnded();
+            if (streamer->getNextVideoFrame(frame)) {
+                auto now = Clock::now();
+                if (result.frames == 0) {
+                    result.firstFrameMs = millisecondsBetween(start, now);
+                } else {
+                    result.maxFrameGapMs = std::max(result.maxFrameGapMs, millisecondsBetween(lastFrame, now));
+                }
+                lastFrame = now;
+                result.frames++;
+                frame.reset();
+            } else if (ended) {
+                break;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        result.totalMs = millisecondsBetween(start, Clock::now());
+        result.stats = streamer->getPrefetchStats();
+        result.requests = server.getRequestCount() - requestsBefore;
+        return true;
+    }
+
+    void writeResult(const PrefetchResult& r, std::ostream& out) {
+        out << "{\"asset\":\"" << r.asset << "\""
+            << ",\"prefetch\":" << (r.prefetch ? "true" : "false")
+            << ",\"active\":" << (r.stats.active ? "true" : "false")
+            << ",\"frames\":" << r.frames
+            << ",\"open_ms\":" << r.openMs
+            << ",\"first_frame_ms\":" << r.firstFrameMs
+            << ",\"total_ms\":" << r.totalMs
+            << ",\"max_frame_gap_ms\":" << r.maxFrameGapMs
+            << ",\"http_requests\":" << r.requests
+            << ",\"segments_fetched\":" << r.stats.segmentsFetched
+            << ",\"fetch_errors\":" << r.stats.fetchErrors
+            << ",\"reader_waits\":" << r.stats.readerWaits
+            << ",\"reader_wait_ms\":" << r.stats.totalWaitMs
+            << "}";
+    }
+}
+
+void runPrefetchBenchmark(const std::string& directory, double seconds, const std::string& filter,
+                          double latencyMs, std::ostream& out) {
+    std::vector<PrefetchResult> results;
+    std::vector<std::string> skipped;
+
+    HttpStandInServer server(directory, latencyMs / 1000.0);
+    bool serving = server.start();
+
+    for (const MediaAsset& asset : defaultMediaAssets()) {
+        if (!serving)
+            break;
+        if (!filter.empty() && asset.name.find(filter) == std::string::npos)
+            continue;
+
+        if (!std::filesystem::exists(asset.playlistPath(directory)) &&
+            !generateMediaAsset(asset, directory, seconds)) {
+            skipped.push_back(asset.name);
+            continue;
+        }
+
+        const std::string url = server.url(asset.name + ".m3u8");
+        for (bool prefetch : { false, true }) {
+            PrefetchResult result;
+            result.asset = asset.name;
+            result.prefetch = prefetch;
+            if (runOnce(url, server, result)) {
+                results.push_back(result);
+            } else {
+                skipped.push_back(asset.name + (prefetch ? "/prefetch" : "/ffmpeg"));
+            }
+        }
+    }
+
+    out << "{\"benchmark\":\"prefetch\",\"latency_ms\":" << latencyMs << ",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        out << (i ? "," : "");
+        writeResult(results[i], out);
+    }
+    out << "],\"skipped\":[";
+    for (size_t i = 0; i < skipped.size(); ++i) {
+        out << (i ? "," : "") << "\"" << skipped[i] << "\"";
+    }
+    out << "]}" << std::endl;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+/**
+ * @brief Compares FFmpeg's HLS demuxer with HlsPrefetcher over a slow network.
+ *
+ * Every asset of defaultMediaAssets() whose name contains `filter` is
+ * generated into `directory` if needed and served by an HttpStandInServer
+ * that delays every request by `latencyMs`. Each asset is then played as
+ * fast as possible twice, with the prefetcher off and on. For each run it
+ * reports the time to open, the time to the first frame, the total time,
+ * the longest gap between two frames (a rebuffer, had it been played in
+ * real time), HTTP requests and the prefetcher's own counters.
+ *
+ * @param directory Where the assets are kept between runs.
+ * @param seconds Duration of generated assets.
+ * @param filter Substring selecting assets; empty selects all.
+ * @param latencyMs Added to every HTTP request.
+ * @param out Stream receiving the results as a JSON object.
+ */
+void runPrefetchBenchmark(const std::string& directory, double seconds, const std::string& filter,
+                          double latencyMs, std::ostream& out);
@@ -0,0 +1,79 @@
+#include "QueueBenchmark.h"
+
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+
+#include <V2P/stream/VideoFrame.h>
+#include <V2P/utils/ThreadSafeFrameQueue.h>
+#include <V2P/utils/SpscRingBuffer.h>
+
+namespace {
+    constexpr size_t QUEUE_CAPACITY = 30;
+
+    enum class ConsumerMode {
+        POLLING,
+        BLOCKING
+    };
+
+    struct QueueResult {
+        std::string queue;
+        ConsumerMode mode;
+        uint64_t items;
+        double seconds;
+    };
+
+    template <typename Queue>
+    QueueResult measure(const std::string& name, Queue& queue, ConsumerMode mode, uint64_t items) {
+        auto start = std::chrono::steady_clock::now();
+
+        std::thread producer([&queue, items]() {
+            for (uint64_t i = 0; i < items; ++i) {
+                VideoFrame frame;
+                frame.timestamp = static_cast<double>(i);
+                queue.push(std::move(frame));
+            }
+        });
+
+        VideoFrame frame;
+        uint64_t received = 0;
+        while (received < items) {
+            bool popped = mode == ConsumerMode::POLLING ? queue.tryPop(frame) : queue.pop(frame);
+            if (popped) {
+                ++received;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+
+        producer.join();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return { name, mode, items, elapsed.count() };
+    }
+}
+
+void runQueueBenchmark(uint64_t items, std::ostream& out) {
+    std::vector<QueueResult> results;
+
+    for (ConsumerMode mode : { ConsumerMode::POLLING, ConsumerMode::BLOCKING }) {
+        ThreadSafeFrameQueue lockedQueue(QUEUE_CAPACITY);
+        results.push_back(measure("ThreadSafeFrameQueue", lockedQueue, mode, items));
+
+        SpscRingBuffer<VideoFrame> ringQueue(QUEUE_CAPACITY);
+        results.push_back(measure("SpscRingBuffer", ringQueue, mode, items));
+    }
+
+    out << "{\"benchmark\":\"queue\",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const QueueResult& r = results[i];
+        out << (i ? "," : "")
+            << "{\"queue\":\"" << r.queue << "\""
+            << ",\"consumer\":\"" << (r.mode == ConsumerMode::POLLING ? "polling" : "blocking") << "\""
+            << ",\"items\":" << r.items
+            << ",\"seconds\":" << r.seconds
+            << ",\"ns_per_item\":" << (r.seconds * 1e9 / static_cast<double>(r.items))
+            << "}";
+    }
+    out << "]}" << std::endl;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @brief Compares ThreadSafeFrameQueue with SpscRingBuffer.
+ *
+ * One producer thread moves VideoFrames through the queue to one consumer,
+ * the same shape as VideoStreamer::run feeding the UI thread. Each queue is
+ * measured with a polling consumer (tryPop, like the UI loop) and a
+ * blocking consumer (pop).
+ *
+ * @param items Number of frames to move through each queue.
+ * @param out Stream receiving the results as a JSON object.
+ */
+void runQueueBenchmark(uint64_t items, std::ostream& out);
@@ -0,0 +1,140 @@
+#include "SeekBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <V2P/managers/PresentationScheduler.h>
+#include <V2P/stream/VideoStreamFactory.h>
+
+#include "HttpStandInServer.h"
+#include "MediaGenerator.h"
+
+namespace {
+    constexpr double TIMEOUT_SECONDS = 30.0;
+
+    // A keyframe seek lands within a GOP before the target; frames are 1/30 s
+    constexpr double GOP_SECONDS = 10.0;
+    constexpr double FRAME_TOLERANCE = 0.05;
+
+    struct SeekResult {
+        const char* mode = "";
+        std::vector<double> seekMs;
+        int failed = 0;
+        SeekStats stats; // The engine's view, after this mode's seeks
+    };
+
+    // Pops frames until one satisfies `accept`, or the stream ends
+    template <typename Accept>
+    bool waitForFrame(VideoStreamer& streamer, Accept accept) {
+        const double deadline = PresentationScheduler::monotonicNow() + TIMEOUT_SECONDS;
+        VideoFrame frame;
+        while (PresentationScheduler::monotonicNow() < deadline) {
+            if (streamer.getNextVideoFrame(frame)) {
+                if (accept(frame.timestamp))
+                    return true;
+                continue;
+            }
+            if (streamer.hasEnded())
+                return false;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        return false;
+    }
+
+    void runSeeks(VideoStreamer& streamer, SeekMode mode, const std::vector<double>& targets, SeekResult& result) {
+        for (double target : targets) {
+            double start = PresentationScheduler::monotonicNow();
+            bool landed = streamer.seek(target, mode) && waitForFrame(streamer, [&](double timestamp) {
+                if (mode == SeekMode::ACCURATE)
+                    return timestamp >= target - FRAME_TOLERANCE && timestamp <= target + FRAME_TOLERANCE;
+                return timestamp <= target + FRAME_TOLERANCE && timestamp >= target - GOP_SECONDS;
+            });
+            if (landed) {
+                result.seekMs.push_back((PresentationScheduler::monotonicNow() - start) * 1000.0);
+            } else {
+                result.failed++;
+            }
+        }
+        result.stats = streamer.getSeekStats();
+    }
+
+    void writeResult(SeekResult r, std::ostream& out) {
+        std::sort(r.seekMs.begin(), r.seekMs.end());
+        double median = r.seekMs.empty() ? 0.0 : r.seekMs[r.seekMs.size() / 2];
+        double worst = r.seekMs.empty() ? 0.0 : r.seekMs.back();
+
+        // Engine counters are cumulative over both modes
+        out << "{\"mode\":\"" << r.mode << "\",\"seeks\":" << r.seekMs.size()
+            << ",\"failed\":" << r.failed
+            << ",\"median_ms\":" << median
+            << ",\"max_ms\":" << worst
+            << ",\"engine_avg_ms\":" << r.stats.averageMs
+            << ",\"indexed_seeks\":" << r.stats.indexedSeeks
+            << ",\"packets_skipped\":" << r.stats.packetsSkipped
+            << ",\"frames_skipped\":" << r.stats.framesSkipped
+            << ",\"keyframes_indexed\":" << r.stats.keyframesIndexed << "}";
+    }
+}
+
+void runSeekBenchmark(const std::string& directory, double seconds, const std::string& filter,
+                      double latencyMs, int seeks, std::ostream& out) {
+    std::vector<SeekResult> results;
+    std::string assetName;
+
+    HttpStandInServer server(directory, latencyMs / 1000.0);
+    for (const MediaAsset& asset : defaultMediaAssets()) {
+        if (asset.name.find(filter) == std::string::npos)
+            continue;
+        if (std::filesystem::exists(asset.playlistPath(directory)) ||
+            generateMediaAsset(asset, directory, seconds)) {
+            assetName = asset.name;
+        }
+        break;
+    }
+
+    if (!assetName.empty() && server.start()) {
+        StreamOptions options;
+        options.acceptedFormats = { PixelFormat::IYUV, PixelFormat::NV12, PixelFormat::RGBA };
+        std::unique_ptr<VideoStreamer> streamer =
+            VideoStreamFactory::createVideoStreamer(server.url(assetName + ".m3u8"), options);
+
+        // Play nearly to the end, so that every target is in the index
+        double first = -1.0;
+        bool played = streamer && waitForFrame(*streamer, [&](double timestamp) {
+            if (first < 0.0)
+                first = timestamp;
+            return timestamp >= first + seconds * 0.9;
+        });
+
+        if (played) {
+            std::mt19937 random(1);
+            std::uniform_real_distribution<double> position(first, first + seconds * 0.8);
+            std::vector<double> targets(static_cast<size_t>(std::max(seeks, 0)));
+            for (double& target : targets)
+                target = position(random);
+
+            SeekResult keyframe;
+            keyframe.mode = "keyframe";
+            runSeeks(*streamer, SeekMode::KEYFRAME, targets, keyframe);
+            results.push_back(keyframe);
+
+            SeekResult accurate;
+            accurate.mode = "accurate";
+            runSeeks(*streamer, SeekMode::ACCURATE, targets, accurate);
+            results.push_back(accurate);
+        }
+    }
+
+    out << "{\"benchmark\":\"seek\",\"asset\":\"" << assetName << "\",\"latency_ms\":" << latencyMs
+        << ",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        out << (i ? "," : "");
+        writeResult(results[i], out);
+    }
+    out << "]}" << std::endl;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+/**
+ * @brief Measures seeking in a VOD stream: how long after a seek the first
+ * frame at the new position comes out of the decoder.
+ *
+ * The first asset of defaultMediaAssets() whose name contains `filter` is
+ * served by an HttpStandInServer adding `latencyMs` per request and played
+ * once to the end, which fills the stream's keyframe index. Then it is
+ * sought to `seeks` random positions, in SeekMode::KEYFRAME and in
+ * SeekMode::ACCURATE. A keyframe seek counts once a frame at or before the
+ * target arrives; an accurate one once the frame at the target does.
+ *
+ * @param directory Where the assets are kept between runs.
+ * @param seconds Duration of generated assets.
+ * @param filter Substring selecting the asset; it must be MPEG-TS.
+ * @param latencyMs Added to every HTTP request.
+ * @param seeks Seeks per mode.
+ * @param out Stream receiving the results as a JSON object.
+ */
+void runSeekBenchmark(const std::string& directory, double seconds, const std::string& filter,
+                      double latencyMs, int seeks, std::ostream& out);
@@ -0,0 +1,122 @@
+#include "StartupBenchmark.h"
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include <V2P/managers/PresentationScheduler.h>
+#include <V2P/stream/CodecParameterCache.h>
+#include <V2P/stream/VideoStreamFactory.h>
+
+#include "HttpStandInServer.h"
+#include "MediaGenerator.h"
+
+namespace {
+    constexpr double VSYNC_INTERVAL = 1.0 / 60.0;
+    constexpr double TIMEOUT_SECONDS = 30.0;
+    constexpr size_t MILESTONE_COUNT = static_cast<size_t>(StartupMilestone::COUNT);
+
+    struct StartupResult {
+        std::string asset;
+        const char* mode = "";
+        std::array<int64_t, MILESTONE_COUNT> startup = {};
+    };
+
+    bool runOnce(const std::string& url, bool fastStart, StartupResult& result) {
+        StreamOptions options;
+        options.acceptedFormats = { PixelFormat::IYUV, PixelFormat::NV12, PixelFormat::RGBA };
+        options.startup.fastStart = fastStart;
+        options.startup.asyncOpen = fastStart;
+
+        auto streamer = VideoStreamFactory::createVideoStreamer(url, options);
+        if (!streamer)
+            return false;
+
+        // Presents against a virtual vsync until the first frame goes up
+        PresentationScheduler scheduler;
+        scheduler.addStream(streamer.get());
+        const double deadline = PresentationScheduler::monotonicNow() + TIMEOUT_SECONDS;
+        bool presented = false;
+        while (!presented) {
+            double now = PresentationScheduler::monotonicNow();
+            if (now > deadline || streamer->hasEnded())
+                break;
+            scheduler.tick(now, now + VSYNC_INTERVAL);
+            presented = scheduler.getCurrentFrame(streamer.get()) != nullptr;
+            if (!presented) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        result.startup = streamer->getMetrics()->snapshot().startup;
+        return presented;
+    }
+
+    void writeResult(const StartupResult& r, std::ostream& out) {
+        out << "{\"asset\":\"" << r.asset << "\",\"mode\":\"" << r.mode << "\",\"startup_ms\":{";
+        bool first = true;
+        for (size_t i = 0; i < MILESTONE_COUNT; ++i) {
+            if (r.startup[i] < 0)
+                continue;
+            out << (first ? "" : ",") << "\"" << toString(static_cast<StartupMilestone>(i)) << "\":"
+                << static_cast<double>(r.startup[i]) / 1e6;
+            first = false;
+        }
+        out << "}}";
+    }
+}
+
+void runStartupBenchmark(const std::string& directory, double seconds, const std::string& filter,
+                         double latencyMs, std::ostream& out) {
+    std::vector<StartupResult> results;
+    std::vector<std::string> skipped;
+
+    HttpStandInServer server(directory, latencyMs / 1000.0);
+    bool serving = server.start();
+
+    for (const MediaAsset& asset : defaultMediaAssets()) {
+        if (!serving)
+            break;
+        if (!filter.empty() && asset.name.find(filter) == std::string::npos)
+            continue;
+
+        if (!std::filesystem::exists(asset.playlistPath(directory)) &&
+            !generateMediaAsset(asset, directory, seconds)) {
+            skipped.push_back(asset.name);
+            continue;
+        }
+
+        const std::string url = server.url(asset.name + ".m3u8");
+        const struct { const char* mode; bool fastStart; bool clearCache; } runs[] = {
+            { "default", false, true },
+            { "fast_cold", true, true },
+            { "fast_warm", true, false },
+        };
+        for (const auto& run : runs) {
+            if (run.clearCache) {
+                CodecParameterCache::global().clear();
+            }
+            StartupResult result;
+            result.asset = asset.name;
+            result.mode = run.mode;
+            if (runOnce(url, run.fastStart, result)) {
+                results.push_back(result);
+            } else {
+                skipped.push_back(asset.name + "/" + run.mode);
+            }
+        }
+    }
+
+    out << "{\"benchmark\":\"startup\",\"latency_ms\":" << latencyMs << ",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        out << (i ? "," : "");
+        writeResult(results[i], out);
+    }
+    out << "],\"skipped\":[";
+    for (size_t i = 0; i < skipped.size(); ++i) {
+        out << (i ? "," : "") << "\"" << skipped[i] << "\"";
+    }
+    out << "]}" << std::endl;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+/**
+ * @brief Measures time to first frame, broken down by startup milestone
+ * (see StartupMilestone), over a slow network.
+ *
+ * Every asset of defaultMediaAssets() whose name contains `filter` is
+ * served by an HttpStandInServer adding `latencyMs` per request, and
+ * opened three times: with default settings, with StartupConfig::fastStart
+ * and an empty CodecParameterCache, and with fastStart again once the cache
+ * knows the stream. Each run ends when a PresentationScheduler first picks
+ * a frame.
+ *
+ * @param directory Where the assets are kept between runs.
+ * @param seconds Duration of generated assets.
+ * @param filter Substring selecting assets; empty selects all.
+ * @param latencyMs Added to every HTTP request.
+ * @param out Stream receiving the results as a JSON object.
+ */
+void runStartupBenchmark(const std::string& directory, double seconds, const std::string& filter,
+                         double latencyMs, std::ostream& out);
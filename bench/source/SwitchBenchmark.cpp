@@ -0,0 +1,138 @@
+#include "SwitchBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <V2P/managers/VideoStreamManager.h>
+#include <V2P/stream/VideoStreamFactory.h>
+
+#include "HttpStandInServer.h"
+#include "MediaGenerator.h"
+
+namespace {
+    constexpr double VSYNC_INTERVAL = 1.0 / 60.0;
+    constexpr double TIMEOUT_SECONDS = 30.0;
+
+    // Longer than the assets' keyframe interval, so a demoted stream holds a
+    // GOP again by the time it is promoted
+    constexpr double WATCH_SECONDS = 3.0;
+
+    struct SwitchResult {
+        const char* mode = "";
+        std::vector<double> switchMs;
+        int failed = 0;
+    };
+
+    StreamOptions switchOptions() {
+        StreamOptions options;
+        options.acceptedFormats = { PixelFormat::IYUV, PixelFormat::NV12, PixelFormat::RGBA };
+        options.startup.fastStart = true;
+        options.startup.asyncOpen = true;
+        return options;
+    }
+
+    // Ticks the manager against a virtual vsync for `seconds`, or until stream
+    // 0 shows a frame if `untilShown`; returns whether it did
+    bool present(VideoStreamManager& manager, double seconds, bool untilShown) {
+        const double deadline = PresentationScheduler::monotonicNow() + seconds;
+        while (PresentationScheduler::monotonicNow() < deadline) {
+            double now = PresentationScheduler::monotonicNow();
+            manager.updateAll(now, now + VSYNC_INTERVAL);
+            if (untilShown && manager.getFrame(0) != nullptr)
+                return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return !untilShown;
+    }
+
+    void runCold(const std::string& url, int switches, SwitchResult& result) {
+        // Each switch tears the old stream down and opens the next from
+        // scratch; the first open only starts playback
+        std::unique_ptr<VideoStreamManager> manager;
+        for (int i = 0; i <= switches; ++i) {
+            double start = PresentationScheduler::monotonicNow();
+            manager.reset();
+            manager = std::make_unique<VideoStreamManager>();
+            bool shown = manager->addStream(url, switchOptions()) && present(*manager, TIMEOUT_SECONDS, true);
+            if (i > 0 && shown) {
+                result.switchMs.push_back((PresentationScheduler::monotonicNow() - start) * 1000.0);
+            } else if (i > 0) {
+                result.failed++;
+            }
+            present(*manager, WATCH_SECONDS, false);
+        }
+    }
+
+    void runWarm(const std::string& url, int switches, SwitchResult& result) {
+        VideoStreamManager manager;
+        manager.setStandbyLimit(1);
+        if (!manager.addStream(url, switchOptions()) || !manager.addStandby(url, switchOptions()))
+            return;
+        present(manager, WATCH_SECONDS, false);
+
+        // The replaced stream becomes the standby for the next switch
+        for (int i = 0; i < switches; ++i) {
+            double start = PresentationScheduler::monotonicNow();
+            if (manager.promote(manager.getStandby(0), 0) && present(manager, TIMEOUT_SECONDS, true)) {
+                result.switchMs.push_back((PresentationScheduler::monotonicNow() - start) * 1000.0);
+            } else {
+                result.failed++;
+            }
+            present(manager, WATCH_SECONDS, false);
+        }
+    }
+
+    void writeResult(SwitchResult r, std::ostream& out) {
+        std::sort(r.switchMs.begin(), r.switchMs.end());
+        double median = r.switchMs.empty() ? 0.0 : r.switchMs[r.switchMs.size() / 2];
+        double worst = r.switchMs.empty() ? 0.0 : r.switchMs.back();
+
+        out << "{\"mode\":\"" << r.mode << "\",\"switches\":" << r.switchMs.size()
+            << ",\"failed\":" << r.failed
+            << ",\"median_ms\":" << median
+            << ",\"max_ms\":" << worst << "}";
+    }
+}
+
+void runSwitchBenchmark(const std::string& directory, double seconds, const std::string& filter,
+                        double latencyMs, int switches, std::ostream& out) {
+    std::vector<SwitchResult> results;
+    std::string assetName;
+
+    HttpStandInServer server(directory, latencyMs / 1000.0);
+    for (const MediaAsset& asset : defaultMediaAssets()) {
+        if (asset.name.find(filter) == std::string::npos)
+            continue;
+        if (std::filesystem::exists(asset.playlistPath(directory)) ||
+            generateMediaAsset(asset, directory, seconds)) {
+            assetName = asset.name;
+        }
+        break;
+    }
+
+    if (!assetName.empty() && server.start()) {
+        const std::string url = server.url(assetName + ".m3u8");
+
+        SwitchResult cold;
+        cold.mode = "cold";
+        runCold(url, switches, cold);
+        results.push_back(cold);
+
+        SwitchResult warm;
+        warm.mode = "warm";
+        runWarm(url, switches, warm);
+        results.push_back(warm);
+    }
+
+    out << "{\"benchmark\":\"switch\",\"asset\":\"" << assetName << "\",\"latency_ms\":" << latencyMs
+        << ",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        out << (i ? "," : "");
+        writeResult(results[i], out);
+    }
+    out << "]}" << std::endl;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+/**
+ * @brief Measures channel switching: how long after the switch the new
+ * channel's first frame is picked for display.
+ *
+ * The first asset of defaultMediaAssets() whose name contains `filter` is
+ * served by an HttpStandInServer adding `latencyMs` per request, and
+ * switched to `switches` times in two ways:
+ * - cold: a new stream is created with StartupConfig::fastStart, as a
+ *   player without standby streams would;
+ * - warm: VideoStreamManager::promote() swaps in a standby stream that has
+ *   been demuxing for a while, and keeps the replaced one as the next standby.
+ *
+ * @param directory Where the assets are kept between runs.
+ * @param seconds Duration of generated assets.
+ * @param filter Substring selecting the asset.
+ * @param latencyMs Added to every HTTP request.
+ * @param switches Switches per mode.
+ * @param out Stream receiving the results as a JSON object.
+ */
+void runSwitchBenchmark(const std::string& directory, double seconds, const std::string& filter,
+                        double latencyMs, int switches, std::ostream& out);
@@ -0,0 +1,141 @@
+#include "WriterBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include <V2P/writer/VideoWriter.h>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace {
+    constexpr int WIDTH = 1280;
+    constexpr int HEIGHT = 720;
+    constexpr int FRAME_RATE = 30;
+
+    struct WriterResult {
+        const char* overflow = "";
+        bool ok = false;
+        int frames = 0;
+        double seconds = 0.0;
+        double writeAvgUs = 0.0;
+        double writeMaxUs = 0.0;
+        WriterStats stats;
+    };
+
+    // A moving gradient, so that the encoder has something to do
+    void fillFrame(AVFrame* frame, int index) {
+        for (int y = 0; y < frame->height; ++y) {
+            uint8_t* row = frame->data[0] + static_cast<ptrdiff_t>(y) * frame->linesize[0];
+            for (int x = 0; x < frame->width; ++x) {
+                row[x * 4 + 0] = static_cast<uint8_t>(x + index * 4);
+                row[x * 4 + 1] = static_cast<uint8_t>(y + index * 2);
+                row[x * 4 + 2] = static_cast<uint8_t>(x + y);
+                row[x * 4 + 3] = 255;
+            }
+        }
+    }
+
+    WriterResult runWriter(const std::string& path, WriterOverflow overflow, int frames) {
+        WriterResult result;
+        result.overflow = overflow == WriterOverflow::DROP ? "drop" : "block";
+        result.frames = frames;
+
+        WriterConfig config;
+        config.async = true;
+        config.overflow = overflow;
+        config.preset = "veryfast";
+
+        VideoWriter writer;
+        writer.setConfig(config);
+        AVFrame* frame = av_frame_alloc();
+        if (!frame) {
+            return result;
+        }
+        frame->width = WIDTH;
+        frame->height = HEIGHT;
+        frame->format = AV_PIX_FMT_RGBA;
+        if (av_frame_get_buffer(frame, 0) < 0 ||
+            !writer.open(path, WIDTH, HEIGHT, AVRational{ 1, FRAME_RATE }, AV_PIX_FMT_RGBA)) {
+            av_frame_free(&frame);
+            return result;
+        }
+
+        bool written = true;
+        double totalUs = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames && written; ++i) {
+            // The previous frame may still be queued: refill a buffer of our own
+            if (av_frame_make_writable(frame) < 0) {
+                written = false;
+                break;
+            }
+            fillFrame(frame, i);
+
+            auto writeStart = std::chrono::steady_clock::now();
+            written = writer.writeFrame(frame);
+            std::chrono::duration<double, std::micro> writeTime = std::chrono::steady_clock::now() - writeStart;
+            totalUs += writeTime.count();
+            result.writeMaxUs = std::max(result.writeMaxUs, writeTime.count());
+        }
+        const bool closed = writer.close();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        av_frame_free(&frame);
+
+        result.seconds = elapsed.count();
+        result.writeAvgUs = frames > 0 ? totalUs / frames : 0.0;
+        result.stats = writer.getStats();
+
+        // Every frame is either queued or, under DROP, dropped; every queued one is encoded
+        const WriterStats& s = result.stats;
+        const bool counted = s.framesQueued + s.framesDropped == static_cast<uint64_t>(frames) &&
+                             s.framesEncoded == s.framesQueued && s.packetsWritten > 0 &&
+                             (overflow == WriterOverflow::DROP || s.framesDropped == 0);
+        result.ok = written && closed && counted;
+        if (!result.ok) {
+            std::cerr << "Writer benchmark (" << result.overflow << ") failed: queued " << s.framesQueued
+                      << ", dropped " << s.framesDropped << ", encoded " << s.framesEncoded
+                      << " of " << frames << " frames." << std::endl;
+        }
+        return result;
+    }
+
+    void writeResult(const WriterResult& r, std::ostream& out) {
+        const WriterStats& s = r.stats;
+        out << "{\"overflow\":\"" << r.overflow << "\",\"ok\":" << (r.ok ? "true" : "false")
+            << ",\"frames\":" << r.frames
+            << ",\"seconds\":" << r.seconds
+            << ",\"write_avg_us\":" << r.writeAvgUs
+            << ",\"write_max_us\":" << r.writeMaxUs
+            << ",\"frames_queued\":" << s.framesQueued
+            << ",\"frames_dropped\":" << s.framesDropped
+            << ",\"frames_encoded\":" << s.framesEncoded
+            << ",\"packets_written\":" << s.packetsWritten
+            << ",\"max_queue_depth\":" << s.maxQueueDepth
+            << ",\"encode_fps\":" << s.encodeFps << "}";
+    }
+}
+
+bool runWriterBenchmark(const std::string& directory, int frames, std::ostream& out) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    std::vector<WriterResult> results;
+    results.push_back(runWriter(directory + "/writer_block.mp4", WriterOverflow::BLOCK, frames));
+    results.push_back(runWriter(directory + "/writer_drop.mp4", WriterOverflow::DROP, frames));
+
+    bool ok = true;
+    out << "{\"benchmark\":\"writer\",\"width\":" << WIDTH << ",\"height\":" << HEIGHT << ",\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        out << (i ? "," : "");
+        writeResult(results[i], out);
+        ok = ok && results[i].ok;
+    }
+    out << "]}" << std::endl;
+    return ok;
+}
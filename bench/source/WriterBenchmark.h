@@ -0,0 +1,22 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+/**
+ * @brief Measures the asynchronous VideoWriter under both overflow policies.
+ *
+ * `frames` RGBA frames at 1280x720 are written as fast as possible, so
+ * that the encoder falls behind, once with WriterOverflow::BLOCK and once
+ * with WriterOverflow::DROP. The caller refills one AVFrame, making it
+ * writable before every write as VideoWriter::writeFrame() asks. For each
+ * run it reports how long writeFrame() held the caller up and the
+ * writer's own counters (see WriterStats).
+ *
+ * @param directory Where the files are written.
+ * @param frames Frames per run.
+ * @param out Stream receiving the results as a JSON object.
+ * @return False if a run failed, or its counters do not add up: BLOCK
+ * must encode every frame, and DROP every frame it did not drop.
+ */
+bool runWriterBenchmark(const std::string& directory, int frames, std::ostream& out);
@@ -0,0 +1,107 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "QueueBenchmark.h"
+#include "DecodeBenchmark.h"
+#include "PrefetchBenchmark.h"
+#include "AbrBenchmark.h"
+#include "StartupBenchmark.h"
+#include "SwitchBenchmark.h"
+#include "SeekBenchmark.h"
+#include "WriterBenchmark.h"
+#include "MediaGenerator.h"
+
+namespace {
+    void printUsage() {
+        std::cerr << "Usage: V2P_Bench queue [items]\n"
+                  << "       V2P_Bench decode <asset dir> [seconds] [asset filter]\n"
+                  << "       V2P_Bench generate <asset dir> [seconds]\n"
+                  << "       V2P_Bench prefetch <asset dir> [seconds] [asset filter] [latency ms]\n"
+                  << "       V2P_Bench abr <asset dir> [seconds] [link kbps]\n"
+                  << "       V2P_Bench startup <asset dir> [seconds] [asset filter] [latency ms]\n"
+                  << "       V2P_Bench switch <asset dir> [seconds] [asset filter] [latency ms] [switches]\n"
+                  << "       V2P_Bench seek <asset dir> [seconds] [asset filter] [latency ms] [seeks]\n"
+                  << "       V2P_Bench writer <output dir> [frames]" << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    // Results go to stdout; the engine's own logging is moved to stderr so
+    // the JSON can be piped straight into a file.
+    std::ostream results(std::cout.rdbuf());
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    const std::string benchmark = argv[1];
+    if (benchmark == "queue") {
+        uint64_t items = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2'000'000;
+        runQueueBenchmark(items, results);
+        return 0;
+    }
+
+    if (benchmark == "prefetch" && argc > 2) {
+        double seconds = argc > 3 ? std::strtod(argv[3], nullptr) : 10.0;
+        double latencyMs = argc > 5 ? std::strtod(argv[5], nullptr) : 100.0;
+        runPrefetchBenchmark(argv[2], seconds, argc > 4 ? argv[4] : "h264_480p", latencyMs, results);
+        return 0;
+    }
+
+    if (benchmark == "startup" && argc > 2) {
+        double seconds = argc > 3 ? std::strtod(argv[3], nullptr) : 10.0;
+        double latencyMs = argc > 5 ? std::strtod(argv[5], nullptr) : 100.0;
+        runStartupBenchmark(argv[2], seconds, argc > 4 ? argv[4] : "h264_480p", latencyMs, results);
+        return 0;
+    }
+
+    if (benchmark == "switch" && argc > 2) {
+        double seconds = argc > 3 ? std::strtod(argv[3], nullptr) : 60.0;
+        double latencyMs = argc > 5 ? std::strtod(argv[5], nullptr) : 100.0;
+        int switches = argc > 6 ? std::atoi(argv[6]) : 5;
+        runSwitchBenchmark(argv[2], seconds, argc > 4 ? argv[4] : "h264_480p", latencyMs, switches, results);
+        return 0;
+    }
+
+    if (benchmark == "seek" && argc > 2) {
+        double seconds = argc > 3 ? std::strtod(argv[3], nullptr) : 60.0;
+        double latencyMs = argc > 5 ? std::strtod(argv[5], nullptr) : 100.0;
+        int seeks = argc > 6 ? std::atoi(argv[6]) : 20;
+        runSeekBenchmark(argv[2], seconds, argc > 4 ? argv[4] : "h264_480p_ts", latencyMs, seeks, results);
+        return 0;
+    }
+
+    if (benchmark == "writer" && argc > 2) {
+        int frames = argc > 3 ? std::atoi(argv[3]) : 300;
+        return runWriterBenchmark(argv[2], frames, results) ? 0 : 1;
+    }
+
+    if (benchmark == "abr" && argc > 2) {
+        double seconds = argc > 3 ? std::strtod(argv[3], nullptr) : 30.0;
+        double linkKbps = argc > 4 ? std::strtod(argv[4], nullptr) : 1500.0;
+        runAbrBenchmark(argv[2], seconds, linkKbps, results);
+        return 0;
+    }
+
+    if ((benchmark == "decode" || benchmark == "generate") && argc > 2) {
+        const std::string directory = argv[2];
+        double seconds = argc > 3 ? std::strtod(argv[3], nullptr) : 10.0;
+
+        if (benchmark == "decode") {
+            return runDecodeBenchmark(directory, seconds, argc > 4 ? argv[4] : "", results) ? 0 : 1;
+        }
+
+        bool ok = true;
+        for (const MediaAsset& asset : defaultMediaAssets()) {
+            ok = generateMediaAsset(asset, directory, seconds) && ok;
+        }
+        return ok ? 0 : 1;
+    }
+
+    printUsage();
+    return 1;
+}
@@ -0,0 +1,111 @@
+#include "AbrController.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+AbrController::AbrController(std::vector<HlsVariant> variants, const PrefetchConfig& config)
+    : variants(std::move(variants)),
+      initialBandwidth(config.initialBandwidth),
+      safety(std::clamp(config.bandwidthSafety, 0.1, 1.0)) {
+    byBandwidth.resize(this->variants.size());
+    std::iota(byBandwidth.begin(), byBandwidth.end(), 0);
+    std::stable_sort(byBandwidth.begin(), byBandwidth.end(), [this](int a, int b) {
+        return this->variants[a].bandwidth < this->variants[b].bandwidth;
+    });
+}
+
+void AbrController::addSample(size_t bytes, double seconds, int concurrentFetches) {
+    if (bytes == 0 || seconds <= 0.0)
+        return;
+
+    // Parallel downloads split the link, so each saw a share of it
+    double bitsPerSecond = static_cast<double>(bytes) * 8.0 * std::max(concurrentFetches, 1) / seconds;
+    if (!measured) {
+        fastEstimate = slowEstimate = bitsPerSecond;
+        measured = true;
+        return;
+    }
+
+    // Weighted by download time, so a long segment counts for more than a short one
+    double fastAlpha = 1.0 - std::pow(0.5, seconds / FAST_HALF_LIFE);
+    double slowAlpha = 1.0 - std::pow(0.5, seconds / SLOW_HALF_LIFE);
+    fastEstimate += fastAlpha * (bitsPerSecond - fastEstimate);
+    slowEstimate += slowAlpha * (bitsPerSecond - slowEstimate);
+}
+
+double AbrController::getBandwidthEstimate() const {
+    // The fast average reacts to drops, the slow one keeps a spike from counting
+    return measured ? std::min(fastEstimate, slowEstimate) : initialBandwidth;
+}
+
+int AbrController::initialVariant(int displayWidth, int displayHeight) const {
+    if (variants.empty())
+        return -1;
+    int maxRank = maxRankForDisplay(displayWidth, displayHeight);
+    return byBandwidth[highestRankWithin(initialBandwidth * safety, maxRank)];
+}
+
+int AbrController::select(int current, const AbrInputs& inputs) {
+    if (variants.empty())
+        return current;
+    decisionsSinceSwitch++;
+
+    const int currentRank = rankOf(current);
+    const double buffered = inputs.bufferedSeconds();
+
+    double allowed = getBandwidthEstimate() * safety;
+    if (buffered < LOW_BUFFER_SECONDS) {
+        allowed *= LOW_BUFFER_SAFETY;
+    }
+    int targetRank = highestRankWithin(allowed, maxRankForDisplay(inputs.displayWidth, inputs.displayHeight));
+
+    // The network keeps up but the client is starved: decoding is too slow
+    bool starved = inputs.decodedFrames >= 0 && inputs.decodedFrames <= STARVED_FRAMES &&
+                   inputs.demuxedSeconds >= STARVED_DEMUXED_SECONDS;
+    starvedDecisions = starved ? starvedDecisions + 1 : 0;
+    if (starvedDecisions >= STARVED_DECISIONS) {
+        targetRank = std::min(targetRank, std::max(currentRank - 1, 0));
+    }
+
+    if (targetRank > currentRank &&
+        (buffered < UPSWITCH_BUFFER_SECONDS || decisionsSinceSwitch < UPSWITCH_INTERVAL)) {
+        targetRank = currentRank;
+    }
+
+    if (targetRank != currentRank) {
+        decisionsSinceSwitch = 0;
+        starvedDecisions = 0;
+    }
+    return byBandwidth[targetRank];
+}
+
+int AbrController::rankOf(int variant) const {
+    auto it = std::find(byBandwidth.begin(), byBandwidth.end(), variant);
+    return it == byBandwidth.end() ? 0 : static_cast<int>(it - byBandwidth.begin());
+}
+
+int AbrController::highestRankWithin(double bandwidth, int maxRank) const {
+    // The lowest rung is kept even when it does not fit: stalling is worse
+    int rank = 0;
+    for (int i = 1; i <= maxRank; ++i) {
+        if (variants[byBandwidth[i]].bandwidth <= bandwidth) {
+            rank = i;
+        }
+    }
+    return rank;
+}
+
+int AbrController::maxRankForDisplay(int displayWidth, int displayHeight) const {
+    const int highest = static_cast<int>(byBandwidth.size()) - 1;
+    if (displayWidth <= 0 || displayHeight <= 0)
+        return highest;
+
+    // The lowest rung that fills the tile; variants without a RESOLUTION are skipped
+    for (int rank = 0; rank <= highest; ++rank) {
+        const HlsVariant& variant = variants[byBandwidth[rank]];
+        if (variant.height > 0 && (variant.width >= displayWidth || variant.height >= displayHeight))
+            return rank;
+    }
+    return highest;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "V2P/hls/HlsPlaylist.h"
+#include "V2P/stream/PrefetchConfig.h"
+
+/**
+ * @brief What the ABR looks at when it picks a variant.
+ */
+struct AbrInputs {
+    double prefetchedSeconds = 0.0; // Fetched segments the demuxer has not read yet
+    double demuxedSeconds = 0.0;    // Compressed video waiting for the decoder
+    int decodedFrames = -1;         // Frames waiting for the client; -1 if unknown
+
+    // Size the stream is drawn at; 0 if unknown
+    int displayWidth = 0;
+    int displayHeight = 0;
+
+    double bufferedSeconds() const { return prefetchedSeconds + demuxedSeconds; }
+};
+
+/**
+ * @brief Picks the variant of a master playlist to fetch next.
+ *
+ * Three limits apply, and the lowest wins:
+ * - Bandwidth: a dual EWMA (fast and slow, the lower counts) of segment
+ *   download throughput; a variant may use PrefetchConfig::bandwidthSafety
+ *   of it, less while the buffer runs low.
+ * - Tile size: nothing taller than the smallest variant covering the
+ *   display, so small tiles do not pay for pixels they cannot show.
+ * - Decoder: if the client's frame queue keeps running dry while
+ *   compressed video piles up, decoding is the bottleneck, and the
+ *   variant steps down one rung.
+ * Switching down is immediate; switching up waits for a healthy buffer.
+ *
+ * Not thread-safe; HlsPrefetcher calls it under its lock.
+ */
+class AbrController {
+public:
+    AbrController(std::vector<HlsVariant> variants, const PrefetchConfig& config);
+
+    /**
+     * @brief Adds one segment download.
+     * @param concurrentFetches Downloads that shared the link with it, itself included.
+     */
+    void addSample(size_t bytes, double seconds, int concurrentFetches);
+
+    /**
+     * @brief Measured throughput in bits per second; the configured initial
+     * bandwidth until a sample arrives.
+     */
+    double getBandwidthEstimate() const;
+
+    /**
+     * @brief The variant to start with, before anything is measured.
+     */
+    int initialVariant(int displayWidth, int displayHeight) const;
+
+    /**
+     * @brief The variant to fetch the next segments from.
+     * @param current Index into the variants given at construction.
+     */
+    int select(int current, const AbrInputs& inputs);
+
+private:
+    static constexpr double FAST_HALF_LIFE = 3.0;  // Seconds of download time
+    static constexpr double SLOW_HALF_LIFE = 9.0;
+    static constexpr double LOW_BUFFER_SECONDS = 3.0;
+    static constexpr double LOW_BUFFER_SAFETY = 0.6;  // Extra factor on the safety while low
+    static constexpr double UPSWITCH_BUFFER_SECONDS = 6.0;
+    static constexpr int UPSWITCH_INTERVAL = 3;    // Decisions between two switches up
+    static constexpr int STARVED_DECISIONS = 3;    // Consecutive dry-queue decisions before stepping down
+    static constexpr int STARVED_FRAMES = 1;
+    static constexpr double STARVED_DEMUXED_SECONDS = 1.0;
+
+    // Rank: position in bandwidth order
+    int rankOf(int variant) const;
+    int highestRankWithin(double bandwidth, int maxRank) const;
+    int maxRankForDisplay(int displayWidth, int displayHeight) const;
+
+    std::vector<HlsVariant> variants;
+    std::vector<int> byBandwidth; // Variant indices, lowest bandwidth first
+    double initialBandwidth;
+    double safety;
+
+    double fastEstimate = 0.0;
+    double slowEstimate = 0.0;
+    bool measured = false;
+
+    int starvedDecisions = 0;
+    int decisionsSinceSwitch = 0;
+};
@@ -0,0 +1,169 @@
+#include "HlsPlaylist.h"
+
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+namespace {
+    bool startsWith(const std::string& text, const char* prefix) {
+        return text.rfind(prefix, 0) == 0;
+    }
+
+    std::string afterColon(const std::string& line) {
+        size_t colon = line.find(':');
+        return colon == std::string::npos ? std::string() : line.substr(colon + 1);
+    }
+
+    // KEY=value,KEY="quoted, value",... as in EXT-X-STREAM-INF and EXT-X-MEDIA
+    std::map<std::string, std::string> parseAttributes(const std::string& list) {
+        std::map<std::string, std::string> attributes;
+        size_t pos = 0;
+        while (pos < list.size()) {
+            size_t equals = list.find('=', pos);
+            if (equals == std::string::npos)
+                break;
+
+            std::string key = list.substr(pos, equals - pos);
+            std::string value;
+            size_t end;
+            if (equals + 1 < list.size() && list[equals + 1] == '"') {
+                size_t close = list.find('"', equals + 2);
+                if (close == std::string::npos)
+                    close = list.size();
+                value = list.substr(equals + 2, close - equals - 2);
+                end = list.find(',', close);
+            } else {
+                end = list.find(',', equals + 1);
+                value = list.substr(equals + 1, end == std::string::npos ? std::string::npos : end - equals - 1);
+            }
+
+            attributes[key] = value;
+            if (end == std::string::npos)
+                break;
+            pos = end + 1;
+        }
+        return attributes;
+    }
+}
+
+std::string resolveUrl(const std::string& baseUrl, const std::string& reference) {
+    if (reference.find("://") != std::string::npos)
+        return reference;
+
+    // The base's query string is not part of its directory
+    std::string base = baseUrl.substr(0, baseUrl.find('?'));
+
+    if (startsWith(reference, "/")) {
+        size_t scheme = base.find("://");
+        if (scheme == std::string::npos)
+            return reference; // Local absolute path
+        size_t hostEnd = base.find('/', scheme + 3);
+        return base.substr(0, hostEnd) + reference;
+    }
+
+    size_t slash = base.rfind('/');
+    return slash == std::string::npos ? reference : base.substr(0, slash + 1) + reference;
+}
+
+bool HlsPlaylist::parse(const std::string& text, const std::string& baseUrl, HlsPlaylist& out) {
+    out = HlsPlaylist();
+
+    std::istringstream lines(text);
+    std::string line;
+    bool sawHeader = false;
+
+    // Tags that apply to the next URI line
+    HlsVariant pendingVariant;
+    bool variantPending = false;
+    double pendingDuration = 0.0;
+    bool pendingDiscontinuity = false;
+    std::string currentInit;
+    int64_t nextSequence = 0;
+
+    while (std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+
+        if (!sawHeader) {
+            // A byte order mark may precede the header
+            if (startsWith(line, "\xEF\xBB\xBF"))
+                line.erase(0, 3);
+            if (!startsWith(line, "#EXTM3U"))
+                return false;
+            sawHeader = true;
+            continue;
+        }
+
+        if (startsWith(line, "#EXT-X-STREAM-INF:")) {
+            auto attributes = parseAttributes(afterColon(line));
+            pendingVariant = HlsVariant();
+            pendingVariant.bandwidth = std::atoll(attributes["BANDWIDTH"].c_str());
+            pendingVariant.codecs = attributes["CODECS"];
+            pendingVariant.audioGroup = attributes["AUDIO"];
+            const std::string& resolution = attributes["RESOLUTION"];
+            size_t x = resolution.find('x');
+            if (x != std::string::npos) {
+                pendingVariant.width = std::atoi(resolution.substr(0, x).c_str());
+                pendingVariant.height = std::atoi(resolution.substr(x + 1).c_str());
+            }
+            variantPending = true;
+            out.isMaster = true;
+        }
+        else if (startsWith(line, "#EXT-X-MEDIA:")) {
+            auto attributes = parseAttributes(afterColon(line));
+            if (attributes["TYPE"] == "AUDIO" && !attributes["URI"].empty())
+                out.separateAudioGroups.push_back(attributes["GROUP-ID"]);
+        }
+        else if (startsWith(line, "#EXT-X-TARGETDURATION:")) {
+            out.targetDuration = std::atof(afterColon(line).c_str());
+        }
+        else if (startsWith(line, "#EXT-X-MEDIA-SEQUENCE:")) {
+            out.mediaSequence = std::atoll(afterColon(line).c_str());
+            nextSequence = out.mediaSequence;
+        }
+        else if (startsWith(line, "#EXTINF:")) {
+            pendingDuration = std::atof(afterColon(line).c_str());
+        }
+        else if (startsWith(line, "#EXT-X-MAP:")) {
+            auto attributes = parseAttributes(afterColon(line));
+            if (attributes.count("BYTERANGE"))
+                out.byteRanges = true;
+            currentInit = resolveUrl(baseUrl, attributes["URI"]);
+        }
+        else if (startsWith(line, "#EXT-X-KEY:")) {
+            auto attributes = parseAttributes(afterColon(line));
+            out.encrypted = attributes["METHOD"] != "NONE";
+        }
+        else if (startsWith(line, "#EXT-X-BYTERANGE:")) {
+            out.byteRanges = true;
+        }
+        else if (startsWith(line, "#EXT-X-DISCONTINUITY") && !startsWith(line, "#EXT-X-DISCONTINUITY-SEQUENCE")) {
+            pendingDiscontinuity = true;
+        }
+        else if (startsWith(line, "#EXT-X-ENDLIST")) {
+            out.endList = true;
+        }
+        else if (line[0] != '#') {
+            // A URI: the variant or segment the preceding tags described
+            if (variantPending) {
+                pendingVariant.url = resolveUrl(baseUrl, line);
+                out.variants.push_back(pendingVariant);
+                variantPending = false;
+            } else {
+                HlsSegment segment;
+                segment.url = resolveUrl(baseUrl, line);
+                segment.initUrl = currentInit;
+                segment.duration = pendingDuration;
+                segment.sequence = nextSequence++;
+                segment.discontinuity = pendingDiscontinuity;
+                out.segments.push_back(segment);
+                pendingDuration = 0.0;
+                pendingDiscontinuity = false;
+            }
+        }
+    }
+
+    return sawHeader;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One rendition listed by a master playlist (EXT-X-STREAM-INF).
+ */
+struct HlsVariant {
+    std::string url;         // Absolute URL of its media playlist
+    int64_t bandwidth = 0;   // Peak bits per second
+    int width = 0;
+    int height = 0;
+    std::string codecs;
+    std::string audioGroup;  // GROUP-ID of its EXT-X-MEDIA audio, if any
+};
+
+/**
+ * @brief One media segment of a media playlist.
+ */
+struct HlsSegment {
+    std::string url;         // Absolute
+    std::string initUrl;     // EXT-X-MAP in effect for it (fMP4), or empty
+    double duration = 0.0;   // Seconds
+    int64_t sequence = 0;    // Media sequence number
+    bool discontinuity = false;
+};
+
+/**
+ * @brief A parsed master or media playlist.
+ *
+ * Only what the prefetcher needs is kept. Features it cannot serve by
+ * concatenating segments (encryption, byte ranges, audio in separate
+ * renditions) are flagged instead, so the caller can fall back to
+ * FFmpeg's own HLS demuxer.
+ */
+struct HlsPlaylist {
+    bool isMaster = false;
+
+    // Master playlist
+    std::vector<HlsVariant> variants;
+    std::vector<std::string> separateAudioGroups;  // Groups whose audio lives in its own playlist
+
+    // Media playlist
+    double targetDuration = 0.0;
+    int64_t mediaSequence = 0;
+    bool endList = false;      // VOD, or a live stream that has finished
+    bool encrypted = false;
+    bool byteRanges = false;
+    std::vector<HlsSegment> segments;
+
+    /**
+     * @brief Parses playlist text.
+     * @param baseUrl The playlist's own URL; relative URIs are resolved against it.
+     * @return False if the text is not an M3U8 playlist.
+     */
+    static bool parse(const std::string& text, const std::string& baseUrl, HlsPlaylist& out);
+
+    /**
+     * @brief True if the segments can be fed to a demuxer back to back.
+     */
+    bool isConcatenable() const { return !encrypted && !byteRanges; }
+};
+
+/**
+ * @brief Resolves a playlist URI against the URL of the playlist that lists it.
+ * Works for http(s) URLs and for local paths.
+ */
+std::string resolveUrl(const std::string& baseUrl, const std::string& reference);
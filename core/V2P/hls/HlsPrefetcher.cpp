@@ -0,0 +1,578 @@
+#include "HlsPrefetcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "V2P/metrics/StreamMetrics.h"
+#include "V2P/metrics/Tracer.h"
+
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavutil/dict.h>
+#include <libavutil/error.h>
+}
+
+namespace {
+    constexpr size_t FETCH_CHUNK = 64 * 1024;
+
+    // Live reloads never come faster than this, whatever the playlist claims
+    constexpr double MIN_RELOAD_INTERVAL = 0.5;
+
+    double millisecondsSince(int64_t startNs) {
+        return static_cast<double>(StreamMetrics::now() - startNs) / 1e6;
+    }
+}
+
+HlsPrefetcher::HlsPrefetcher(PrefetchConfig config)
+    : config(config),
+      cache(config.cacheBytes) {}
+
+HlsPrefetcher::~HlsPrefetcher() {
+    abort();
+    for (std::thread& thread : fetchThreads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    if (refreshThread.joinable()) {
+        refreshThread.join();
+    }
+}
+
+bool HlsPrefetcher::open(const std::string& url) {
+    HlsPlaylist playlist;
+    if (!loadPlaylist(url, playlist)) {
+        return false;
+    }
+
+    mediaPlaylistUrl = url;
+    if (playlist.isMaster) {
+        if (playlist.variants.empty()) {
+            return false;
+        }
+
+        variants = playlist.variants;
+        const auto& audioGroups = playlist.separateAudioGroups;
+        for (const HlsVariant& variant : variants) {
+            if (!variant.audioGroup.empty() &&
+                std::find(audioGroups.begin(), audioGroups.end(), variant.audioGroup) != audioGroups.end()) {
+                std::cout << "HLS audio is in a separate rendition; not prefetching." << std::endl;
+                return false;
+            }
+        }
+
+        if (config.adaptive && variants.size() > 1) {
+            // Nothing is measured yet: start from the configured estimate
+            abr = std::make_unique<AbrController>(variants, config);
+            AbrInputs inputs;
+            if (abrProbe) {
+                abrProbe(inputs);
+            }
+            variantIndex = abr->initialVariant(inputs.displayWidth, inputs.displayHeight);
+        } else {
+            // The best rendition, as FFmpeg's demuxer would end up with
+            variantIndex = 0;
+            for (int i = 1; i < static_cast<int>(variants.size()); ++i) {
+                if (variants[i].bandwidth > variants[variantIndex].bandwidth) {
+                    variantIndex = i;
+                }
+            }
+        }
+
+        mediaPlaylistUrl = variants[variantIndex].url;
+        if (!loadPlaylist(mediaPlaylistUrl, playlist) || playlist.isMaster) {
+            return false;
+        }
+    }
+
+    if (!playlist.isConcatenable()) {
+        std::cout << "HLS playlist is encrypted or uses byte ranges; not prefetching." << std::endl;
+        return false;
+    }
+    if (playlist.segments.empty()) {
+        return false;
+    }
+    if (abr && !playlist.segments.front().initUrl.empty()) {
+        std::cout << "HLS variants are fMP4; adaptive switching is off." << std::endl;
+        abr.reset();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (variantIndex >= 0) {
+            setVariant(variantIndex);
+            stats.estimatedBandwidth = abr ? abr->getBandwidthEstimate() : 0.0;
+        }
+        targetDuration = playlist.targetDuration;
+        endList = playlist.endList;
+        segments.assign(playlist.segments.begin(), playlist.segments.end());
+        if (endList) {
+            vodSegments = playlist.segments;
+        }
+
+        // Live: join near the edge, like any player would
+        readSequence = segments.front().sequence;
+        if (!endList) {
+            int64_t liveStart = segments.back().sequence - std::max(config.liveStartSegments, 1) + 1;
+            readSequence = std::max(readSequence, liveStart);
+        }
+    }
+
+    for (int i = 0; i < std::max(config.parallelFetches, 1); ++i) {
+        fetchThreads.emplace_back(&HlsPrefetcher::fetchLoop, this);
+    }
+    if (!playlist.endList) {
+        refreshThread = std::thread(&HlsPrefetcher::refreshLoop, this);
+    }
+
+    std::cout << "Prefetching HLS segments from " << mediaPlaylistUrl << (abr ? " (adaptive)" : "") << std::endl;
+    return true;
+}
+
+int HlsPrefetcher::read(uint8_t* buffer, int size) {
+    while (!aborted) {
+        // An fMP4 init section goes before the first segment that uses it
+        if (initOffset < initSection.size()) {
+            size_t count = std::min(static_cast<size_t>(size), initSection.size() - initOffset);
+            std::memcpy(buffer, initSection.data() + initOffset, count);
+            initOffset += count;
+            bytesServed += count;
+            return static_cast<int>(count);
+        }
+
+        if (current && currentOffset < current->data.size()) {
+            size_t count = std::min(static_cast<size_t>(size), current->data.size() - currentOffset);
+            std::memcpy(buffer, current->data.data() + currentOffset, count);
+            currentOffset += count;
+            bytesServed += count;
+            return static_cast<int>(count);
+        }
+
+        if (!nextSegment()) {
+            return aborted ? AVERROR_EXIT : AVERROR_EOF;
+        }
+    }
+    return AVERROR_EXIT;
+}
+
+bool HlsPrefetcher::nextSegment() {
+    TraceScope trace("segment wait");
+    std::unique_lock<std::mutex> lock(mutex);
+
+    const bool continuing = started;
+    if (started) {
+        ++readSequence;
+    }
+    started = true;
+    current.reset();
+    currentOffset = 0;
+
+    while (!aborted) {
+        // A live reader that fell out of the playlist window skips ahead
+        if (!segments.empty() && readSequence < segments.front().sequence) {
+            readSequence = segments.front().sequence;
+        }
+        while (!segments.empty() && segments.front().sequence < readSequence) {
+            segments.pop_front();
+        }
+        cache.evictBefore(readSequence);
+        changed.notify_all(); // The fetch window moved along
+
+        if (!findSegment(readSequence)) {
+            if (endList) {
+                return false;
+            }
+            // Live: wait for the next playlist reload
+            changed.wait(lock);
+            continue;
+        }
+
+        int64_t waitStart = StreamMetrics::now();
+        std::shared_ptr<CachedSegment> entry = cache.find(readSequence);
+        bool waited = !entry || entry->state == CachedSegment::State::FETCHING;
+        changed.wait(lock, [&]() {
+            entry = cache.find(readSequence);
+            return aborted || (entry && entry->state != CachedSegment::State::FETCHING);
+        });
+        if (aborted) {
+            return false;
+        }
+
+        if (waited) {
+            stats.readerWaits++;
+            stats.totalWaitMs += millisecondsSince(waitStart);
+        }
+
+        if (entry->state == CachedSegment::State::FAILED) {
+            std::cerr << "Skipping HLS segment " << readSequence << " after failed fetches." << std::endl;
+            ++readSequence;
+            continue;
+        }
+
+        stats.segmentsServed++;
+        current = entry;
+        const HlsSegment* segment = findSegment(readSequence);
+        std::string segmentInit = segment->initUrl;
+        if (continuing && segment->discontinuity) {
+            stats.discontinuities++;
+            discontinuities.push_back(bytesServed);
+        }
+        lock.unlock();
+
+        if (segmentInit != initUrl) {
+            initUrl = segmentInit;
+            initSection.clear();
+            initOffset = 0;
+            if (!initUrl.empty() && !fetch(initUrl, initSection)) {
+                std::cerr << "Could not fetch the HLS init section: " << initUrl << std::endl;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+bool HlsPrefetcher::canSeek() const {
+    // fMP4 segments only make sense after their init section and moov; only
+    // MPEG-TS lets the demuxer pick up anywhere in the byte stream
+    std::lock_guard<std::mutex> lock(mutex);
+    return endList && !vodSegments.empty() && vodSegments.front().initUrl.empty();
+}
+
+double HlsPrefetcher::seek(double seconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!endList || vodSegments.empty() || !vodSegments.front().initUrl.empty()) {
+        return -1.0;
+    }
+
+    double start = 0.0;
+    size_t index = 0;
+    while (index + 1 < vodSegments.size() && start + vodSegments[index].duration <= seconds) {
+        start += vodSegments[index].duration;
+        ++index;
+    }
+
+    // Segments cached beyond the new position stay; the reader gets to them in time
+    segments.assign(vodSegments.begin() + index, vodSegments.end());
+    readSequence = segments.front().sequence;
+    cache.evictBefore(readSequence);
+    started = false;
+    current.reset();
+    currentOffset = 0;
+    discontinuities.clear(); // The seek re-anchors playback anyway
+    changed.notify_all(); // Fetchers start on the new window
+    return start;
+}
+
+bool HlsPrefetcher::passedDiscontinuity(int64_t position) {
+    bool passed = false;
+    while (!discontinuities.empty() && position >= discontinuities.front()) {
+        discontinuities.pop_front();
+        passed = true;
+    }
+    return passed;
+}
+
+void HlsPrefetcher::abort() {
+    aborted = true;
+    {
+        // Taken so that no waiter can miss the flag between its check and its wait
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    changed.notify_all();
+}
+
+PrefetchStats HlsPrefetcher::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    PrefetchStats result = stats;
+    result.active = true;
+    return result;
+}
+
+std::string HlsPrefetcher::getCodecKey() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (variantIndex < 0)
+        return "";
+
+    const HlsVariant& variant = variants[variantIndex];
+    if (variant.codecs.empty() || variant.height <= 0)
+        return "";
+    return variant.codecs + "@" + std::to_string(variant.width) + "x" + std::to_string(variant.height);
+}
+
+void HlsPrefetcher::fetchLoop() {
+    Tracer::setThreadName("segment fetch");
+
+    while (true) {
+        int64_t sequence = 0;
+        std::string url;
+        std::shared_ptr<CachedSegment> entry;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return aborted || claimNextFetch(sequence, url, entry); });
+            if (aborted) {
+                return;
+            }
+            activeFetches++;
+        }
+
+        TraceScope trace("segment fetch");
+        int64_t fetchStart = StreamMetrics::now();
+        std::vector<uint8_t> data;
+        bool ok = false;
+        int failures = 0;
+        for (int attempt = 0; attempt < FETCH_ATTEMPTS && !aborted; ++attempt) {
+            data.clear();
+            if (fetch(url, data)) {
+                ok = true;
+                break;
+            }
+            ++failures;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const double fetchMs = millisecondsSince(fetchStart);
+            stats.fetchErrors += failures;
+            if (ok) {
+                stats.segmentsFetched++;
+                stats.bytesFetched += data.size();
+                stats.totalFetchMs += fetchMs;
+                if (abr && failures == 0) {
+                    abr->addSample(data.size(), fetchMs / 1000.0, activeFetches);
+                }
+            }
+            activeFetches--;
+            cache.complete(entry, std::move(data), ok);
+            changed.notify_all();
+        }
+
+        // Segment boundaries are where variants change
+        adaptVariant();
+    }
+}
+
+void HlsPrefetcher::adaptVariant() {
+    // Outside the lock: the probe looks into the demuxer's and the client's queues
+    AbrInputs inputs;
+    if (abrProbe) {
+        abrProbe(inputs);
+    }
+
+    int target;
+    std::string url;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!abr || switching || aborted)
+            return;
+
+        inputs.prefetchedSeconds = prefetchedSeconds();
+        target = abr->select(variantIndex, inputs);
+        stats.estimatedBandwidth = abr->getBandwidthEstimate();
+        if (target == variantIndex)
+            return;
+
+        switching = true;
+        url = variants[target].url;
+    }
+
+    TraceScope trace("variant switch");
+    HlsPlaylist playlist;
+    bool loaded = loadPlaylist(url, playlist) && !playlist.isMaster && playlist.isConcatenable() &&
+                  !playlist.segments.empty() && playlist.segments.front().initUrl.empty();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    switching = false;
+    if (!loaded || !switchSegments(playlist)) {
+        std::cerr << "Could not switch to HLS variant " << url << std::endl;
+        return;
+    }
+
+    const HlsVariant& from = variants[variantIndex];
+    const HlsVariant& to = variants[target];
+    std::cout << "HLS variant " << from.width << "x" << from.height << " -> " << to.width << "x" << to.height
+              << " (" << to.bandwidth << " bps, estimate " << static_cast<int64_t>(stats.estimatedBandwidth)
+              << " bps)" << std::endl;
+
+    setVariant(target);
+    stats.variantSwitches++;
+    mediaPlaylistUrl = url; // Live reloads follow the new variant
+    changed.notify_all();
+}
+
+bool HlsPrefetcher::switchSegments(const HlsPlaylist& playlist) {
+    // Segments already claimed by a fetcher stay as they are; the demuxer
+    // reads straight on from the last of them into the new variant
+    int64_t kept = std::max(readSequence, cache.lastSequence());
+
+    auto first = std::find_if(playlist.segments.begin(), playlist.segments.end(),
+                              [kept](const HlsSegment& segment) { return segment.sequence > kept; });
+    if (first == playlist.segments.end() || first->sequence != kept + 1) {
+        // Media sequences do not line up, or the variant does not reach this far yet
+        return false;
+    }
+
+    while (!segments.empty() && segments.back().sequence > kept) {
+        segments.pop_back();
+    }
+    if (!segments.empty() && segments.back().sequence != kept) {
+        return false;
+    }
+    segments.insert(segments.end(), first, playlist.segments.end());
+    if (playlist.endList) {
+        vodSegments = playlist.segments; // Seeks go on in the variant switched to
+    }
+
+    if (playlist.targetDuration > 0.0) {
+        targetDuration = playlist.targetDuration;
+    }
+    endList = playlist.endList;
+    return true;
+}
+
+double HlsPrefetcher::prefetchedSeconds() const {
+    // Downloaded and waiting, without gaps, after the segment being read
+    double seconds = 0.0;
+    for (const HlsSegment& segment : segments) {
+        if (segment.sequence <= readSequence)
+            continue;
+        std::shared_ptr<CachedSegment> entry = cache.find(segment.sequence);
+        if (!entry || entry->state != CachedSegment::State::READY)
+            break;
+        seconds += segment.duration;
+    }
+    return seconds;
+}
+
+void HlsPrefetcher::setVariant(int index) {
+    variantIndex = index;
+    stats.variantHeight = variants[index].height;
+    stats.variantBandwidth = variants[index].bandwidth;
+}
+
+bool HlsPrefetcher::claimNextFetch(int64_t& sequence, std::string& url, std::shared_ptr<CachedSegment>& entry) {
+    // Earliest first: the segment being read always goes before the ones after it
+    for (const HlsSegment& segment : segments) {
+        if (segment.sequence < readSequence || cache.find(segment.sequence))
+            continue;
+        if (segment.sequence > readSequence + config.segmentsAhead)
+            break;
+        if (segment.sequence != readSequence && !cache.hasRoom())
+            break;
+
+        sequence = segment.sequence;
+        url = segment.url;
+        entry = cache.reserve(sequence);
+        return true;
+    }
+    return false;
+}
+
+void HlsPrefetcher::refreshLoop() {
+    Tracer::setThreadName("playlist reload");
+
+    double interval;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        interval = targetDuration;
+    }
+
+    while (true) {
+        std::string url;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait_for(lock, std::chrono::duration<double>(std::max(interval, MIN_RELOAD_INTERVAL)),
+                             [this]() { return aborted.load(); });
+            if (aborted || endList) {
+                return;
+            }
+            url = mediaPlaylistUrl;
+        }
+
+        HlsPlaylist playlist;
+        bool loaded = loadPlaylist(url, playlist) && !playlist.isMaster;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (url != mediaPlaylistUrl) {
+            // The variant changed while this one loaded; its segments no longer apply
+            continue;
+        }
+        if (!loaded) {
+            interval = targetDuration / 2.0;
+            continue;
+        }
+
+        // Per the spec: reload after one target duration, or half of it if nothing changed
+        size_t known = segments.size();
+        mergeSegments(playlist);
+        interval = segments.size() > known ? targetDuration : targetDuration / 2.0;
+        changed.notify_all();
+    }
+}
+
+void HlsPrefetcher::mergeSegments(const HlsPlaylist& playlist) {
+    int64_t last = segments.empty() ? readSequence - 1 : segments.back().sequence;
+    for (const HlsSegment& segment : playlist.segments) {
+        if (segment.sequence > last) {
+            segments.push_back(segment);
+        }
+    }
+    if (playlist.targetDuration > 0.0) {
+        targetDuration = playlist.targetDuration;
+    }
+    endList = playlist.endList;
+}
+
+const HlsSegment* HlsPrefetcher::findSegment(int64_t sequence) const {
+    if (segments.empty() || sequence < segments.front().sequence || sequence > segments.back().sequence)
+        return nullptr;
+
+    // Sequence numbers are consecutive
+    return &segments[static_cast<size_t>(sequence - segments.front().sequence)];
+}
+
+bool HlsPrefetcher::loadPlaylist(const std::string& url, HlsPlaylist& out) {
+    std::vector<uint8_t> data;
+    if (!fetch(url, data)) {
+        return false;
+    }
+    return HlsPlaylist::parse(std::string(data.begin(), data.end()), url, out);
+}
+
+bool HlsPrefetcher::fetch(const std::string& url, std::vector<uint8_t>& out) {
+    AVIOInterruptCB interrupt = { &HlsPrefetcher::interruptCallback, this };
+    AVDictionary* options = nullptr;
+    av_dict_set_int(&options, "rw_timeout", FETCH_TIMEOUT_US, 0);
+
+    AVIOContext* io = nullptr;
+    int ret = avio_open2(&io, url.c_str(), AVIO_FLAG_READ, &interrupt, &options);
+    av_dict_free(&options);
+    if (ret < 0) {
+        return false;
+    }
+
+    int64_t size = avio_size(io);
+    if (size > 0) {
+        out.reserve(out.size() + static_cast<size_t>(size) + FETCH_CHUNK);
+    }
+
+    // Read straight into the segment's own buffer
+    size_t filled = out.size();
+    while (true) {
+        out.resize(filled + FETCH_CHUNK);
+        ret = avio_read(io, out.data() + filled, static_cast<int>(FETCH_CHUNK));
+        if (ret <= 0)
+            break;
+        filled += static_cast<size_t>(ret);
+    }
+    out.resize(filled);
+
+    avio_closep(&io);
+    return (ret == 0 || ret == AVERROR_EOF) && !aborted;
+}
+
+int HlsPrefetcher::interruptCallback(void* opaque) {
+    return static_cast<HlsPrefetcher*>(opaque)->aborted.load() ? 1 : 0;
+}
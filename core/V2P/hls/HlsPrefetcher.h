@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "V2P/hls/AbrController.h"
+#include "V2P/hls/HlsPlaylist.h"
+#include "V2P/hls/SegmentCache.h"
+#include "V2P/stream/PrefetchConfig.h"
+
+/**
+ * @brief Serves an HLS stream to a demuxer as one continuous byte stream,
+ * downloading the next segments in parallel while the current one is read.
+ *
+ * FFmpeg's own HLS demuxer fetches one segment at a time when the demuxer
+ * reaches it, so every segment's latency becomes a stall. Here the
+ * playlist is parsed locally; a few fetch threads keep the next
+ * PrefetchConfig::segmentsAhead segments downloading into a bounded
+ * SegmentCache, and read() hands out their bytes in order (init section
+ * first for fMP4). Live playlists are reloaded once per target duration.
+ *
+ * With a master playlist and PrefetchConfig::adaptive, an AbrController
+ * picks the variant after every download. A switch only changes where the
+ * segments not yet claimed by a fetcher come from, so the demuxer keeps
+ * reading one stream and the new variant starts at a segment boundary.
+ * That needs MPEG-TS variants with aligned media sequence numbers; fMP4
+ * variants (one init section each) stay on the variant they started with.
+ *
+ * M3U8StreamStrategy plugs read() into a custom AVIOContext.
+ */
+class HlsPrefetcher {
+public:
+    explicit HlsPrefetcher(PrefetchConfig config);
+    ~HlsPrefetcher();
+
+    /**
+     * @brief Supplies what the ABR needs from downstream (queued packets and
+     * frames, display size). Call before open(); called from fetch threads.
+     */
+    void setAbrProbe(std::function<void(AbrInputs&)> probe) { abrProbe = std::move(probe); }
+
+    /**
+     * @brief Loads the playlist (choosing a variant of a master playlist)
+     * and starts fetching.
+     * @return False if the URL is not a playlist this class can serve:
+     * encrypted, byte-range or separate-audio streams are left to FFmpeg.
+     */
+    bool open(const std::string& url);
+
+    /**
+     * @brief Reads the next bytes of the stream; an AVIOContext read callback.
+     * Blocks until the segment being read has arrived.
+     * @return Bytes read, AVERROR_EOF at the end of a finished playlist, or
+     * AVERROR_EXIT once abort() was called.
+     */
+    int read(uint8_t* buffer, int size);
+
+    /**
+     * @brief True for a finished (VOD) MPEG-TS playlist, where seek() works.
+     */
+    bool canSeek() const;
+
+    /**
+     * @brief Makes read() continue with the segment holding a playlist time.
+     * Call from the reading thread; bytes the demuxer has buffered from
+     * before must be discarded by the caller.
+     * @param seconds Time from the start of the playlist.
+     * @return Where that segment starts, in playlist time, or -1 if the
+     * playlist cannot seek.
+     */
+    double seek(double seconds);
+
+    /**
+     * @brief For the reading thread, with the stream position of each packet
+     * it demuxes (AVPacket::pos): true once for the first packet at or past
+     * the start of a segment tagged EXT-X-DISCONTINUITY, where timestamps
+     * may jump. The first segment read, and the first after a seek, do not count.
+     */
+    bool passedDiscontinuity(int64_t position);
+
+    /**
+     * @brief Wakes read() and stops the fetch threads. Cannot be undone.
+     */
+    void abort();
+
+    PrefetchStats getStats() const;
+
+    /**
+     * @brief Describes how the variant being played is encoded (CODECS and
+     * RESOLUTION), for CodecParameterCache; empty unless the master
+     * playlist says both.
+     */
+    std::string getCodecKey() const;
+
+private:
+    static constexpr int FETCH_ATTEMPTS = 3;
+    static constexpr int64_t FETCH_TIMEOUT_US = 10'000'000;
+
+    void fetchLoop();
+    void refreshLoop();
+
+    /**
+     * @brief Downloads a whole URL through FFmpeg's protocols (http, https, file...).
+     */
+    bool fetch(const std::string& url, std::vector<uint8_t>& out);
+    bool loadPlaylist(const std::string& url, HlsPlaylist& out);
+
+    // Asks the ABR after a download and switches variant if it says so
+    void adaptVariant();
+
+    // Reader side, only called from read()
+    bool nextSegment();
+
+    // Under mutex
+    bool claimNextFetch(int64_t& sequence, std::string& url, std::shared_ptr<CachedSegment>& entry);
+    void mergeSegments(const HlsPlaylist& playlist);
+    bool switchSegments(const HlsPlaylist& playlist);
+    const HlsSegment* findSegment(int64_t sequence) const;
+    double prefetchedSeconds() const;
+    void setVariant(int index);
+
+    static int interruptCallback(void* opaque);
+
+    PrefetchConfig config;
+    std::vector<HlsVariant> variants;
+    std::function<void(AbrInputs&)> abrProbe;
+
+    std::atomic<bool> aborted = false;
+
+    mutable std::mutex mutex;  // Guards everything down to the reader state
+    std::condition_variable changed;
+    int variantIndex = -1;
+    std::string mediaPlaylistUrl;
+    std::unique_ptr<AbrController> abr; // Only for switchable master playlists
+    bool switching = false;           // A fetcher is loading another variant's playlist
+    int activeFetches = 0;
+    std::deque<HlsSegment> segments;  // Known segments from readSequence on, in order
+    std::vector<HlsSegment> vodSegments; // A finished playlist's segments from the start, for seek()
+    double targetDuration = 0.0;
+    bool endList = false;
+    int64_t readSequence = 0;         // The segment read() is in or about to start
+    SegmentCache cache;
+    PrefetchStats stats;
+
+    // Reader state: the demux thread is the only reader
+    std::shared_ptr<CachedSegment> current;
+    size_t currentOffset = 0;
+    std::vector<uint8_t> initSection;
+    size_t initOffset = 0;
+    std::string initUrl;
+    bool started = false;
+    int64_t bytesServed = 0;            // Stream position read() has reached
+    std::deque<int64_t> discontinuities; // Stream positions where discontinuous segments start
+
+    std::vector<std::thread> fetchThreads;
+    std::thread refreshThread;
+};
@@ -0,0 +1,42 @@
+#include "SegmentCache.h"
+
+std::shared_ptr<CachedSegment> SegmentCache::find(int64_t sequence) const {
+    auto it = segments.find(sequence);
+    return it == segments.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<CachedSegment> SegmentCache::reserve(int64_t sequence) {
+    auto& segment = segments[sequence];
+    if (!segment) {
+        segment = std::make_shared<CachedSegment>();
+    }
+    return segment;
+}
+
+void SegmentCache::complete(const std::shared_ptr<CachedSegment>& segment, std::vector<uint8_t> data, bool ok) {
+    segment->data = std::move(data);
+    segment->state = ok ? CachedSegment::State::READY : CachedSegment::State::FAILED;
+
+    // Charged only while it is still cached; an evicted segment is the reader's
+    for (const auto& entry : segments) {
+        if (entry.second == segment) {
+            bytes += segment->data.size();
+            break;
+        }
+    }
+}
+
+void SegmentCache::evictBefore(int64_t sequence) {
+    auto end = segments.lower_bound(sequence);
+    for (auto it = segments.begin(); it != end; ++it) {
+        if (it->second->state != CachedSegment::State::FETCHING) {
+            bytes -= it->second->data.size();
+        }
+    }
+    segments.erase(segments.begin(), end);
+}
+
+void SegmentCache::clear() {
+    segments.clear();
+    bytes = 0;
+}
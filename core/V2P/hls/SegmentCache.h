@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief One segment's bytes, or the promise of them.
+ */
+struct CachedSegment {
+    enum class State {
+        FETCHING,
+        READY,
+        FAILED
+    };
+
+    State state = State::FETCHING;
+    std::vector<uint8_t> data;  // Complete once READY; never changes after that
+};
+
+/**
+ * @brief Segments fetched ahead of the reader, by media sequence number,
+ * within a memory budget.
+ *
+ * Not thread-safe: HlsPrefetcher guards it with its own lock. A reader
+ * keeps a segment alive through its shared_ptr after it has been evicted.
+ */
+class SegmentCache {
+public:
+    explicit SegmentCache(size_t maxBytes) : maxBytes(maxBytes) {}
+
+    std::shared_ptr<CachedSegment> find(int64_t sequence) const;
+
+    /**
+     * @brief Adds an entry in the FETCHING state for a fetcher to fill in.
+     */
+    std::shared_ptr<CachedSegment> reserve(int64_t sequence);
+
+    /**
+     * @brief Stores a fetch result and charges its size to the budget.
+     */
+    void complete(const std::shared_ptr<CachedSegment>& segment, std::vector<uint8_t> data, bool ok);
+
+    /**
+     * @brief Drops every segment before `sequence`, e.g. the ones already read.
+     */
+    void evictBefore(int64_t sequence);
+
+    void clear();
+
+    /**
+     * @brief The highest sequence held (fetching or not), or -1 if empty.
+     */
+    int64_t lastSequence() const { return segments.empty() ? -1 : segments.rbegin()->first; }
+
+    bool hasRoom() const { return bytes < maxBytes; }
+    size_t size() const { return bytes; }
+
+private:
+    std::map<int64_t, std::shared_ptr<CachedSegment>> segments;
+    size_t maxBytes;
+    size_t bytes = 0;
+};
@@ -0,0 +1,348 @@
+#include "DecodeWorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <V2P/managers/PresentationScheduler.h>
+#include <V2P/metrics/Tracer.h>
+
+DecodeWorkerPool::DecodeWorkerPool(int workerCount) {
+    if (workerCount <= 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers.reserve(workerCount);
+    for (int i = 0; i < workerCount; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    // Start only once the vector is final, since workers steal from each other
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->thread = std::thread(&DecodeWorkerPool::workerLoop, this, i);
+    }
+}
+
+DecodeWorkerPool::~DecodeWorkerPool() {
+    {
+        // The streams outlive the pool and keep demuxing
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        for (auto& task : tasks) {
+            if (task->wakesOnInput)
+                task->streamer->setInputCallback(nullptr);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+}
+
+void DecodeWorkerPool::addStream(VideoStreamer* streamer, StreamPriority priority) {
+    if (!streamer)
+        return;
+
+    auto task = std::make_unique<Task>();
+    task->streamer = streamer;
+    task->priority = static_cast<int>(priority);
+    task->readyAt = PresentationScheduler::monotonicNow();
+    task->deadline = task->readyAt;
+
+    // Set before any worker sees the task, and cleared in removeStream()
+    Task* raw = task.get();
+    task->wakesOnInput = streamer->setInputCallback([this, raw]() {
+        raw->inputReady.store(true, std::memory_order_release);
+        notifyWorkers(false);
+    });
+
+    Worker* worker = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        worker = workers[nextWorker++ % workers.size()].get();
+        tasks.push_back(std::move(task));
+
+        std::lock_guard<std::mutex> queueLock(worker->mutex);
+        file(*worker, raw, raw->priority.load(std::memory_order_relaxed));
+    }
+    notifyWorkers(true);
+}
+
+void DecodeWorkerPool::removeStream(VideoStreamer* streamer) {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    auto it = std::find_if(tasks.begin(), tasks.end(),
+                           [streamer](const auto& task) { return task->streamer == streamer; });
+    if (it == tasks.end())
+        return;
+
+    Task* task = it->get();
+    if (task->wakesOnInput) {
+        streamer->setInputCallback(nullptr);
+    }
+    task->removed = true;
+
+    // A queued task is dropped here; a running one by its worker, which
+    // checks the flag under its mutex before putting the task back
+    for (auto& worker : workers) {
+        std::lock_guard<std::mutex> queueLock(worker->mutex);
+        if (unfile(*worker, task)) {
+            retire(task);
+            break;
+        }
+    }
+    {
+        std::unique_lock<std::mutex> retireLock(retireMutex);
+        retired.wait(retireLock, [task]() { return task->retired; });
+    }
+    tasks.erase(it);
+}
+
+void DecodeWorkerPool::setPriority(VideoStreamer* streamer, StreamPriority priority) {
+    std::lock_guard<std::mutex> lock(tasksMutex);
+    for (auto& task : tasks) {
+        if (task->streamer != streamer)
+            continue;
+        task->priority = static_cast<int>(priority);
+
+        // A ready task moves to its new list now; any other is filed by it when it comes back
+        for (auto& worker : workers) {
+            std::lock_guard<std::mutex> queueLock(worker->mutex);
+            const int list = task->list.load(std::memory_order_relaxed);
+            if (unfile(*worker, task.get())) {
+                file(*worker, task.get(), list == WAITING ? WAITING : static_cast<int>(priority));
+                break;
+            }
+        }
+    }
+    notifyWorkers(true);
+}
+
+DecodePoolStats DecodeWorkerPool::getStats() const {
+    DecodePoolStats stats;
+    stats.workers = getWorkerCount();
+    stats.steps = steps.load(std::memory_order_relaxed);
+    stats.frames = frames.load(std::memory_order_relaxed);
+    stats.steals = steals.load(std::memory_order_relaxed);
+    stats.idleWaits = idleWaits.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void DecodeWorkerPool::workerLoop(size_t index) {
+    Tracer::setThreadName("decode worker " + std::to_string(index));
+
+    while (!stopping.load(std::memory_order_acquire)) {
+        // Read before looking at the queues: anything that comes in after
+        // that changes it, and the sleep below ends at once
+        const uint64_t generation = wakeGeneration.load(std::memory_order_acquire);
+        double now = PresentationScheduler::monotonicNow();
+        double earliestReady = now + MAX_IDLE_WAIT;
+
+        Task* task = takeTask(index, now, earliestReady);
+        if (!task) {
+            // Nothing can make progress yet: sleep until the first task is due or new work comes in
+            idleWaits.fetch_add(1, std::memory_order_relaxed);
+            TraceScope trace("idle");
+            double wait = std::clamp(earliestReady - now, 0.0, MAX_IDLE_WAIT);
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait_for(lock, std::chrono::duration<double>(wait), [this, generation]() {
+                return stopping.load(std::memory_order_relaxed) ||
+                       wakeGeneration.load(std::memory_order_relaxed) != generation;
+            });
+            continue;
+        }
+
+        DecodeStepResult result;
+        {
+            TraceScope trace("decode step");
+            result = task->streamer->decodeStep();
+        }
+        steps.fetch_add(1, std::memory_order_relaxed);
+        reschedule(index, task, result, PresentationScheduler::monotonicNow());
+    }
+}
+
+DecodeWorkerPool::Task* DecodeWorkerPool::takeTask(size_t index, double now, double& earliestReady) {
+    // Own queue first, so a stream tends to stay on the same core
+    Worker& own = *workers[index];
+    int ownBest = PRIORITY_COUNT;
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        promote(own, now, earliestReady);
+        ownBest = bestReady(own);
+        if (ownBest < PRIORITY_COUNT && !readyBefore(ownBest)) {
+            if (Task* task = pop(own, ownBest))
+                return task;
+            ownBest = bestReady(own);
+        }
+    }
+
+    // Steal when nothing is ready here, or a better priority is ready elsewhere;
+    // looking also promotes what has become ready on a worker busy decoding
+    for (size_t offset = 1; offset < workers.size(); ++offset) {
+        Worker& victim = *workers[(index + offset) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        promote(victim, now, earliestReady);
+        const int priority = bestReady(victim);
+        if (priority < ownBest) {
+            if (Task* task = pop(victim, priority)) {
+                steals.fetch_add(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+    }
+
+    // The better task was taken meanwhile
+    if (ownBest < PRIORITY_COUNT) {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        const int priority = bestReady(own);
+        if (priority < PRIORITY_COUNT)
+            return pop(own, priority);
+    }
+    return nullptr;
+}
+
+void DecodeWorkerPool::promote(Worker& worker, double now, double& earliestReady) {
+    // A stream that ran out of input is ready again once its demuxer says so
+    for (size_t i = 0; i < worker.waiting.size();) {
+        Task* task = worker.waiting[i];
+        if (task->readyAt > now && !task->inputReady.load(std::memory_order_acquire)) {
+            earliestReady = std::min(earliestReady, task->readyAt);
+            ++i;
+            continue;
+        }
+        worker.waiting[i] = worker.waiting.back();
+        worker.waiting.pop_back();
+        file(worker, task, task->priority.load(std::memory_order_relaxed));
+    }
+}
+
+int DecodeWorkerPool::bestReady(const Worker& worker) const {
+    for (int priority = 0; priority < PRIORITY_COUNT; ++priority) {
+        if (!worker.ready[priority].empty())
+            return priority;
+    }
+    return PRIORITY_COUNT;
+}
+
+bool DecodeWorkerPool::laterDeadline(const Task* a, const Task* b) {
+    // Heap order of the ready lists: the stream that runs dry soonest on top
+    return a->deadline > b->deadline;
+}
+
+DecodeWorkerPool::Task* DecodeWorkerPool::pop(Worker& worker, int priority) {
+    auto& ready = worker.ready[priority];
+    while (!ready.empty()) {
+        std::pop_heap(ready.begin(), ready.end(), laterDeadline);
+        Task* task = ready.back();
+        ready.pop_back();
+        readyCount[priority].fetch_sub(1, std::memory_order_relaxed);
+        task->list = NOT_QUEUED;
+
+        // Being removed: removeStream() no longer finds it queued
+        if (task->removed.load(std::memory_order_acquire)) {
+            retire(task);
+            continue;
+        }
+        // Input that arrives from here on makes the stream ready again after this step
+        task->inputReady.store(false, std::memory_order_relaxed);
+        return task;
+    }
+    return nullptr;
+}
+
+void DecodeWorkerPool::file(Worker& worker, Task* task, int list) {
+    task->list = list;
+    if (list == WAITING) {
+        worker.waiting.push_back(task);
+        return;
+    }
+    worker.ready[list].push_back(task);
+    std::push_heap(worker.ready[list].begin(), worker.ready[list].end(), laterDeadline);
+    readyCount[list].fetch_add(1, std::memory_order_relaxed);
+}
+
+bool DecodeWorkerPool::unfile(Worker& worker, Task* task) {
+    // Read without the owner's mutex if the task is queued on another
+    // worker; then it is not found here
+    const int filed = task->list.load(std::memory_order_relaxed);
+    if (filed == NOT_QUEUED)
+        return false;
+    auto& list = filed == WAITING ? worker.waiting : worker.ready[filed];
+    auto it = std::find(list.begin(), list.end(), task);
+    if (it == list.end())
+        return false;
+    list.erase(it);
+    if (filed != WAITING) {
+        std::make_heap(list.begin(), list.end(), laterDeadline);
+        readyCount[filed].fetch_sub(1, std::memory_order_relaxed);
+    }
+    task->list = NOT_QUEUED;
+    return true;
+}
+
+bool DecodeWorkerPool::readyBefore(int priority) const {
+    for (int better = 0; better < priority; ++better) {
+        if (readyCount[better].load(std::memory_order_relaxed) > 0)
+            return true;
+    }
+    return false;
+}
+void DecodeWorkerPool::notifyWorkers(bool all) {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeGeneration.fetch_add(1, std::memory_order_release);
+    }
+    if (all) {
+        wakeUp.notify_all();
+    } else {
+        wakeUp.notify_one();
+    }
+}
+
+void DecodeWorkerPool::reschedule(size_t index, Task* task, DecodeStepResult result, double now) {
+    if (task->removed.load(std::memory_order_acquire)) {
+        retire(task);
+        return;
+    }
+
+    switch (result) {
+        case DecodeStepResult::FRAME:
+            // Keep filling the stream's queue while it has input
+            frames.fetch_add(1, std::memory_order_relaxed);
+            task->readyAt = now;
+            break;
+        case DecodeStepResult::IDLE:
+            // Woken by the stream's input callback, if it has one
+            task->readyAt = now + (task->wakesOnInput ? INPUT_TIMEOUT : IDLE_RETRY);
+            break;
+        case DecodeStepResult::BLOCKED:
+            // The client frees a slot about once per frame
+            task->readyAt = now + task->streamer->getFrameInterval() * 0.5;
+            break;
+        case DecodeStepResult::ENDED:
+            retire(task);
+            return;
+    }
+    task->deadline = task->streamer->getDecodeDeadline(now);
+
+    Worker& worker = *workers[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        // Checked under the mutex: removeStream() looks for the task under it
+        if (!task->removed.load(std::memory_order_acquire)) {
+            file(worker, task, task->readyAt > now ? WAITING : task->priority.load(std::memory_order_relaxed));
+            return;
+        }
+    }
+    retire(task);
+}
+
+void DecodeWorkerPool::retire(Task* task) {
+    {
+        std::lock_guard<std::mutex> lock(retireMutex);
+        task->retired = true;
+    }
+    retired.notify_all();
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <V2P/stream/VideoStreamer.h>
+
+/**
+ * @brief How urgently a stream's frames are needed; lower values decode first.
+ */
+enum class StreamPriority {
+    FOCUSED = 0,  // The tile the user is looking at
+    VISIBLE = 1,  // On screen
+    HIDDEN = 2    // Off screen or minimised; decoded with whatever is left
+};
+
+/**
+ * @brief Counters of a DecodeWorkerPool.
+ */
+struct DecodePoolStats {
+    int workers = 0;
+    uint64_t steps = 0;        // decodeStep() calls
+    uint64_t frames = 0;       // Steps that queued a frame
+    uint64_t steals = 0;       // Tasks taken from another worker's queue
+    uint64_t idleWaits = 0;    // Times a worker found nothing ready and slept
+};
+
+/**
+ * @brief A fixed set of threads that decodes any number of streams.
+ *
+ * Every stream is a task that lives in one worker's queue, where ready tasks
+ * wait in one list per priority, ordered by when each stream runs dry. A
+ * worker runs the first task of its best list, unless a shared count shows a
+ * better priority ready on another worker, and steals only then or when it
+ * has nothing ready: a focused stream never waits behind hidden ones on a
+ * busy worker, and a step costs no look at the other queues. One step
+ * decodes at most one frame and never blocks, so a stream that is waiting
+ * for the client to catch up just comes back later, and one that ran out of
+ * input sleeps until its demuxer reports more: the thread count follows the
+ * core count, not the stream count.
+ *
+ * Streams must be opened with external scheduling (see
+ * VideoStreamer::setExternalScheduling) and outlive their registration.
+ */
+class DecodeWorkerPool {
+public:
+    /**
+     * @param workerCount Worker threads; 0 means one per hardware thread.
+     */
+    explicit DecodeWorkerPool(int workerCount = 0);
+    ~DecodeWorkerPool();
+
+    DecodeWorkerPool(const DecodeWorkerPool&) = delete;
+    DecodeWorkerPool& operator=(const DecodeWorkerPool&) = delete;
+
+    void addStream(VideoStreamer* streamer, StreamPriority priority = StreamPriority::VISIBLE);
+
+    /**
+     * @brief Unregisters a stream. Returns once no worker is running it any more.
+     */
+    void removeStream(VideoStreamer* streamer);
+
+    void setPriority(VideoStreamer* streamer, StreamPriority priority);
+
+    DecodePoolStats getStats() const;
+
+    int getWorkerCount() const { return static_cast<int>(workers.size()); }
+
+private:
+    static constexpr int PRIORITY_COUNT = 3;
+    static constexpr int WAITING = PRIORITY_COUNT; // Task::list of a task that is not ready yet
+    static constexpr int NOT_QUEUED = -1;          // Running, or not added yet
+
+    struct Task {
+        VideoStreamer* streamer = nullptr;
+        std::atomic<int> priority{0};
+        std::atomic<bool> removed{false};
+        std::atomic<bool> inputReady{false}; // Set by the stream's input callback
+        bool retired = false;     // Guarded by retireMutex
+        bool wakesOnInput = false; // Else a stream without input is polled
+        std::atomic<int> list{NOT_QUEUED}; // Where in its worker it waits; written under the worker's mutex
+
+        // Only written by the worker running the task
+        double deadline = 0.0;    // When the stream needs its next frame
+        double readyAt = 0.0;     // Earliest time the next step can make progress
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::vector<Task*> ready[PRIORITY_COUNT]; // Heaps, earliest deadline first
+        std::vector<Task*> waiting;
+        std::thread thread;
+    };
+
+    // Back-off after a step that found no input, for streams that cannot
+    // report new input, in seconds
+    static constexpr double IDLE_RETRY = 0.002;
+    // Streams that can are still looked at this often, in case an end went unreported
+    static constexpr double INPUT_TIMEOUT = 0.1;
+    // Longest sleep; new streams, priorities and input wake the workers anyway
+    static constexpr double MAX_IDLE_WAIT = 0.1;
+
+    void workerLoop(size_t index);
+    Task* takeTask(size_t index, double now, double& earliestReady);
+    // Called with the worker's mutex held
+    void promote(Worker& worker, double now, double& earliestReady);
+    int bestReady(const Worker& worker) const;
+    Task* pop(Worker& worker, int priority);
+    void file(Worker& worker, Task* task, int list);
+    bool unfile(Worker& worker, Task* task);
+    static bool laterDeadline(const Task* a, const Task* b);
+    // A task of a better priority than this is ready on some worker
+    bool readyBefore(int priority) const;
+    void notifyWorkers(bool all);
+    void reschedule(size_t index, Task* task, DecodeStepResult result, double now);
+    void retire(Task* task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::mutex tasksMutex;
+    std::vector<std::unique_ptr<Task>> tasks;
+    size_t nextWorker = 0;
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<uint64_t> wakeGeneration{0}; // Changed under sleepMutex, so no wake-up is lost
+    std::atomic<bool> stopping{false};
+
+    // Ready tasks per priority, across all workers
+    std::atomic<int> readyCount[PRIORITY_COUNT]{};
+
+    std::mutex retireMutex;
+    std::condition_variable retired;
+
+    std::atomic<uint64_t> steps{0};
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> steals{0};
+    std::atomic<uint64_t> idleWaits{0};
+};
@@ -0,0 +1,216 @@
+#include "PresentationScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <V2P/stream/VideoStreamer.h>
+#include <V2P/utils/PlaybackClock.h>
+#include <V2P/metrics/Tracer.h>
+
+namespace {
+    // A frame further ahead than this is a timestamp discontinuity
+    // (stream switch, wrap-around), not something worth waiting for.
+    constexpr double RESYNC_THRESHOLD = 2.0;
+
+    // Bounds the work per tick when a stream has fallen far behind
+    constexpr int MAX_FRAMES_PER_TICK = 64;
+}
+
+void PresentationScheduler::addStream(VideoStreamer* streamer) {
+    if (findSlot(streamer))
+        return;
+
+    Slot slot;
+    slot.streamer = streamer;
+    slot.timeline = streamer->getTimeline();
+    slots.push_back(std::move(slot));
+}
+
+void PresentationScheduler::removeStream(VideoStreamer* streamer) {
+    slots.erase(std::remove_if(slots.begin(), slots.end(),
+                               [streamer](const Slot& slot) { return slot.streamer == streamer; }),
+                slots.end());
+}
+
+void PresentationScheduler::tick(double now, double nextVsync) {
+    TraceScope trace("schedule");
+    for (Slot& slot : slots) {
+        tickSlot(slot, now, nextVsync);
+    }
+}
+
+double PresentationScheduler::referenceClock(Slot& slot, double now) {
+    // No audio playing, or audio still before a jump the video has made:
+    // run the stream at wall-clock speed from its anchor frame
+    const double anchorClock = slot.anchorPts + (now - slot.anchorTime);
+    double audioClock = slot.streamer->getClock();
+    if (audioClock <= 0.0) {
+        return anchorClock;
+    }
+    if (slot.aheadOfAudio && std::abs(audioClock - anchorClock) < RESYNC_THRESHOLD) {
+        slot.aheadOfAudio = false; // Caught up: audio leads again
+    }
+    return slot.aheadOfAudio ? anchorClock : audioClock;
+}
+
+void PresentationScheduler::tickSlot(Slot& slot, double now, double nextVsync) {
+    slot.changed = false;
+    StreamMetrics* metrics = slot.streamer->getMetrics();
+    double shownOffset = 0.0; // pts minus clock of the frame picked for this vsync
+    bool shownLate = false;
+
+    // A decode-bound stream may have nothing but frames too late to show:
+    // rather than freeze, the newest of them goes up anyway
+    VideoFrame newestLate;
+    double newestLateOffset = 0.0;
+
+    // Paused: what is on screen stays, and does not count as repeated
+    const bool paused = slot.streamer->isPaused();
+    if (paused != slot.paused) {
+        slot.paused = paused;
+        slot.restart = slot.restart || !paused;
+    }
+    if (paused) {
+        return;
+    }
+
+    // A seek: the frame held back belongs to the old position
+    const uint32_t timeline = slot.streamer->getTimeline();
+    if (timeline != slot.timeline) {
+        slot.timeline = timeline;
+        slot.pending.reset();
+        slot.restart = true;
+    }
+
+    for (int i = 0; i < MAX_FRAMES_PER_TICK; ++i) {
+        if (slot.pending.empty() && !slot.streamer->getNextVideoFrame(slot.pending)) {
+            break; // Nothing decoded yet; keep what is on screen
+        }
+
+        if (!slot.anchored) {
+            slot.anchored = true;
+            slot.anchorPts = slot.pending.timestamp;
+            slot.anchorTime = nextVsync;
+        }
+
+        // Judge the frame by where the clock will be when it becomes visible
+        double clockAtVsync = referenceClock(slot, now) + (nextVsync - now);
+        FrameSyncController::SyncDecision decision =
+            syncController.evaluate(slot.pending.timestamp, clockAtVsync, now);
+
+        if (slot.pending.discontinuity || decision.waitUntil - now > RESYNC_THRESHOLD) {
+            // Timestamps jumped (or may have, where the playlist says so):
+            // start over from this frame, and time the ones after it from
+            // here rather than by audio from before the jump
+            slot.anchorPts = slot.pending.timestamp;
+            slot.anchorTime = nextVsync;
+            slot.aheadOfAudio = true;
+            decision = {};
+            decision.show = true;
+        } else if (slot.restart || (slot.current.empty() && slot.streamer->getStartupConfig().fastStart)) {
+            // Fast start, seeks and resumes: the picture goes up at once, wherever the clock is
+            slot.anchorPts = slot.pending.timestamp;
+            slot.anchorTime = nextVsync;
+            slot.aheadOfAudio = false;
+            decision = {};
+            decision.show = true;
+        }
+
+        if (decision.drop) {
+            if (!newestLate.empty()) {
+                slot.stats.dropped++;
+                if (metrics) metrics->add(MetricCounter::FRAMES_DROPPED);
+            }
+            newestLateOffset = slot.pending.timestamp - clockAtVsync;
+            newestLate = std::move(slot.pending);
+            continue;
+        }
+
+        if (!decision.show) {
+            break; // Early: hold it for a later vsync
+        }
+
+        // A newer due frame overtakes one picked earlier in this tick
+        if (slot.changed) {
+            slot.stats.dropped++;
+            slot.stats.presented--;
+            if (shownLate) {
+                slot.stats.late--;
+            }
+            if (metrics) metrics->add(MetricCounter::FRAMES_DROPPED);
+        }
+        Tracer::flow(TraceFlow::STEP, slot.pending.traceId);
+        shownOffset = slot.pending.timestamp - clockAtVsync;
+        shownLate = decision.late;
+        slot.current = std::move(slot.pending);
+        slot.changed = true;
+        slot.restart = false;
+        slot.stats.presented++;
+        if (decision.late) {
+            slot.stats.late++;
+        }
+    }
+
+    if (!newestLate.empty()) {
+        if (slot.changed) {
+            slot.stats.dropped++;
+            if (metrics) metrics->add(MetricCounter::FRAMES_DROPPED);
+        } else {
+            Tracer::flow(TraceFlow::STEP, newestLate.traceId);
+            shownOffset = newestLateOffset;
+            shownLate = true;
+            slot.current = std::move(newestLate);
+            slot.changed = true;
+            slot.stats.presented++;
+            slot.stats.late++;
+        }
+    }
+
+    if (!slot.changed && !slot.current.empty()) {
+        slot.stats.repeated++;
+        if (metrics) metrics->add(MetricCounter::FRAMES_REPEATED);
+    }
+
+    if (slot.changed && metrics) {
+        metrics->markStartup(StartupMilestone::FIRST_PRESENT);
+        metrics->add(MetricCounter::FRAMES_PRESENTED);
+        metrics->record(MetricStage::SYNC_DELAY, static_cast<int64_t>(std::abs(shownOffset) * 1e9));
+        if (shownLate) {
+            metrics->add(MetricCounter::FRAMES_LATE);
+        }
+    }
+}
+
+const VideoFrame* PresentationScheduler::getCurrentFrame(const VideoStreamer* streamer, bool* changed) const {
+    const Slot* slot = findSlot(streamer);
+    if (!slot || slot->current.empty())
+        return nullptr;
+
+    if (changed)
+        *changed = slot->changed;
+    return &slot->current;
+}
+
+PresentationStats PresentationScheduler::getStats(const VideoStreamer* streamer) const {
+    const Slot* slot = findSlot(streamer);
+    return slot ? slot->stats : PresentationStats{};
+}
+
+double PresentationScheduler::monotonicNow() {
+    return static_cast<double>(PlaybackClock::monotonicNow()) / 1e9;
+}
+
+PresentationScheduler::Slot* PresentationScheduler::findSlot(const VideoStreamer* streamer) {
+    for (Slot& slot : slots) {
+        if (slot.streamer == streamer)
+            return &slot;
+    }
+    return nullptr;
+}
+
+const PresentationScheduler::Slot* PresentationScheduler::findSlot(const VideoStreamer* streamer) const {
+    for (const Slot& slot : slots) {
+        if (slot.streamer == streamer)
+            return &slot;
+    }
+    return nullptr;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <V2P/stream/VideoFrame.h>
+#include <V2P/utils/FrameSyncController.h>
+
+class VideoStreamer;
+
+/**
+ * @brief Per-stream presentation counters.
+ */
+struct PresentationStats {
+    uint64_t presented = 0;  // Frames that reached the screen
+    uint64_t late = 0;       // Presented, but behind the clock
+    uint64_t dropped = 0;    // Too late to show, or overtaken by a newer frame
+    uint64_t repeated = 0;   // Vsyncs where the previous frame stayed up
+};
+
+/**
+ * @brief Decides, once per vsync, which frame every stream shows.
+ *
+ * The scheduler holds the next frame of each stream and asks the
+ * FrameSyncController whether it is due at the upcoming vsync, measured on
+ * the stream's clock. Each stream's clock is its audio playback clock; a
+ * stream without audible audio falls back to the shared monotonic clock,
+ * anchored at its first frame. All streams are judged against the same
+ * vsync instant, so they advance in lockstep with the display.
+ * Streams opened with StartupConfig::fastStart put their first frame up
+ * as soon as it is decoded and are synchronised from there, and so does
+ * every stream after a seek or a pause. A paused stream keeps its frame.
+ * A frame far ahead of the clock, or the first after an HLS discontinuity,
+ * is a timestamp jump: it goes up at once, and the stream runs on the
+ * monotonic clock from it until its audio clock has caught up.
+ * Frames too late to show are dropped, except that a tick which would drop
+ * every frame it popped presents the newest of them, marked late, so a
+ * stream that cannot decode in real time still moves.
+ *
+ * tick() only pops frames that are ready, so it never waits: the caller
+ * presents and the vsync-locked present is the only thing that blocks.
+ */
+class PresentationScheduler {
+public:
+    void addStream(VideoStreamer* streamer);
+    void removeStream(VideoStreamer* streamer);
+
+    /**
+     * @brief Picks the frame every stream shows at the next vsync.
+     * @param now The current monotonic time in seconds.
+     * @param nextVsync The monotonic time in seconds at which the next
+     * present becomes visible.
+     */
+    void tick(double now, double nextVsync);
+
+    /**
+     * @brief The frame the stream should show, or nullptr if it has none yet.
+     * @param changed [out] Optional; set if the frame changed in the last tick.
+     */
+    const VideoFrame* getCurrentFrame(const VideoStreamer* streamer, bool* changed = nullptr) const;
+
+    PresentationStats getStats(const VideoStreamer* streamer) const;
+
+    /**
+     * @brief The monotonic time base shared by all streams, in seconds.
+     */
+    static double monotonicNow();
+
+private:
+    struct Slot {
+        VideoStreamer* streamer = nullptr;
+        VideoFrame pending;   // Next frame, waiting for its time
+        VideoFrame current;   // On screen
+        bool changed = false;
+
+        // Clock for streams without audio, and after a timestamp jump
+        bool anchored = false;
+        double anchorPts = 0.0;
+        double anchorTime = 0.0;
+        bool aheadOfAudio = false; // Jumped: the audio clock is ignored until it is near again
+
+        // Seeks and pauses: the next frame goes up at once and the clock starts over from it
+        uint32_t timeline = 0;
+        bool paused = false;
+        bool restart = false;
+
+        PresentationStats stats;
+    };
+
+    double referenceClock(Slot& slot, double now);
+    void tickSlot(Slot& slot, double now, double nextVsync);
+    Slot* findSlot(const VideoStreamer* streamer);
+    const Slot* findSlot(const VideoStreamer* streamer) const;
+
+    std::vector<Slot> slots;
+    FrameSyncController syncController;
+};
@@ -1,23 +1,184 @@
-#include <V2P/stream/VideoStreamer.h>
-#include <cstdint>
+#include "VideoStreamManager.h"
 
-class VideoStreamManager {
-    void addStream(std::unique_ptr<VideoStreamer> streamer) {
-        streams.push_back(std::move(streamer));
+#include <algorithm>
+#include <iostream>
+#include <V2P/stream/VideoStreamFactory.h>
+
+VideoStreamManager::VideoStreamManager(int decoderThreadBudget, int decodeWorkers)
+    : threadBudget(std::make_shared<DecoderThreadBudget>(decoderThreadBudget)),
+      decodePool(decodeWorkers) {}
+
+VideoStreamer* VideoStreamManager::addStream(const std::string& url, StreamOptions options,
+                                             StreamPriority priority) {
+    // The share the stream will get once the others have given theirs back
+    const bool sharedThreads = options.decoder.threadCount <= 0;
+    if (sharedThreads) {
+        options.decoder.threadCount = threadShare(streams.size() + 1);
+    }
+    options.decoder.budget = threadBudget;
+    options.externalScheduling = true;
+
+    auto streamer = VideoStreamFactory::createVideoStreamer(url, options);
+    if (!streamer) {
+        return nullptr;
+    }
+
+    VideoStreamer* result = streamer.get();
+    if (sharedThreads) {
+        sharedThreadStreams.insert(result);
+    }
+    addStream(std::move(streamer), priority);
+    return result;
+}
+
+void VideoStreamManager::addStream(std::unique_ptr<VideoStreamer> streamer, StreamPriority priority) {
+    scheduler.addStream(streamer.get());
+    if (streamer->isExternallyScheduled()) {
+        decodePool.addStream(streamer.get(), priority);
+    }
+    streams.push_back(std::move(streamer));
+    rebalanceDecoderThreads();
+}
+
+VideoStreamer* VideoStreamManager::addStandby(const std::string& url, StreamOptions options) {
+    // Its decoder hands its threads back to the budget as soon as it is on
+    // standby, and takes a share again after promote()
+    const bool sharedThreads = options.decoder.threadCount <= 0;
+    if (sharedThreads) {
+        options.decoder.threadCount = threadShare(streams.size());
+    }
+    options.decoder.budget = threadBudget;
+    options.externalScheduling = true;
+
+    auto streamer = VideoStreamFactory::createVideoStreamer(url, options);
+    if (!streamer) {
+        return nullptr;
+    }
+
+    // Not in the pool, so nothing decodes it; an async open applies this when done
+    if (!streamer->setStandby(true)) {
+        std::cerr << "Could not put stream on standby: " << url << std::endl;
+        return nullptr;
+    }
+
+    VideoStreamer* result = streamer.get();
+    if (sharedThreads) {
+        sharedThreadStreams.insert(result);
+    }
+    standbys.push_back(std::move(streamer));
+    trimStandbys();
+    return result;
+}
+
+bool VideoStreamManager::promote(VideoStreamer* standby, size_t index, bool keepReplaced,
+                                 StreamPriority priority) {
+    auto it = std::find_if(standbys.begin(), standbys.end(),
+                           [standby](const auto& s) { return s.get() == standby; });
+    if (it == standbys.end() || index >= streams.size())
+        return false;
+
+    std::unique_ptr<VideoStreamer> incoming = std::move(*it);
+    standbys.erase(it);
+
+    // Out of the pool first: nothing may decode a stream while it changes state
+    std::unique_ptr<VideoStreamer> outgoing = std::move(streams[index]);
+    decodePool.removeStream(outgoing.get());
+    scheduler.removeStream(outgoing.get());
+
+    // Its decoder threads go back to the budget before the incoming stream
+    // takes its share; if it is not kept, it is closed below
+    const bool outgoingStandby = keepReplaced && outgoing->setStandby(true);
+
+    incoming->setStandby(false);
+    scheduler.addStream(incoming.get());
+    if (incoming->isExternallyScheduled()) {
+        decodePool.addStream(incoming.get(), priority);
+    }
+    streams[index] = std::move(incoming);
+    rebalanceDecoderThreads();
+
+    if (outgoingStandby) {
+        standbys.push_back(std::move(outgoing));
+        trimStandbys();
+    } else {
+        sharedThreadStreams.erase(outgoing.get());
     }
+    return true;
+}
 
-    void updateAll(uint32_t bufferedBytes, int bytesPerSecond) {
-        for (auto& s : streams) {
-            VideoFrame frame;
-            if (s->updateFrame(frame, bufferedBytes, bytesPerSecond)) {
-                // Store or forward frame for rendering
-                latestFrames.push_back(std::move(frame));
-            }
+void VideoStreamManager::removeStandby(VideoStreamer* standby) {
+    auto it = std::remove_if(standbys.begin(), standbys.end(),
+                             [standby](const auto& s) { return s.get() == standby; });
+    for (auto closed = it; closed != standbys.end(); ++closed) {
+        sharedThreadStreams.erase(closed->get());
+    }
+    standbys.erase(it, standbys.end());
+}
+
+void VideoStreamManager::setStandbyLimit(size_t limit) {
+    standbyLimit = limit;
+    trimStandbys();
+}
+
+void VideoStreamManager::trimStandbys() {
+    if (standbys.size() > standbyLimit) {
+        auto end = standbys.end() - static_cast<std::ptrdiff_t>(standbyLimit);
+        for (auto closed = standbys.begin(); closed != end; ++closed) {
+            sharedThreadStreams.erase(closed->get());
         }
+        standbys.erase(standbys.begin(), end);
     }
+}
 
-    const std::vector<VideoFrame>& getFrames() const { return latestFrames; }
-private:
-    std::vector<std::unique_ptr<VideoStreamer>> streams;
-    std::vector<VideoFrame> latestFrames;
-};
+int VideoStreamManager::threadShare(size_t streamCount) const {
+    return std::max(1, threadBudget->getTotal() / static_cast<int>(std::max<size_t>(streamCount, 1)));
+}
+
+void VideoStreamManager::rebalanceDecoderThreads() {
+    // Each decoder trades its threads for the new share at its next
+    // keyframe; those that shrink make room for those that grow
+    const int share = threadShare(streams.size());
+    for (const auto& s : streams) {
+        if (sharedThreadStreams.count(s.get())) {
+            s->setDecoderThreadCount(share);
+        }
+    }
+}
+
+void VideoStreamManager::setStreamPriority(size_t index, StreamPriority priority) {
+    if (index < streams.size()) {
+        decodePool.setPriority(streams[index].get(), priority);
+    }
+}
+
+void VideoStreamManager::updateAll(double now, double nextVsync) {
+    // Frames that are replaced here are dropped, which hands their
+    // buffers back to their stream's pool.
+    scheduler.tick(now, nextVsync);
+}
+
+const VideoFrame* VideoStreamManager::getFrame(size_t index, bool* changed) const {
+    if (index >= streams.size())
+        return nullptr;
+    return scheduler.getCurrentFrame(streams[index].get(), changed);
+}
+
+PresentationStats VideoStreamManager::getPresentationStats(size_t index) const {
+    if (index >= streams.size())
+        return {};
+    return scheduler.getStats(streams[index].get());
+}
+
+void VideoStreamManager::setDecoderThreadBudget(int threads) {
+    threadBudget->setTotal(threads);
+    rebalanceDecoderThreads();
+}
+
+std::vector<DecodeStats> VideoStreamManager::getDecodeStats() const {
+    std::vector<DecodeStats> stats;
+    stats.reserve(streams.size());
+    for (const auto& s : streams) {
+        stats.push_back(s->getDecodeStats());
+    }
+    return stats;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <V2P/stream/VideoStreamer.h>
+#include <V2P/stream/StreamOptions.h>
+#include <V2P/utils/DecoderThreadBudget.h>
+#include <V2P/managers/PresentationScheduler.h>
+#include <V2P/managers/DecodeWorkerPool.h>
+
+/**
+ * @brief Owns a set of streams (e.g. a video wall) and the resources they share.
+ *
+ * Streams created through the manager draw their decoder threads from one
+ * DecoderThreadBudget, so adding streams never oversubscribes the machine.
+ * Their decode loops run as tasks on one DecodeWorkerPool instead of a
+ * thread per stream, ordered by priority and by when each stream needs its
+ * next frame.
+ *
+ * For instant channel switching the manager can also keep streams on warm
+ * standby: opened and demuxing, holding their packets back to the last
+ * keyframe, but neither decoded nor presented until promote() swaps one in.
+ */
+class VideoStreamManager {
+public:
+    /**
+     * @param decoderThreadBudget Decoder threads shared by all streams; 0 means one per hardware thread.
+     * @param decodeWorkers Threads running the streams' decode steps; 0 means one per hardware thread.
+     */
+    explicit VideoStreamManager(int decoderThreadBudget = 0, int decodeWorkers = 0);
+
+    /**
+     * @brief Creates and opens a stream that decodes within the shared thread budget.
+     * @param url The direct URL of the media stream.
+     * @param options Client settings. With an automatic thread count (0) the
+     * stream gets an even share of the budget, rebalanced across the open
+     * streams (not the standbys) whenever one is added or promoted.
+     * @param priority Where the stream's decode steps go in the pool's order.
+     * @return The new stream, or nullptr if the URL is not supported.
+     */
+    VideoStreamer* addStream(const std::string& url, StreamOptions options = {},
+                             StreamPriority priority = StreamPriority::VISIBLE);
+
+    /**
+     * @brief Takes over an already created stream. It joins the worker pool
+     * if it was opened with external scheduling, else it keeps its own thread.
+     */
+    void addStream(std::unique_ptr<VideoStreamer> streamer,
+                   StreamPriority priority = StreamPriority::VISIBLE);
+
+    /**
+     * @brief Moves a stream up or down the decode order, e.g. when its tile gains focus.
+     */
+    void setStreamPriority(size_t index, StreamPriority priority);
+
+    /**
+     * @brief Opens a stream on warm standby, e.g. the next or previous channel.
+     * It costs a connection and a demuxer, but no decoding and no share of
+     * the decoder thread budget, until promote().
+     * Beyond the standby limit, the oldest standby is closed.
+     * @return The standby stream, or nullptr if the URL is not supported.
+     */
+    VideoStreamer* addStandby(const std::string& url, StreamOptions options = {});
+
+    /**
+     * @brief Puts a standby stream in place of stream `index`; presentation
+     * starts from the standby's last keyframe.
+     * @param keepReplaced Keeps the replaced stream as a standby (e.g. the
+     * previous channel) instead of closing it.
+     * @param priority Where the promoted stream's decode steps go in the pool's order.
+     * @return False if `standby` is not one of this manager's standby streams
+     * or `index` is out of range.
+     */
+    bool promote(VideoStreamer* standby, size_t index, bool keepReplaced = true,
+                 StreamPriority priority = StreamPriority::VISIBLE);
+
+    /**
+     * @brief Closes a standby stream.
+     */
+    void removeStandby(VideoStreamer* standby);
+
+    /**
+     * @brief How many standby streams are kept at most (2 by default); the oldest go first.
+     */
+    void setStandbyLimit(size_t limit);
+
+    size_t getStandbyCount() const { return standbys.size(); }
+
+    VideoStreamer* getStandby(size_t index) const {
+        return index < standbys.size() ? standbys[index].get() : nullptr;
+    }
+
+    /**
+     * @brief Picks every stream's frame for the next vsync. Never blocks.
+     * @param now The current monotonic time in seconds (PresentationScheduler::monotonicNow()).
+     * @param nextVsync When the next present becomes visible, on the same clock.
+     */
+    void updateAll(double now, double nextVsync);
+
+    /**
+     * @brief The frame stream `index` should show, or nullptr if it has none yet.
+     * @param changed [out] Optional; set if the frame changed in the last update.
+     */
+    const VideoFrame* getFrame(size_t index, bool* changed = nullptr) const;
+
+    PresentationStats getPresentationStats(size_t index) const;
+
+    /**
+     * @brief Resizes the shared decoder thread budget. Streams with an
+     * automatic thread count take their new share at their next keyframe.
+     */
+    void setDecoderThreadBudget(int threads);
+
+    const DecoderThreadBudget& getDecoderThreadBudget() const { return *threadBudget; }
+
+    /**
+     * @brief Gets the video decode timings of every stream, in stream order.
+     */
+    std::vector<DecodeStats> getDecodeStats() const;
+
+    DecodePoolStats getDecodePoolStats() const { return decodePool.getStats(); }
+
+    size_t getStreamCount() const { return streams.size(); }
+
+    VideoStreamer* getStream(size_t index) const {
+        return index < streams.size() ? streams[index].get() : nullptr;
+    }
+
+private:
+    // Closes the oldest standbys beyond the limit
+    void trimStandbys();
+
+    // An even split of the decoder thread budget
+    int threadShare(size_t streamCount) const;
+    void rebalanceDecoderThreads();
+
+    std::vector<std::unique_ptr<VideoStreamer>> streams;
+    std::vector<std::unique_ptr<VideoStreamer>> standbys; // Oldest first; never in the pool or the scheduler
+    size_t standbyLimit = 2;
+    std::unordered_set<const VideoStreamer*> sharedThreadStreams; // Opened with an automatic thread count
+    PresentationScheduler scheduler;
+    std::shared_ptr<DecoderThreadBudget> threadBudget;
+
+    // Declared last: destroyed first, so no worker touches a stream being torn down
+    DecodeWorkerPool decodePool;
+};
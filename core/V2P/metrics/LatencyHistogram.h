@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Read-only copy of a LatencyHistogram, in nanoseconds.
+ */
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sumNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t p50Ns = 0;
+    uint64_t p90Ns = 0;
+    uint64_t p99Ns = 0;
+    uint64_t p999Ns = 0;
+
+    // Cumulative counts at LatencyHistogram::EXPORT_BOUNDS_NS, for Prometheus
+    std::array<uint64_t, 15> cumulative = {};
+
+    double meanNs() const { return count ? static_cast<double>(sumNs) / static_cast<double>(count) : 0.0; }
+};
+
+/**
+ * @brief A lock-free, fixed-size histogram of durations, HDR style.
+ *
+ * Values are bucketed log-linearly: every power of two is split into 16
+ * linear sub-buckets, so any recorded value is known to within about 6%
+ * from 1 ns up to 2^40 ns (18 minutes); larger values land in the last
+ * bucket. Recording is one relaxed atomic add per field and never
+ * allocates or locks, so it is cheap enough for per-frame hot paths.
+ * Any number of threads may record while others take snapshots.
+ */
+class LatencyHistogram {
+public:
+    // Prometheus bucket bounds, from 50 us to 2.5 s
+    static constexpr std::array<uint64_t, 15> EXPORT_BOUNDS_NS = {
+        50'000, 100'000, 250'000, 500'000,
+        1'000'000, 2'500'000, 5'000'000, 10'000'000, 25'000'000, 50'000'000,
+        100'000'000, 250'000'000, 500'000'000, 1'000'000'000, 2'500'000'000
+    };
+
+    void record(int64_t durationNs) {
+        const uint64_t value = durationNs > 0 ? static_cast<uint64_t>(durationNs) : 0;
+        buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t previous = max.load(std::memory_order_relaxed);
+        while (value > previous && !max.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t sumNs() const { return sum.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Copies the counters and derives the percentiles. Concurrent
+     * records may or may not be included; the result is always consistent
+     * with itself.
+     */
+    HistogramSnapshot snapshot() const {
+        std::array<uint64_t, BUCKET_COUNT> counts;
+        HistogramSnapshot result;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            counts[i] = buckets[i].load(std::memory_order_relaxed);
+            result.count += counts[i];
+        }
+        result.sumNs = sum.load(std::memory_order_relaxed);
+        result.maxNs = max.load(std::memory_order_relaxed);
+        if (result.count == 0)
+            return result;
+
+        const uint64_t targets[4] = {
+            percentileRank(result.count, 0.50), percentileRank(result.count, 0.90),
+            percentileRank(result.count, 0.99), percentileRank(result.count, 0.999)
+        };
+        uint64_t* outputs[4] = { &result.p50Ns, &result.p90Ns, &result.p99Ns, &result.p999Ns };
+
+        uint64_t seen = 0;
+        size_t nextTarget = 0;
+        size_t nextBound = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            const uint64_t upper = bucketUpperBound(i);
+            // A bucket counts towards an export bound once it lies entirely below it
+            while (nextBound < EXPORT_BOUNDS_NS.size() && upper > EXPORT_BOUNDS_NS[nextBound]) {
+                result.cumulative[nextBound++] = seen;
+            }
+
+            seen += counts[i];
+            while (nextTarget < 4 && seen >= targets[nextTarget]) {
+                *outputs[nextTarget++] = std::min(upper, result.maxNs);
+            }
+        }
+        while (nextBound < EXPORT_BOUNDS_NS.size()) {
+            result.cumulative[nextBound++] = seen;
+        }
+        return result;
+    }
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 40;
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    static size_t bucketIndex(uint64_t value) {
+        if (value < SUB_BUCKETS)
+            return static_cast<size_t>(value);
+
+        const int exponent = std::bit_width(value) - 1;
+        if (exponent > MAX_EXPONENT)
+            return BUCKET_COUNT - 1;
+
+        const uint64_t subBucket = (value >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKETS;
+        return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket);
+    }
+
+    static uint64_t bucketUpperBound(size_t index) {
+        if (index < SUB_BUCKETS)
+            return index;
+
+        const int exponent = static_cast<int>(index / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+        const uint64_t subBucket = index % SUB_BUCKETS;
+        const uint64_t width = uint64_t(1) << (exponent - SUB_BUCKET_BITS);
+        return (SUB_BUCKETS + subBucket) * width + width - 1;
+    }
+
+    static uint64_t percentileRank(uint64_t count, double quantile) {
+        return std::max<uint64_t>(1, static_cast<uint64_t>(static_cast<double>(count) * quantile + 0.5));
+    }
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets = {};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+};
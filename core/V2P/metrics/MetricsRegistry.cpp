@@ -0,0 +1,134 @@
+#include "MetricsRegistry.h"
+
+#include <algorithm>
+#include <sstream>
+#include <V2P/utils/JsonEscape.h>
+
+namespace {
+    constexpr size_t STAGE_COUNT = static_cast<size_t>(MetricStage::COUNT);
+    constexpr size_t COUNTER_COUNT = static_cast<size_t>(MetricCounter::COUNT);
+    constexpr size_t MILESTONE_COUNT = static_cast<size_t>(StartupMilestone::COUNT);
+
+    std::string streamLabels(const StreamMetricsSnapshot& stream) {
+        return "stream=\"" + escapeJson(stream.name) + "\",id=\"" + std::to_string(stream.id) + "\"";
+    }
+
+    double toMicroseconds(uint64_t ns) { return static_cast<double>(ns) / 1e3; }
+    double toSeconds(uint64_t ns) { return static_cast<double>(ns) / 1e9; }
+}
+
+MetricsRegistry& MetricsRegistry::global() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+void MetricsRegistry::add(const std::shared_ptr<StreamMetrics>& metrics) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Entry& entry : streams) {
+        if (entry.metrics.lock() == metrics)
+            return;
+    }
+    streams.push_back({ nextId++, metrics });
+}
+
+MetricsSnapshot MetricsRegistry::snapshot() {
+    MetricsSnapshot result;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    streams.erase(std::remove_if(streams.begin(), streams.end(),
+                                 [](const Entry& entry) { return entry.metrics.expired(); }),
+                  streams.end());
+
+    result.streams.reserve(streams.size());
+    for (const Entry& entry : streams) {
+        if (auto metrics = entry.metrics.lock()) {
+            result.streams.push_back(metrics->snapshot());
+            result.streams.back().id = entry.id;
+        }
+    }
+    return result;
+}
+
+std::string MetricsSnapshot::toJson() const {
+    std::ostringstream out;
+    out << "{\"streams\":[";
+    for (size_t s = 0; s < streams.size(); ++s) {
+        const StreamMetricsSnapshot& stream = streams[s];
+        out << (s ? "," : "") << "{\"name\":\"" << escapeJson(stream.name) << "\""
+            << ",\"id\":" << stream.id << ",\"stages_us\":{";
+
+        for (size_t i = 0; i < STAGE_COUNT; ++i) {
+            const HistogramSnapshot& h = stream.stages[i];
+            out << (i ? "," : "") << "\"" << toString(static_cast<MetricStage>(i)) << "\":{"
+                << "\"count\":" << h.count
+                << ",\"mean\":" << h.meanNs() / 1e3
+                << ",\"p50\":" << toMicroseconds(h.p50Ns)
+                << ",\"p90\":" << toMicroseconds(h.p90Ns)
+                << ",\"p99\":" << toMicroseconds(h.p99Ns)
+                << ",\"p999\":" << toMicroseconds(h.p999Ns)
+                << ",\"max\":" << toMicroseconds(h.maxNs)
+                << "}";
+        }
+
+        out << "},\"counters\":{";
+        for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+            out << (i ? "," : "") << "\"" << toString(static_cast<MetricCounter>(i)) << "\":" << stream.counters[i];
+        }
+
+        out << "},\"startup_ms\":{";
+        bool first = true;
+        for (size_t i = 0; i < MILESTONE_COUNT; ++i) {
+            if (stream.startup[i] < 0)
+                continue;
+            out << (first ? "" : ",") << "\"" << toString(static_cast<StartupMilestone>(i)) << "\":"
+                << static_cast<double>(stream.startup[i]) / 1e6;
+            first = false;
+        }
+        out << "}}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+std::string MetricsSnapshot::toPrometheus() const {
+    std::ostringstream out;
+
+    out << "# HELP v2p_stage_duration_seconds Time spent per pipeline stage.\n"
+        << "# TYPE v2p_stage_duration_seconds histogram\n";
+    for (const StreamMetricsSnapshot& stream : streams) {
+        const std::string streamLabel = streamLabels(stream);
+        for (size_t i = 0; i < STAGE_COUNT; ++i) {
+            const HistogramSnapshot& h = stream.stages[i];
+            const std::string labels = streamLabel + ",stage=\"" + toString(static_cast<MetricStage>(i)) + "\"";
+
+            for (size_t b = 0; b < LatencyHistogram::EXPORT_BOUNDS_NS.size(); ++b) {
+                out << "v2p_stage_duration_seconds_bucket{" << labels
+                    << ",le=\"" << toSeconds(LatencyHistogram::EXPORT_BOUNDS_NS[b]) << "\"} "
+                    << h.cumulative[b] << "\n";
+            }
+            out << "v2p_stage_duration_seconds_bucket{" << labels << ",le=\"+Inf\"} " << h.count << "\n"
+                << "v2p_stage_duration_seconds_sum{" << labels << "} " << toSeconds(h.sumNs) << "\n"
+                << "v2p_stage_duration_seconds_count{" << labels << "} " << h.count << "\n";
+        }
+    }
+
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        const std::string metric = std::string("v2p_") + toString(static_cast<MetricCounter>(i)) + "_total";
+        out << "# TYPE " << metric << " counter\n";
+        for (const StreamMetricsSnapshot& stream : streams) {
+            out << metric << "{" << streamLabels(stream) << "} " << stream.counters[i] << "\n";
+        }
+    }
+
+    out << "# HELP v2p_startup_seconds Time from the open request to each startup milestone.\n"
+        << "# TYPE v2p_startup_seconds gauge\n";
+    for (const StreamMetricsSnapshot& stream : streams) {
+        for (size_t i = 0; i < MILESTONE_COUNT; ++i) {
+            if (stream.startup[i] < 0)
+                continue;
+            out << "v2p_startup_seconds{" << streamLabels(stream) << ",milestone=\""
+                << toString(static_cast<StartupMilestone>(i)) << "\"} " << toSeconds(stream.startup[i]) << "\n";
+        }
+    }
+    return out.str();
+}
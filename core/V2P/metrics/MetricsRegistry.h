@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "V2P/metrics/StreamMetrics.h"
+
+/**
+ * @brief Metrics of every registered stream at one point in time.
+ */
+struct MetricsSnapshot {
+    std::vector<StreamMetricsSnapshot> streams;
+
+    /**
+     * @brief One object per stream with per-stage count, mean, max and
+     * percentiles in microseconds, the counters, and the startup
+     * milestones reached, in milliseconds since the open was requested.
+     */
+    std::string toJson() const;
+
+    /**
+     * @brief Prometheus text exposition format (version 0.0.4): one
+     * v2p_stage_duration_seconds histogram per stream and stage, one
+     * v2p_<counter>_total counter per stream, and a v2p_startup_seconds
+     * gauge per stream and milestone reached.
+     */
+    std::string toPrometheus() const;
+};
+
+/**
+ * @brief Process-wide list of live streams' metrics, for dashboards and exporters.
+ *
+ * Streams register when they open (VideoStreamer::open does) and drop out
+ * automatically once their metrics are destroyed.
+ */
+class MetricsRegistry {
+public:
+    static MetricsRegistry& global();
+
+    void add(const std::shared_ptr<StreamMetrics>& metrics);
+
+    MetricsSnapshot snapshot();
+
+private:
+    struct Entry {
+        uint64_t id;
+        std::weak_ptr<StreamMetrics> metrics;
+    };
+
+    std::mutex mutex;
+    std::vector<Entry> streams;
+    uint64_t nextId = 1;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A monotonically increasing counter that many threads can bump without contention.
+ *
+ * Each thread adds to its own cache-line sized shard (threads are spread
+ * over the shards round-robin on first use), so concurrent writers never
+ * share a line. Reading sums the shards and is meant for snapshots, not for
+ * hot paths.
+ */
+class ShardedCounter {
+public:
+    void add(uint64_t value = 1) {
+        shards[shardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const Shard& shard : shards) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    static constexpr size_t SHARD_COUNT = 8;
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+
+    static size_t shardIndex() {
+        static std::atomic<size_t> nextShard{0};
+        thread_local const size_t index = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+        return index;
+    }
+
+    std::array<Shard, SHARD_COUNT> shards;
+};
@@ -0,0 +1,74 @@
+#include "StreamMetrics.h"
+
+#include <utility>
+
+const char* toString(MetricStage stage) {
+    switch (stage) {
+        case MetricStage::DEMUX_WAIT:      return "demux_wait";
+        case MetricStage::DECODE:          return "decode";
+        case MetricStage::CONVERT:         return "convert";
+        case MetricStage::QUEUE_RESIDENCY: return "queue_residency";
+        case MetricStage::SYNC_DELAY:      return "sync_delay";
+        case MetricStage::TEXTURE_UPLOAD:  return "texture_upload";
+        case MetricStage::PRESENT:         return "present";
+        case MetricStage::SEEK:            return "seek";
+        case MetricStage::COUNT:           break;
+    }
+    return "unknown";
+}
+
+const char* toString(MetricCounter counter) {
+    switch (counter) {
+        case MetricCounter::BYTES_DEMUXED:    return "bytes_demuxed";
+        case MetricCounter::FRAMES_PRESENTED: return "frames_presented";
+        case MetricCounter::FRAMES_DROPPED:   return "frames_dropped";
+        case MetricCounter::FRAMES_LATE:      return "frames_late";
+        case MetricCounter::FRAMES_REPEATED:  return "frames_repeated";
+        case MetricCounter::PACKETS_REJECTED: return "packets_rejected";
+        case MetricCounter::COUNT:            break;
+    }
+    return "unknown";
+}
+
+const char* toString(StartupMilestone milestone) {
+    switch (milestone) {
+        case StartupMilestone::OPEN_REQUESTED:  return "open_requested";
+        case StartupMilestone::PLAYLIST_LOADED: return "playlist_loaded";
+        case StartupMilestone::INPUT_OPENED:    return "input_opened";
+        case StartupMilestone::STREAMS_PROBED:  return "streams_probed";
+        case StartupMilestone::DECODERS_OPENED: return "decoders_opened";
+        case StartupMilestone::FIRST_PACKET:    return "first_packet";
+        case StartupMilestone::FIRST_FRAME:     return "first_frame";
+        case StartupMilestone::FIRST_PRESENT:   return "first_present";
+        case StartupMilestone::COUNT:           break;
+    }
+    return "unknown";
+}
+
+void StreamMetrics::setName(std::string newName) {
+    std::lock_guard<std::mutex> lock(nameMutex);
+    name = std::move(newName);
+}
+
+std::string StreamMetrics::getName() const {
+    std::lock_guard<std::mutex> lock(nameMutex);
+    return name;
+}
+
+StreamMetricsSnapshot StreamMetrics::snapshot() const {
+    StreamMetricsSnapshot result;
+    result.name = getName();
+    for (size_t i = 0; i < histograms.size(); ++i) {
+        result.stages[i] = histograms[i].snapshot();
+    }
+    for (size_t i = 0; i < counters.size(); ++i) {
+        result.counters[i] = counters[i].value();
+    }
+
+    const int64_t requested = startup[static_cast<size_t>(StartupMilestone::OPEN_REQUESTED)].load(std::memory_order_relaxed);
+    for (size_t i = 0; i < startup.size(); ++i) {
+        int64_t at = startup[i].load(std::memory_order_relaxed);
+        result.startup[i] = requested > 0 && at > 0 ? at - requested : -1;
+    }
+    return result;
+}
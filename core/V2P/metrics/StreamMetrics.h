@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "V2P/metrics/LatencyHistogram.h"
+#include "V2P/metrics/ShardedCounter.h"
+
+/**
+ * @brief Timed stages of a stream's pipeline, in the order a frame passes them.
+ */
+enum class MetricStage {
+    DEMUX_WAIT,       // Reading one packet, including network and disk waits
+    DECODE,           // send_packet/receive_frame for one video frame
+    CONVERT,          // Pixel format conversion of one frame
+    QUEUE_RESIDENCY,  // From the decoder handing a frame over to the client taking it
+    SYNC_DELAY,       // Distance between a shown frame's pts and the clock at its vsync
+    TEXTURE_UPLOAD,   // Copying one frame to the GPU
+    PRESENT,          // The present call of a frame that showed this stream
+    SEEK,             // From a seek request to the first frame decoded at the new position
+    COUNT
+};
+
+/**
+ * @brief Event counters of a stream.
+ */
+enum class MetricCounter {
+    BYTES_DEMUXED,
+    FRAMES_PRESENTED,
+    FRAMES_DROPPED,
+    FRAMES_LATE,
+    FRAMES_REPEATED,
+    PACKETS_REJECTED, // Refused by a decoder (corrupt or unsupported data)
+    COUNT
+};
+
+/**
+ * @brief Milestones of a stream's startup, in the order they are reached.
+ * Together they break the time to first frame down by phase.
+ */
+enum class StartupMilestone {
+    OPEN_REQUESTED,   // VideoStreamer::open() or openAsync() called
+    PLAYLIST_LOADED,  // HLS playlists fetched by the prefetcher (skipped without one)
+    INPUT_OPENED,     // Container header read
+    STREAMS_PROBED,   // Codec parameters known, probed or from the cache
+    DECODERS_OPENED,
+    FIRST_PACKET,     // First video packet queued for the decoder
+    FIRST_FRAME,      // First video frame decoded
+    FIRST_PRESENT,    // First frame picked for a vsync
+    COUNT
+};
+
+const char* toString(MetricStage stage);
+const char* toString(MetricCounter counter);
+const char* toString(StartupMilestone milestone);
+
+/**
+ * @brief Read-only copy of one stream's metrics.
+ */
+struct StreamMetricsSnapshot {
+    std::string name;
+    uint64_t id = 0;   // Registration order; tells streams with the same name apart
+    std::array<HistogramSnapshot, static_cast<size_t>(MetricStage::COUNT)> stages;
+    std::array<uint64_t, static_cast<size_t>(MetricCounter::COUNT)> counters = {};
+
+    // Nanoseconds from OPEN_REQUESTED to each milestone; -1 if not reached
+    std::array<int64_t, static_cast<size_t>(StartupMilestone::COUNT)> startup;
+
+    const HistogramSnapshot& stage(MetricStage s) const { return stages[static_cast<size_t>(s)]; }
+    uint64_t counter(MetricCounter c) const { return counters[static_cast<size_t>(c)]; }
+};
+
+/**
+ * @brief Latency histograms and counters of one stream, shared by every
+ * thread that works on it (demuxer, decoder, client).
+ *
+ * Recording is lock-free and allocation-free; see LatencyHistogram and
+ * ShardedCounter. The name is only read by snapshots.
+ */
+class StreamMetrics {
+public:
+    void record(MetricStage stage, int64_t durationNs) {
+        histograms[static_cast<size_t>(stage)].record(durationNs);
+    }
+
+    void add(MetricCounter counter, uint64_t value = 1) {
+        counters[static_cast<size_t>(counter)].add(value);
+    }
+
+    const LatencyHistogram& histogram(MetricStage stage) const {
+        return histograms[static_cast<size_t>(stage)];
+    }
+
+    uint64_t counter(MetricCounter counter) const {
+        return counters[static_cast<size_t>(counter)].value();
+    }
+
+    /**
+     * @brief Records that startup reached `milestone`. Only the first call
+     * per milestone counts, so hot paths can call it unconditionally.
+     */
+    void markStartup(StartupMilestone milestone) {
+        std::atomic<int64_t>& at = startup[static_cast<size_t>(milestone)];
+        if (at.load(std::memory_order_relaxed) == 0) {
+            int64_t expected = 0;
+            at.compare_exchange_strong(expected, now(), std::memory_order_relaxed);
+        }
+    }
+
+    void setName(std::string newName);
+    std::string getName() const;
+
+    StreamMetricsSnapshot snapshot() const;
+
+    /**
+     * @brief The clock all stage durations are measured on, in nanoseconds.
+     */
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    std::array<LatencyHistogram, static_cast<size_t>(MetricStage::COUNT)> histograms;
+    std::array<ShardedCounter, static_cast<size_t>(MetricCounter::COUNT)> counters;
+    std::array<std::atomic<int64_t>, static_cast<size_t>(StartupMilestone::COUNT)> startup = {};
+
+    mutable std::mutex nameMutex;
+    std::string name;
+};
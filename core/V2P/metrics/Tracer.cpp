@@ -0,0 +1,282 @@
+#include "Tracer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <V2P/utils/JsonEscape.h>
+
+namespace {
+    // The calling thread's ring and the tracer generation it belongs to
+    struct ThreadState {
+        std::shared_ptr<void> buffer;
+        uint64_t generation = 0;
+        std::string name;
+    };
+
+    thread_local ThreadState threadState;
+
+    // FFmpeg's AV_NOPTS_VALUE, without pulling FFmpeg into the metrics
+    constexpr int64_t NO_PTS = std::numeric_limits<int64_t>::min();
+    constexpr int PTS_BITS = 40;
+
+    // Stall dumps go next to the on-demand file: trace.json -> trace-stall1.json
+    std::string stallPath(const std::string& path, int index) {
+        std::string suffix = "-stall" + std::to_string(index);
+        size_t dot = path.rfind('.');
+        size_t slash = path.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            return path + suffix + ".json";
+        return path.substr(0, dot) + suffix + path.substr(dot);
+    }
+}
+
+std::atomic<bool> Tracer::active = false;
+
+Tracer& Tracer::global() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::~Tracer() {
+    active = false;
+    if (stallWriter.joinable()) {
+        stallWriter.join();
+    }
+}
+
+void Tracer::start(const std::string& path, size_t events) {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffers.clear();
+    eventsPerThread = std::max<size_t>(events, 1);
+    outputPath = path;
+    originNs = StreamMetrics::now();
+    lastStallDumpNs = 0;
+    generation.fetch_add(1, std::memory_order_release);
+    active.store(true, std::memory_order_release);
+}
+
+void Tracer::stop() {
+    active.store(false, std::memory_order_release);
+}
+
+void Tracer::setStallThreshold(double seconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stallThreshold = seconds;
+}
+
+bool Tracer::dump() {
+    std::string path;
+    int64_t origin;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        path = outputPath;
+        origin = originNs;
+    }
+    if (path.empty())
+        return false;
+    return writeFile(path, collect(), origin);
+}
+
+void Tracer::writeJson(std::ostream& out) {
+    int64_t origin;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        origin = originNs;
+    }
+    writeEvents(out, collect(), origin);
+}
+
+void Tracer::reportStall(const char* what, double seconds) {
+    if (!enabled())
+        return;
+
+    int64_t now = StreamMetrics::now();
+    std::string path;
+    int64_t origin;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stallThreshold <= 0.0 || seconds < stallThreshold || outputPath.empty())
+            return;
+        if (lastStallDumpNs != 0 && now - lastStallDumpNs < static_cast<int64_t>(STALL_DUMP_COOLDOWN * 1e9))
+            return;
+        lastStallDumpNs = now;
+        path = stallPath(outputPath, ++stallDumps);
+        origin = originNs;
+    }
+
+    // Marks the moment the stall was noticed; the gap itself is what precedes it
+    instant(what);
+
+    // Only the copy is made here; formatting and disk I/O stay off the caller's thread
+    std::vector<ThreadEvents> threads = collect();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stallWriter.joinable()) {
+        stallWriter.join();
+    }
+    stallWriter = std::thread([path, origin, threads = std::move(threads)]() {
+        if (writeFile(path, threads, origin)) {
+            std::cerr << "Stall detected, trace written to " << path << std::endl;
+        }
+    });
+}
+
+void Tracer::setThreadName(const std::string& name) {
+    threadState.name = name;
+    if (auto buffer = std::static_pointer_cast<ThreadBuffer>(threadState.buffer)) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        buffer->threadName = name;
+    }
+}
+
+void Tracer::complete(const char* name, int64_t startNs, int64_t endNs, uint64_t frameId) {
+    Event event;
+    event.name = name;
+    event.timestampNs = startNs;
+    event.durationNs = endNs - startNs;
+    event.frameId = frameId;
+    event.phase = 'X';
+    record(event);
+}
+
+void Tracer::instant(const char* name) {
+    if (!enabled())
+        return;
+
+    Event event;
+    event.name = name;
+    event.timestampNs = StreamMetrics::now();
+    event.phase = 'i';
+    record(event);
+}
+
+void Tracer::flow(TraceFlow phase, uint64_t frameId) {
+    if (!enabled() || frameId == 0)
+        return;
+
+    Event event;
+    event.name = "frame";
+    event.timestampNs = StreamMetrics::now();
+    event.frameId = frameId;
+    event.phase = static_cast<char>(phase);
+    record(event);
+}
+
+uint64_t Tracer::frameId(uint32_t stream, int64_t pts) {
+    if (pts == NO_PTS)
+        return 0;
+    return (static_cast<uint64_t>(stream) << PTS_BITS) |
+           (static_cast<uint64_t>(pts) & ((uint64_t(1) << PTS_BITS) - 1));
+}
+
+uint32_t Tracer::nextStreamId() {
+    static std::atomic<uint32_t> next = 1;
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Tracer::record(const Event& event) {
+    if (!enabled())
+        return;
+
+    // A thread registers on its first event after each start()
+    Tracer& tracer = global();
+    uint64_t currentGeneration = tracer.generation.load(std::memory_order_acquire);
+    if (!threadState.buffer || threadState.generation != currentGeneration) {
+        threadState.buffer = tracer.registerThread(threadState.name);
+        threadState.generation = currentGeneration;
+    }
+
+    auto* buffer = static_cast<ThreadBuffer*>(threadState.buffer.get());
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    buffer->events[buffer->next] = event;
+    if (++buffer->next == buffer->events.size()) {
+        buffer->next = 0;
+        buffer->wrapped = true;
+    }
+}
+
+std::shared_ptr<Tracer::ThreadBuffer> Tracer::registerThread(const std::string& threadName) {
+    auto buffer = std::make_shared<ThreadBuffer>();
+    std::lock_guard<std::mutex> lock(mutex);
+    buffer->events.resize(eventsPerThread);
+    buffer->threadId = nextThreadId++;
+    buffer->threadName = threadName.empty() ? "thread " + std::to_string(buffer->threadId) : threadName;
+
+    // Kept after the thread exits, so its events still make it into the dump
+    buffers.push_back(buffer);
+    return buffer;
+}
+
+std::vector<Tracer::ThreadEvents> Tracer::collect() {
+    std::vector<std::shared_ptr<ThreadBuffer>> current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = buffers;
+    }
+
+    std::vector<ThreadEvents> threads;
+    threads.reserve(current.size());
+    for (const auto& buffer : current) {
+        ThreadEvents thread;
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        thread.threadId = buffer->threadId;
+        thread.threadName = buffer->threadName;
+        if (buffer->wrapped) {
+            thread.events.assign(buffer->events.begin() + static_cast<std::ptrdiff_t>(buffer->next), buffer->events.end());
+        }
+        thread.events.insert(thread.events.end(), buffer->events.begin(),
+                             buffer->events.begin() + static_cast<std::ptrdiff_t>(buffer->next));
+        threads.push_back(std::move(thread));
+    }
+    return threads;
+}
+
+void Tracer::writeEvents(std::ostream& out, const std::vector<ThreadEvents>& threads, int64_t originNs) {
+    // Trace-event timestamps are microseconds
+    auto micros = [](int64_t ns) { return static_cast<double>(ns) / 1e3; };
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const ThreadEvents& thread : threads) {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.threadId
+            << ",\"args\":{\"name\":\"" << escapeJson(thread.threadName) << "\"}}";
+        first = false;
+
+        for (const Event& event : thread.events) {
+            out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase
+                << "\",\"pid\":1,\"tid\":" << thread.threadId
+                << ",\"ts\":" << micros(event.timestampNs - originNs);
+
+            switch (event.phase) {
+                case 'X':
+                    out << ",\"cat\":\"v2p\",\"dur\":" << micros(event.durationNs);
+                    if (event.frameId != 0)
+                        out << ",\"args\":{\"frame\":" << event.frameId << "}";
+                    break;
+                case 'i':
+                    out << ",\"cat\":\"v2p\",\"s\":\"t\"";
+                    break;
+                default:
+                    // Flow arrows bind to the span enclosing their timestamp
+                    out << ",\"cat\":\"frame\",\"id\":" << event.frameId;
+                    if (event.phase == static_cast<char>(TraceFlow::END))
+                        out << ",\"bp\":\"e\"";
+                    break;
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}" << std::endl;
+}
+
+bool Tracer::writeFile(const std::string& path, const std::vector<ThreadEvents>& threads, int64_t originNs) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Could not open trace file: " << path << std::endl;
+        return false;
+    }
+    writeEvents(file, threads, originNs);
+    return static_cast<bool>(file);
+}
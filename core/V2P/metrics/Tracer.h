@@ -0,0 +1,193 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "V2P/metrics/StreamMetrics.h"
+
+/**
+ * @brief Phases of a flow: the arrows that tie one frame's spans together
+ * across threads, from the packet being demuxed to the frame being presented.
+ */
+enum class TraceFlow : char {
+    START = 's',
+    STEP = 't',
+    END = 'f'
+};
+
+/**
+ * @brief Opt-in timeline recorder that writes Chrome trace-event JSON
+ * (chrome://tracing, ui.perfetto.dev).
+ *
+ * Every thread records into its own fixed-size ring, so recording never
+ * allocates and only takes that thread's uncontended lock; once a ring is
+ * full the oldest events are overwritten and a dump shows the most recent
+ * stretch of each thread. Event names must be string literals: only the
+ * pointer is stored.
+ *
+ * While stopped, the cost of a span is one relaxed atomic load.
+ */
+class Tracer {
+public:
+    static constexpr size_t DEFAULT_EVENTS_PER_THREAD = 1 << 16;
+
+    static Tracer& global();
+
+    ~Tracer();
+
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Clears whatever was recorded and starts recording.
+     * @param path Where dump() writes; stall dumps go next to it.
+     * @param eventsPerThread Ring size of every thread.
+     */
+    void start(const std::string& path, size_t eventsPerThread = DEFAULT_EVENTS_PER_THREAD);
+
+    void stop();
+
+    /**
+     * @brief Dumps automatically whenever reportStall() sees a gap of at
+     * least this many seconds. 0 turns the trigger off.
+     */
+    void setStallThreshold(double seconds);
+
+    /**
+     * @brief Writes what the rings hold now to the path given to start().
+     * Recording carries on. @return False if the file could not be written.
+     */
+    bool dump();
+
+    /**
+     * @brief Writes what the rings hold now as trace-event JSON.
+     */
+    void writeJson(std::ostream& out);
+
+    /**
+     * @brief Reports a gap where something should have happened, such as
+     * the time between two presents. At or above the stall threshold the
+     * trace is written to "<path>-stall<N>.json" in the background, at
+     * most once per STALL_DUMP_COOLDOWN.
+     */
+    void reportStall(const char* what, double seconds);
+
+    /**
+     * @brief Names the calling thread in the timeline. Cheap enough to call
+     * unconditionally when a thread starts.
+     */
+    static void setThreadName(const std::string& name);
+
+    /**
+     * @brief Records a span that ran from startNs to endNs (StreamMetrics::now()).
+     * @param frameId Optional frame the work was for; shown in the span's arguments.
+     */
+    static void complete(const char* name, int64_t startNs, int64_t endNs, uint64_t frameId = 0);
+
+    static void instant(const char* name);
+
+    /**
+     * @brief Adds a frame's flow arrow at this moment. The arrow attaches to
+     * the span that is open on this thread, so call it inside a TraceScope.
+     */
+    static void flow(TraceFlow phase, uint64_t frameId);
+
+    /**
+     * @brief A frame id that every stage can derive on its own: the demuxer
+     * from a packet's pts, the decoder from the frame's pts.
+     * @param stream A per-stream number from nextStreamId().
+     * @return The id, or 0 if the pts is unknown.
+     */
+    static uint64_t frameId(uint32_t stream, int64_t pts);
+
+    static uint32_t nextStreamId();
+
+private:
+    static constexpr double STALL_DUMP_COOLDOWN = 5.0;
+
+    struct Event {
+        const char* name = nullptr;
+        int64_t timestampNs = 0;
+        int64_t durationNs = 0;
+        uint64_t frameId = 0;
+        char phase = 0;
+    };
+
+    struct ThreadBuffer {
+        std::mutex mutex;
+        std::vector<Event> events;  // Ring
+        size_t next = 0;
+        bool wrapped = false;
+        uint32_t threadId = 0;
+        std::string threadName;
+    };
+
+    // One thread's events, oldest first, copied out of its ring for writing
+    struct ThreadEvents {
+        uint32_t threadId = 0;
+        std::string threadName;
+        std::vector<Event> events;
+    };
+
+    Tracer() = default;
+
+    static void record(const Event& event);
+    std::shared_ptr<ThreadBuffer> registerThread(const std::string& threadName);
+    std::vector<ThreadEvents> collect();
+    static void writeEvents(std::ostream& out, const std::vector<ThreadEvents>& threads, int64_t originNs);
+    static bool writeFile(const std::string& path, const std::vector<ThreadEvents>& threads, int64_t originNs);
+
+    static std::atomic<bool> active;
+
+    // Bumped by start(); threads holding a buffer of an older generation register again
+    std::atomic<uint64_t> generation = 0;
+
+    std::mutex mutex;  // Guards everything below
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    size_t eventsPerThread = DEFAULT_EVENTS_PER_THREAD;
+    uint32_t nextThreadId = 1;
+    std::string outputPath;
+    int64_t originNs = 0;
+    double stallThreshold = 0.0;
+    int64_t lastStallDumpNs = 0;
+    int stallDumps = 0;
+    std::thread stallWriter;
+};
+
+/**
+ * @brief Records the enclosing block as one span.
+ */
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, uint64_t frameId = 0)
+        : name(name), frameId(frameId), startNs(Tracer::enabled() ? StreamMetrics::now() : 0) {}
+
+    ~TraceScope() {
+        if (startNs != 0) {
+            Tracer::complete(name, startNs, StreamMetrics::now(), frameId);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    /**
+     * @brief Adds a flow arrow for this span and tags the span with the frame.
+     */
+    void flow(TraceFlow phase, uint64_t id) {
+        if (startNs != 0 && id != 0) {
+            frameId = id;
+            Tracer::flow(phase, id);
+        }
+    }
+
+private:
+    const char* name;
+    uint64_t frameId;
+    int64_t startNs;
+};
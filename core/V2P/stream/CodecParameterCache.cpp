@@ -0,0 +1,76 @@
+#include "CodecParameterCache.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+namespace {
+    // What a decoder and our output setup need before the first packet
+    bool isComplete(const AVCodecParameters* parameters) {
+        switch (parameters->codec_type) {
+            case AVMEDIA_TYPE_VIDEO:
+                return parameters->width > 0 && parameters->height > 0 && parameters->format >= 0;
+            case AVMEDIA_TYPE_AUDIO:
+                return parameters->sample_rate > 0 && parameters->ch_layout.nb_channels > 0;
+            default:
+                return true; // Never decoded
+        }
+    }
+}
+
+CodecParameterCache& CodecParameterCache::global() {
+    static CodecParameterCache cache;
+    return cache;
+}
+
+void CodecParameterCache::store(const std::string& key, const AVFormatContext* formatContext) {
+    std::vector<CachedStream> streams;
+    for (unsigned int i = 0; i < formatContext->nb_streams; ++i) {
+        const AVStream* stream = formatContext->streams[i];
+
+        CachedStream cached;
+        cached.parameters.reset(avcodec_parameters_alloc(), [](AVCodecParameters* p) { avcodec_parameters_free(&p); });
+        if (!cached.parameters || avcodec_parameters_copy(cached.parameters.get(), stream->codecpar) < 0)
+            return;
+        cached.frameRateNum = stream->avg_frame_rate.num;
+        cached.frameRateDen = stream->avg_frame_rate.den;
+        streams.push_back(std::move(cached));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.size() >= MAX_ENTRIES && entries.find(key) == entries.end()) {
+        entries.clear(); // Channel lists are far smaller; this only bounds a runaway
+    }
+    entries[key] = std::move(streams);
+}
+
+bool CodecParameterCache::apply(const std::string& key, AVFormatContext* formatContext) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    const std::vector<CachedStream>* cached = it == entries.end() ? nullptr : &it->second;
+
+    bool complete = true;
+    for (unsigned int i = 0; i < formatContext->nb_streams; ++i) {
+        AVStream* stream = formatContext->streams[i];
+        if (isComplete(stream->codecpar))
+            continue;
+
+        const AVCodecParameters* source = cached && i < cached->size() ? (*cached)[i].parameters.get() : nullptr;
+        if (!source || source->codec_type != stream->codecpar->codec_type ||
+            source->codec_id != stream->codecpar->codec_id ||
+            avcodec_parameters_copy(stream->codecpar, source) < 0) {
+            complete = false;
+            continue;
+        }
+        if (stream->avg_frame_rate.num == 0 && (*cached)[i].frameRateDen > 0) {
+            stream->avg_frame_rate = { (*cached)[i].frameRateNum, (*cached)[i].frameRateDen };
+        }
+    }
+    return complete && formatContext->nb_streams > 0;
+}
+
+void CodecParameterCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Forward-declare FFmpeg types
+struct AVFormatContext;
+struct AVCodecParameters;
+
+/**
+ * @brief Codec parameters of inputs opened before, so that reopening a
+ * channel (or opening another one encoded the same way) can skip
+ * avformat_find_stream_info(), which reads and decodes ahead to fill them in.
+ *
+ * Process-wide and thread-safe. Keys are up to the caller: a URL, or a
+ * description of the encoding such as an HLS variant's CODECS and RESOLUTION.
+ */
+class CodecParameterCache {
+public:
+    static CodecParameterCache& global();
+
+    /**
+     * @brief Remembers the parameters of every stream of a probed input.
+     */
+    void store(const std::string& key, const AVFormatContext* formatContext);
+
+    /**
+     * @brief Completes the streams of a freshly opened input from the cache.
+     * Streams the demuxer already described fully are left alone; the
+     * others are filled from the cached stream of the same index, type and codec.
+     * @return True if every audio and video stream is now complete, so
+     * probing can be skipped.
+     */
+    bool apply(const std::string& key, AVFormatContext* formatContext) const;
+
+    void clear();
+
+private:
+    static constexpr size_t MAX_ENTRIES = 256;
+
+    struct CachedStream {
+        std::shared_ptr<AVCodecParameters> parameters;
+        int frameRateNum = 0;
+        int frameRateDen = 0;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::vector<CachedStream>> entries;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "V2P/utils/DecoderThreadBudget.h"
+
+/**
+ * @brief How the video decoder spreads work across its threads.
+ */
+enum class DecoderThreading {
+    AUTO,   // Let the codec pick frame or slice threading
+    FRAME,  // One frame per thread; best throughput, adds one frame of latency per thread
+    SLICE   // Slices of the same frame in parallel; no added latency
+};
+
+/**
+ * @brief Threading settings for a stream's video decoder. Applied when the stream is opened.
+ */
+struct DecoderConfig {
+    // Decoder threads to request; 0 means one per hardware thread
+    int threadCount = 0;
+
+    DecoderThreading threading = DecoderThreading::AUTO;
+
+    // Optional budget shared with other streams; the request is capped by
+    // what is left in it
+    std::shared_ptr<DecoderThreadBudget> budget;
+};
+
+/**
+ * @brief Video pipeline timings of one stream, per stage.
+ */
+struct DecodeStats {
+    uint64_t framesDecoded = 0;
+    double totalDecodeMs = 0.0;  // Time spent in send_packet/receive_frame
+    double lastDecodeMs = 0.0;
+    int threadCount = 0;         // Threads granted to the decoder
+
+    uint64_t packetsDemuxed = 0; // Audio and video
+    double totalDemuxMs = 0.0;   // Time spent reading packets
+    uint64_t framesConverted = 0;
+    double totalConvertMs = 0.0; // Time spent in pixel format conversion
+    uint64_t framesQueued = 0;
+    double totalQueueMs = 0.0;   // Time spent handing frames to the client, including waits for room
+
+    double averageDecodeMs() const {
+        return framesDecoded ? totalDecodeMs / static_cast<double>(framesDecoded) : 0.0;
+    }
+};
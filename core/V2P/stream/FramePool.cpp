@@ -0,0 +1,203 @@
+#include "FramePool.h"
+
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+#include <iostream>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+}
+
+namespace {
+    constexpr size_t BUFFER_ALIGNMENT = 64;
+
+    // Every buffer is preceded by one aligned block that records its payload
+    // size, so a released buffer can be told apart after a resolution change.
+    constexpr size_t HEADER_SIZE = BUFFER_ALIGNMENT;
+
+    size_t alignUp(size_t value) {
+        return (value + BUFFER_ALIGNMENT - 1) & ~(BUFFER_ALIGNMENT - 1);
+    }
+
+    uint8_t* allocatePayload(size_t size) {
+        auto* base = static_cast<uint8_t*>(std::aligned_alloc(BUFFER_ALIGNMENT, HEADER_SIZE + alignUp(size)));
+        if (!base) {
+            return nullptr;
+        }
+        *reinterpret_cast<size_t*>(base) = size;
+        return base + HEADER_SIZE;
+    }
+
+    size_t payloadSize(const uint8_t* payload) {
+        return *reinterpret_cast<const size_t*>(payload - HEADER_SIZE);
+    }
+
+    void freePayload(uint8_t* payload) {
+        std::free(payload - HEADER_SIZE);
+    }
+
+    struct PlaneLayout {
+        size_t offsets[4] = {};
+        int linesizes[4] = {};
+        int planeCount = 0;
+        size_t size = 0;
+    };
+
+    bool computeLayout(AVPixelFormat format, int width, int height, PlaneLayout& layout) {
+        int linesizes[4];
+        if (av_image_fill_linesizes(linesizes, format, width) < 0) {
+            return false;
+        }
+
+        // Pad every row and every plane to the alignment boundary
+        ptrdiff_t alignedLinesizes[4];
+        for (int i = 0; i < 4; ++i) {
+            alignedLinesizes[i] = static_cast<ptrdiff_t>(alignUp(linesizes[i]));
+        }
+
+        size_t planeSizes[4];
+        if (av_image_fill_plane_sizes(planeSizes, format, height, alignedLinesizes) < 0) {
+            return false;
+        }
+
+        layout = PlaneLayout{};
+        for (int i = 0; i < 4 && planeSizes[i] > 0; ++i) {
+            layout.offsets[i] = layout.size;
+            layout.linesizes[i] = static_cast<int>(alignedLinesizes[i]);
+            layout.size += alignUp(planeSizes[i]);
+            layout.planeCount = i + 1;
+        }
+        return layout.size > 0;
+    }
+}
+
+struct FramePool::State {
+    std::mutex mutex;
+    std::vector<uint8_t*> idle;
+    FramePoolStats stats;
+    bool retired = false; // The owning FramePool has been destroyed
+
+    int format = -1;
+    int width = 0;
+    int height = 0;
+    PlaneLayout layout;
+
+    void freeIdle() {
+        for (uint8_t* payload : idle) {
+            freePayload(payload);
+        }
+        idle.clear();
+    }
+};
+
+FramePool::FramePool()
+    : state(new State()) {}
+
+FramePool::~FramePool() {
+    bool destroy;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->retired = true;
+        state->freeIdle();
+        destroy = state->stats.inUse == 0;
+    }
+
+    // Otherwise the last released buffer deletes the state
+    if (destroy) {
+        delete state;
+    }
+}
+
+bool FramePool::acquire(AVFrame* frame, int format, int width, int height) {
+    uint8_t* payload = nullptr;
+    PlaneLayout layout;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+
+        if (format != state->format || width != state->width || height != state->height) {
+            PlaneLayout newLayout;
+            if (!computeLayout(static_cast<AVPixelFormat>(format), width, height, newLayout)) {
+                std::cerr << "FramePool: unsupported frame layout." << std::endl;
+                return false;
+            }
+
+            // Buffers of the old size are of no use anymore
+            if (newLayout.size != state->stats.bufferSize) {
+                state->freeIdle();
+                state->stats.bufferSize = newLayout.size;
+            }
+            state->format = format;
+            state->width = width;
+            state->height = height;
+            state->layout = newLayout;
+        }
+
+        if (!state->idle.empty()) {
+            payload = state->idle.back();
+            state->idle.pop_back();
+            state->stats.hits++;
+        } else {
+            payload = allocatePayload(state->stats.bufferSize);
+            if (!payload) {
+                std::cerr << "FramePool: could not allocate frame buffer." << std::endl;
+                return false;
+            }
+            state->stats.misses++;
+        }
+
+        state->stats.inUse++;
+        if (state->stats.inUse > state->stats.highWater) {
+            state->stats.highWater = state->stats.inUse;
+        }
+        layout = state->layout;
+    }
+
+    AVBufferRef* buffer = av_buffer_create(payload, layout.size, &FramePool::releaseBuffer, state, 0);
+    if (!buffer) {
+        releaseBuffer(state, payload);
+        return false;
+    }
+
+    frame->buf[0] = buffer;
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    for (int i = 0; i < layout.planeCount; ++i) {
+        frame->data[i] = payload + layout.offsets[i];
+        frame->linesize[i] = layout.linesizes[i];
+    }
+    frame->extended_data = frame->data;
+    return true;
+}
+
+void FramePool::trim() {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->freeIdle();
+}
+
+FramePoolStats FramePool::getStats() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->stats;
+}
+
+void FramePool::releaseBuffer(void* opaque, uint8_t* data) {
+    auto* state = static_cast<State*>(opaque);
+    bool destroy;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->stats.inUse--;
+
+        if (!state->retired && payloadSize(data) == state->stats.bufferSize) {
+            state->idle.push_back(data);
+        } else {
+            freePayload(data);
+        }
+        destroy = state->retired && state->stats.inUse == 0;
+    }
+
+    if (destroy) {
+        delete state;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Forward-declare FFmpeg types
+struct AVFrame;
+
+/**
+ * @brief Counters describing how well a FramePool is recycling buffers.
+ *
+ * In steady-state playback misses should stop growing: every frame is then
+ * served from a buffer that a consumer has already released.
+ */
+struct FramePoolStats {
+    uint64_t hits = 0;        // Requests served from a recycled buffer
+    uint64_t misses = 0;      // Requests that had to allocate a new buffer
+    size_t inUse = 0;         // Buffers currently held by frames
+    size_t highWater = 0;     // Largest number of buffers ever held at once
+    size_t bufferSize = 0;    // Bytes per buffer for the current resolution
+};
+
+/**
+ * @brief A per-stream pool of preallocated, 64-byte-aligned frame buffers.
+ *
+ * Buffers are handed out as ref-counted AVBufferRefs, so they return to the
+ * pool on their own when the last VideoFrame referencing them is dropped,
+ * on whichever thread that happens. A change of resolution or pixel format
+ * retires the old buffers; those still in use are freed once released.
+ */
+class FramePool {
+public:
+    FramePool();
+    ~FramePool();
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    /**
+     * @brief Attaches a pooled buffer to an empty AVFrame.
+     * @param frame [out] An unreferenced frame; on success its data, linesize
+     * and buf[0] point into the pooled buffer.
+     * @param format The AVPixelFormat of the image.
+     * @param width The image width in pixels.
+     * @param height The image height in pixels.
+     * @return True on success, false on failure.
+     */
+    bool acquire(AVFrame* frame, int format, int width, int height);
+
+    /**
+     * @brief Frees every idle buffer. Buffers in use are freed on release.
+     */
+    void trim();
+
+    FramePoolStats getStats() const;
+
+private:
+    struct State;
+
+    static void releaseBuffer(void* opaque, uint8_t* data);
+
+    State* state;
+};
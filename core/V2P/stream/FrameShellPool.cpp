@@ -0,0 +1,62 @@
+#include "FrameShellPool.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+FrameShellPool& FrameShellPool::global() {
+    // Never destroyed: frames held by other statics may still be dropped on exit
+    static FrameShellPool* pool = new FrameShellPool();
+    return *pool;
+}
+
+FrameShellPool::FrameShellPool(size_t maxIdle)
+    : maxIdle(maxIdle) {
+    idle.reserve(maxIdle);
+}
+
+FrameShellPool::~FrameShellPool() {
+    for (AVFrame* frame : idle) {
+        av_frame_free(&frame);
+    }
+}
+
+AVFrame* FrameShellPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!idle.empty()) {
+            AVFrame* frame = idle.back();
+            idle.pop_back();
+            hits++;
+            return frame;
+        }
+        misses++;
+    }
+    return av_frame_alloc();
+}
+
+void FrameShellPool::release(AVFrame* frame) {
+    if (!frame) {
+        return;
+    }
+
+    // The pixels go back to their pool now, not when the shell is reused
+    av_frame_unref(frame);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (idle.size() < maxIdle) {
+            idle.push_back(frame);
+            return;
+        }
+    }
+    av_frame_free(&frame);
+}
+
+FrameShellPoolStats FrameShellPool::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    FrameShellPoolStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.idle = idle.size();
+    return stats;
+}
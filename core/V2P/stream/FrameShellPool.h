@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Forward-declare FFmpeg types
+struct AVFrame;
+
+/**
+ * @brief Counters describing how well the FrameShellPool is recycling AVFrames.
+ *
+ * In steady-state playback misses should stop growing: every VideoFrame is
+ * then built on an AVFrame a consumer has already dropped.
+ */
+struct FrameShellPoolStats {
+    uint64_t hits = 0;   // Shells served from a recycled one
+    uint64_t misses = 0; // Shells that had to be allocated
+    size_t idle = 0;     // Shells waiting to be reused
+};
+
+/**
+ * @brief Recycles the AVFrame structs that VideoFrames hold their pixels by.
+ *
+ * Only the struct is kept, like PacketPool does for packets: release()
+ * drops the frame's buffer references, so the pixels go back to their own
+ * pool (FramePool, or the decoder's) at once. VideoFrames outlive the
+ * streams that made them, so there is one pool for the whole process.
+ * Thread-safe.
+ */
+class FrameShellPool {
+public:
+    static FrameShellPool& global();
+
+    /**
+     * @param maxIdle Shells kept for reuse; more are freed on release.
+     */
+    explicit FrameShellPool(size_t maxIdle = 512);
+    ~FrameShellPool();
+
+    FrameShellPool(const FrameShellPool&) = delete;
+    FrameShellPool& operator=(const FrameShellPool&) = delete;
+
+    /**
+     * @brief Gets an empty frame, owned by the caller.
+     * @return The frame, or nullptr if it could not be allocated.
+     */
+    AVFrame* acquire();
+
+    /**
+     * @brief Hands a frame back, unreferencing it. Null is ignored.
+     */
+    void release(AVFrame* frame);
+
+    FrameShellPoolStats getStats() const;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<AVFrame*> idle; // Reserved up front, so that releasing never allocates
+    size_t maxIdle;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
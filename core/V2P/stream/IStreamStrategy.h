@@ -2,9 +2,24 @@
 
 #include <string>
 #include <functional>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
 
 #include "V2P/stream/Packet.h"
 #include "V2P/stream/VideoFrame.h"
+#include "V2P/stream/FramePool.h"
+#include "V2P/stream/PacketPool.h"
+#include "V2P/stream/DecoderConfig.h"
+#include "V2P/stream/PrefetchConfig.h"
+#include "V2P/stream/StartupConfig.h"
+#include "V2P/stream/TimeShiftConfig.h"
+#include "V2P/stream/SeekConfig.h"
+#include "V2P/stream/PacketQueue.h"
+#include "V2P/metrics/StreamMetrics.h"
+#include "V2P/writer/RecorderConfig.h"
 #include "V2P/utils/ThreadSafeFrameQueue.h"
 
 
@@ -39,21 +54,252 @@ public:
     virtual PacketType processNextFrame(VideoFrame& outFrame) = 0;
 
     /**
-     * @brief Gets the current playback clock in milliseconds.
-     * @return The current playback time in milliseconds.
+     * @brief Non-blocking variant of processNextFrame() for shared worker pools.
+     * Only decodes input that is already buffered.
+     * @param outFrame [out] The VideoFrame struct to be filled with data.
+     * @return VIDEO if a frame was produced, OTHER if no input is ready yet,
+     * ERROR on error or end-of-stream. Strategies without internal buffering
+     * fall back to the blocking call.
+     */
+    virtual PacketType tryProcessNextFrame(VideoFrame& outFrame) { return processNextFrame(outFrame); }
+
+    /**
+     * @brief Batched variant of processNextFrame() and tryProcessNextFrame():
+     * feeds the decoder until it yields, then takes every frame it has ready
+     * (frame threading and B-frame reordering release several at once), as
+     * far as the batch has room. At the end of the input the decoder is
+     * drained, so its last frames are handed out too.
+     * @param outFrames [out] Frames are appended after those already in it.
+     * @param wait Whether to block for input, as processNextFrame() does.
+     * @return VIDEO if frames were appended, OTHER if no input is ready yet
+     * or the batch is full, ERROR on error or once the end of the stream is
+     * drained. Strategies without batching append one frame per call.
+     */
+    virtual PacketType processNextFrames(VideoFrameBatch& outFrames, bool wait) {
+        if (outFrames.full())
+            return PacketType::OTHER;
+        VideoFrame& frame = outFrames.frames[outFrames.count];
+        PacketType result = wait ? processNextFrame(frame) : tryProcessNextFrame(frame);
+        if (result == PacketType::VIDEO)
+            outFrames.count++;
+        return result;
+    }
+
+    /**
+     * @brief Gets the current playback clock.
+     * When audio is pulled through readAudio(), this is the position being
+     * heard right now; with an AudioCallback it is the pts of the last
+     * decoded audio, and the caller must account for what it has queued.
+     * @return The current playback time in seconds.
      */
     virtual double getClock() = 0;
 
+    /**
+     * @brief Pulls decoded audio (interleaved signed 16-bit stereo, 44.1 kHz)
+     * when no AudioCallback is set. Never blocks; meant to be called from the
+     * audio device's callback. Underruns are padded with silence.
+     * @param out [out] The buffer to fill.
+     * @param size The number of bytes to fill.
+     * @return The number of bytes of real audio written.
+     */
+    virtual int readAudio(uint8_t* out, int size) {
+        std::fill(out, out + size, uint8_t(0));
+        return 0;
+    }
+
+    /**
+     * @brief Sets how long the audio device takes to play what readAudio() returned.
+     */
+    virtual void setAudioOutputLatency(double seconds) {}
+
+    /**
+     * @brief Sets the size the client draws the stream at, in pixels.
+     * Adaptive streams skip variants larger than that. Any thread, any time.
+     */
+    virtual void setDisplaySize(int width, int height) {}
+
+    /**
+     * @brief Sets the size of the frames handed out, in pixels; 0 for the
+     * decoded size. Frames are scaled down to it (never up) as they are
+     * converted, so their memory follows the tile rather than the source,
+     * and codecs with reduced-resolution decoding decode at it. Any thread,
+     * any time; it takes effect within a frame, or a keyframe for the decoder.
+     */
+    virtual void setOutputSize(int width, int height) {}
+
+    /**
+     * @brief Changes how many decoder threads the stream asks its budget
+     * for; 0 goes back to DecoderConfig::threadCount. An open decoder is
+     * replaced by one with the new share at the next keyframe, and a share
+     * the budget could not grant in full is asked for again at each
+     * keyframe. Any thread, any time.
+     */
+    virtual void setDecoderThreadCount(int threads) {}
+
+    /**
+     * @brief Sets what to call when a non-blocking processNextFrames() that
+     * found no input may find some now: video arrived, or the input ended.
+     * It runs on the demuxing thread and must not block; nullptr removes
+     * it, and once that returns it is no longer running.
+     * @return False if the strategy cannot tell; the caller then has to poll.
+     */
+    virtual bool setInputCallback(std::function<void()> callback) { return false; }
+
+    /**
+     * @brief Puts an open stream on warm standby, or brings it back.
+     * In standby the stream keeps demuxing at real-time pace but decodes
+     * nothing; it holds the compressed packets since the last video
+     * keyframe, which are handed to the decoders when it comes back.
+     * Call while no tryProcessNextFrame() runs for the stream; a blocked
+     * processNextFrame() simply keeps waiting for packets.
+     * @return False if the strategy cannot stand by (it then keeps playing).
+     */
+    virtual bool setStandby(bool enabled) { return !enabled; }
+
+    /**
+     * @brief Starts copying the stream's compressed packets into files, see
+     * StreamRecorder. Nothing is decoded or encoded for it, and on standby
+     * the stream records without decoding at all. Call on an open stream.
+     * @return False if the strategy cannot record, or already does.
+     */
+    virtual bool startRecording(const RecorderConfig& config) { return false; }
+
+    /**
+     * @brief Finalizes the recording. Its counters remain readable.
+     */
+    virtual void stopRecording() {}
+
+    virtual RecorderStats getRecorderStats() const { return {}; }
+
+    /**
+     * @brief Moves playback to a stream time, in seconds. Decoding restarts
+     * at the last keyframe at or before that time; in SeekMode::ACCURATE the
+     * frames and audio ahead of the time itself are decoded but not output.
+     * With a time-shift buffer this replays the buffer without touching the
+     * network, and past the live edge it goes back to live; a recorded input
+     * is moved by the demuxer, until it reaches its end.
+     * What waits for the decoders is dropped. Any thread; it completes
+     * asynchronously, see getSeekStats().
+     * A recorded input stays seekable after its end has been read, until
+     * the decoders have played it out.
+     * @return False if the stream cannot seek, or its demuxer has stopped.
+     */
+    virtual bool seek(double seconds, SeekMode mode) { return false; }
+
+    virtual SeekStats getSeekStats() const { return {}; }
+
+    /**
+     * @brief Pauses or resumes playback. While paused readAudio() returns
+     * silence and keeps its clock still, and the pipeline stops once its
+     * queues are full; a time-shift buffer keeps recording the live edge.
+     */
+    virtual void setPaused(bool pause) {}
+
+    /**
+     * @brief What the time-shift buffer holds, see TimeShiftConfig.
+     */
+    virtual TimeShiftRange getTimeShiftRange() const { return {}; }
+
+    /**
+     * @brief Gets the recycling counters of the strategy's frame buffer pool.
+     * @return The pool counters, or all zeros if the strategy has no pool.
+     */
+    virtual FramePoolStats getFramePoolStats() const { return {}; }
+
+    /**
+     * @brief Gets the recycling counters of the strategy's packet pool.
+     * @return The pool counters, or all zeros if the strategy has no pool.
+     */
+    virtual PacketPoolStats getPacketPoolStats() const { return {}; }
+
+    /**
+     * @brief Gets the video decode timings of the stream.
+     * @return The timings, or all zeros if the strategy does not measure them.
+     */
+    virtual DecodeStats getDecodeStats() const { return {}; }
+
     /**
      * @brief Closes the stream and releases all resources.
      */
     virtual void close() = 0;
 
+    /**
+     * @brief Wakes up a blocked processNextFrame() and makes it fail.
+     * Safe to call from any thread; call close() once the caller has returned.
+     */
+    virtual void interrupt() {}
+
+    /**
+     * @brief Gets the number of items waiting between the pipeline stages.
+     * @return The depths, or all zeros if the strategy has no internal queues.
+     */
+    virtual QueueDepths getQueueDepths() const { return {}; }
+
+    /**
+     * @brief What the segment prefetcher did, if the stream went through one.
+     */
+    virtual PrefetchStats getPrefetchStats() const { return {}; }
+
     void enableAudio() { isAudioEnabled = true; }
     void disableAudio() { isAudioEnabled = false; }
+
+    /**
+     * @brief Declares which pixel formats the client can render. Call before open().
+     * @param formats Accepted formats, most preferred first. Frames are only
+     * converted when the decoder output is not in this list.
+     */
+    void setAcceptedFormats(std::vector<PixelFormat> formats) {
+        if (!formats.empty())
+            acceptedFormats = std::move(formats);
+    }
+
+    /**
+     * @brief Sets the video decoder's threading. Call before open().
+     */
+    void setDecoderConfig(DecoderConfig config) { decoderConfig = std::move(config); }
+
+    /**
+     * @brief Sets how HLS segments are fetched. Call before open().
+     */
+    void setPrefetchConfig(PrefetchConfig config) { prefetchConfig = config; }
+
+    /**
+     * @brief Sets how the stream probes and starts. Call before open().
+     */
+    void setStartupConfig(StartupConfig config) { startupConfig = config; }
+
+    /**
+     * @brief Sets the time-shift (DVR) buffer. Call before open().
+     */
+    void setTimeShiftConfig(TimeShiftConfig config) { timeShiftConfig = std::move(config); }
+
+    /**
+     * @brief Sets how recorded inputs seek. Call before open().
+     */
+    void setSeekConfig(SeekConfig config) { seekConfig = std::move(config); }
+
+    /**
+     * @brief Lets the strategy see how many decoded frames wait for the
+     * client. Call before open(); the probe must stay valid until close().
+     */
+    void setFrameQueueProbe(std::function<size_t()> probe) { frameQueueProbe = std::move(probe); }
+
+    /**
+     * @brief The stream's latency histograms and counters. The strategy
+     * records the stages it runs; its owner records the rest.
+     */
+    const std::shared_ptr<StreamMetrics>& getMetrics() const { return metrics; }
 private:
     ThreadSafeFrameQueue frameQueue;
 
 protected:
-    bool isAudioEnabled = false;
+    std::atomic<bool> isAudioEnabled = false;
+    std::vector<PixelFormat> acceptedFormats = { PixelFormat::RGBA };
+    DecoderConfig decoderConfig;
+    PrefetchConfig prefetchConfig;
+    StartupConfig startupConfig;
+    TimeShiftConfig timeShiftConfig;
+    SeekConfig seekConfig;
+    std::function<size_t()> frameQueueProbe;
+    std::shared_ptr<StreamMetrics> metrics = std::make_shared<StreamMetrics>();
 };
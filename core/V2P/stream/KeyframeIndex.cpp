@@ -0,0 +1,98 @@
+#include "KeyframeIndex.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace {
+    const char* const SIDECAR_MAGIC = "v2p-keyframes";
+    constexpr int SIDECAR_VERSION = 1;
+}
+
+void KeyframeIndex::add(int64_t pts, double seconds) {
+    auto it = std::lower_bound(keyframes.begin(), keyframes.end(), pts,
+                               [](const Keyframe& keyframe, int64_t value) { return keyframe.pts < value; });
+    if (it == keyframes.end() || it->pts != pts) {
+        Keyframe keyframe;
+        keyframe.pts = pts;
+        keyframe.seconds = seconds;
+        it = keyframes.insert(it, keyframe);
+    }
+
+    // Read straight after the previous one: the gap between them is known
+    if (hasPrevious && it != keyframes.begin() && std::prev(it)->pts == previousPts) {
+        std::prev(it)->nextKnown = true;
+    }
+    previousPts = pts;
+    hasPrevious = true;
+}
+
+void KeyframeIndex::endRun() {
+    // The input ended after the previous keyframe: nothing follows the last one
+    if (hasPrevious && !keyframes.empty() && keyframes.back().pts == previousPts) {
+        keyframes.back().nextKnown = true;
+    }
+    hasPrevious = false;
+}
+
+bool KeyframeIndex::find(double seconds, Keyframe& out) const {
+    auto it = std::upper_bound(keyframes.begin(), keyframes.end(), seconds,
+                               [](double value, const Keyframe& keyframe) { return value < keyframe.seconds; });
+    if (it == keyframes.begin()) {
+        return false;
+    }
+    --it;
+    if (!it->nextKnown) {
+        return false; // An unseen keyframe may lie between it and the target
+    }
+    out = *it;
+    return true;
+}
+
+void KeyframeIndex::clear() {
+    keyframes.clear();
+    hasPrevious = false;
+}
+
+bool KeyframeIndex::load(const std::string& path, int timeBaseNum, int timeBaseDen) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    std::string magic;
+    int version = 0;
+    int num = 0;
+    int den = 0;
+    if (!(file >> magic >> version >> num >> den) || magic != SIDECAR_MAGIC ||
+        version != SIDECAR_VERSION || num != timeBaseNum || den != timeBaseDen || den == 0) {
+        return false;
+    }
+
+    std::vector<Keyframe> loaded;
+    Keyframe keyframe;
+    int nextKnown = 0;
+    while (file >> keyframe.pts >> nextKnown) {
+        keyframe.seconds = static_cast<double>(keyframe.pts) * num / den;
+        keyframe.nextKnown = nextKnown != 0;
+        if (!loaded.empty() && loaded.back().pts >= keyframe.pts) {
+            return false; // Not written by save()
+        }
+        loaded.push_back(keyframe);
+    }
+
+    keyframes = std::move(loaded);
+    hasPrevious = false;
+    return true;
+}
+
+bool KeyframeIndex::save(const std::string& path, int timeBaseNum, int timeBaseDen) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    file << SIDECAR_MAGIC << ' ' << SIDECAR_VERSION << ' ' << timeBaseNum << ' ' << timeBaseDen << '\n';
+    for (const Keyframe& keyframe : keyframes) {
+        file << keyframe.pts << ' ' << (keyframe.nextKnown ? 1 : 0) << '\n';
+    }
+    return static_cast<bool>(file);
+}
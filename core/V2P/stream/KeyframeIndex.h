@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The video keyframes of a recorded input, learned while demuxing.
+ *
+ * Keyframes are kept in pts order, whatever order they were read in. Each
+ * one remembers whether the next entry was read right after it: nothing
+ * then lies between the two, and a lookup falling in that gap is exact.
+ * Not thread-safe; the demuxer owns it.
+ */
+class KeyframeIndex {
+public:
+    struct Keyframe {
+        int64_t pts = 0;          // In the video stream's time base
+        double seconds = 0.0;
+        bool nextKnown = false;   // The following entry is the very next keyframe; on the last, the input ends
+    };
+
+    /**
+     * @brief Records a keyframe read by the demuxer, in demux order.
+     */
+    void add(int64_t pts, double seconds);
+
+    /**
+     * @brief The demuxer jumped: the next keyframe added does not follow the last one.
+     */
+    void breakRun() { hasPrevious = false; }
+
+    /**
+     * @brief The demuxer reached the end of the input.
+     */
+    void endRun();
+
+    /**
+     * @brief The last keyframe at or before `seconds`, if the index is sure
+     * there is no later one before that time.
+     */
+    bool find(double seconds, Keyframe& out) const;
+
+    size_t size() const { return keyframes.size(); }
+    void clear();
+
+    /**
+     * @brief Reads a sidecar file written by save() for a stream of the same time base.
+     * @return False if there is none, or it does not match.
+     */
+    bool load(const std::string& path, int timeBaseNum, int timeBaseDen);
+    bool save(const std::string& path, int timeBaseNum, int timeBaseDen) const;
+
+private:
+    std::vector<Keyframe> keyframes;
+    int64_t previousPts = 0;
+    bool hasPrevious = false;
+};
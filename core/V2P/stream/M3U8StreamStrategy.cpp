@@ -1,6 +1,18 @@
 #include "M3U8StreamStrategy.h"
 #include "V2P/stream/IStreamStrategy.h"
+#include "V2P/metrics/Tracer.h"
+#include "V2P/hls/HlsPrefetcher.h"
+#include "V2P/stream/CodecParameterCache.h"
+#include "V2P/writer/StreamRecorder.h"
+#include "V2P/stream/TimeShiftBuffer.h"
 #include <iostream>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <sstream>
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -13,22 +25,86 @@ extern "C" {
 #include <libavutil/opt.h>
 }
 
+namespace {
+    // No accurate seek in progress: every frame is output
+    constexpr double NO_SKIP = -std::numeric_limits<double>::infinity();
+}
+
 M3U8StreamStrategy::M3U8StreamStrategy()
     : formatContext(nullptr),
+    ioContext(nullptr),
     videoCodecCtx(nullptr),
     videoStream(nullptr),
     videoStreamIndex(-1),
     swsContext(nullptr),
-    rgbaBuffer(nullptr),
+    outputFrame(nullptr),
     videoWidth(0),
     videoHeight(0),
+    sourceFormat(-1),
+    outputFormat(-1),
+    passthrough(false),
+    decoderThreads(0),
+    requestedDecoderThreads(0),
+    lastDecodeNs(0),
+    frameDuration(1.0 / 30.0),
+    displayWidth(0),
+    displayHeight(0),
+    traceStream(Tracer::nextStreamId()),
     audioCodecCtx(nullptr),
     audioStream(nullptr),
     audioStreamIndex(-1),
     swrContext(nullptr),
     audioResampleBuffer(nullptr),
     audioResampleBufferSize(0),
-    audioClock(0.0) {}
+    audioClock(0.0),
+    lastAudioReadNs(0),
+    audioOutputLatency(0.0),
+    videoDecodeFrame(nullptr),
+    audioDecodeFrame(nullptr),
+    videoPackets(VIDEO_PACKET_QUEUE_SIZE, &packetPool),
+    audioPackets(AUDIO_PACKET_QUEUE_SIZE, &packetPool),
+    stopRequested(false),
+    standby(false),
+    standbyPacketCount(0),
+    standbyAnchorNs(0),
+    standbyAnchorPts(0.0),
+    resumeAtKeyframe(false),
+    videoFlushPending(false),
+    audioFlushPending(false),
+    audioRingStale(false),
+    recording(false),
+    timeShiftPosition(0.0),
+    timeShiftSeconds(0.0),
+    paused(false),
+    seekPending(false),
+    demuxFinished(false),
+    seekTarget(0.0),
+    seekMode(SeekMode::KEYFRAME),
+    seekStartNs(0),
+    videoSkipUntil(NO_SKIP),
+    audioSkipUntil(NO_SKIP),
+    discontinuityPts(AV_NOPTS_VALUE),
+    seekable(false),
+    seekCount(0),
+    indexedSeekCount(0),
+    seekPacketsSkipped(0),
+    seekFramesSkipped(0),
+    seeksMeasured(0),
+    keyframesIndexed(0),
+    lastSeekNs(0),
+    totalSeekNs(0),
+    maxSeekNs(0),
+    requestedOutputWidth(0),
+    requestedOutputHeight(0),
+    outputWidth(0),
+    outputHeight(0),
+    nextVideoCodecCtx(nullptr),
+    nextDecoderThreads(0),
+    pendingVideoPacket(nullptr),
+    videoDecoderDrained(false),
+    videoDecodeStartNs(0) {
+    standbyPackets.reserve(STANDBY_MAX_PACKETS);
+}
 
 M3U8StreamStrategy::~M3U8StreamStrategy() {
     close();
@@ -41,20 +117,53 @@ bool M3U8StreamStrategy::open(const std::string& url) {
         return false;
     }
 
-    if (avformat_open_input(&formatContext, url.c_str(), nullptr, nullptr) < 0) {
+    // Lets interrupt()/close() abort a blocking open or read
+    stopRequested = false;
+    demuxFinished = false;
+    formatContext->interrupt_callback.callback = &M3U8StreamStrategy::interruptCallback;
+    formatContext->interrupt_callback.opaque = this;
+
+    // Probing reads (and decodes) ahead until it has seen enough; fast start
+    // settles for less. Also bounds the container detection below.
+    const bool fastStart = startupConfig.fastStart;
+    if (fastStart) {
+        formatContext->probesize = std::max<int64_t>(startupConfig.probeSize, 32);
+        formatContext->max_analyze_duration = startupConfig.analyzeDuration;
+    }
+
+    // With the prefetcher in front, the demuxer sees one continuous stream of
+    // segments and probes their container instead of the playlist
+    bool prefetched = openPrefetcher(url);
+    if (prefetched) {
+        metrics->markStartup(StartupMilestone::PLAYLIST_LOADED);
+    }
+    if (avformat_open_input(&formatContext, prefetched ? "" : url.c_str(), nullptr, nullptr) < 0) {
         std::cerr << "Could not open stream URL: " << url << std::endl;
         avformat_free_context(formatContext); // Must free on failure
         formatContext = nullptr;
+        close(); // Releases the prefetcher
         return false;
     }
-
-    if (avformat_find_stream_info(formatContext, nullptr) < 0) {
-        std::cerr << "Could not find stream information." << std::endl;
-        close(); // Use our own close() to clean up
-        return false;
+    metrics->markStartup(StartupMilestone::INPUT_OPENED);
+
+    // Parameters known from an earlier open (or the container header) make
+    // probing unnecessary; otherwise probe and remember the result
+    const std::string cacheKey = codecCacheKey(url);
+    if (fastStart && CodecParameterCache::global().apply(cacheKey, formatContext)) {
+        std::cout << "Codec parameters known; skipped stream probing." << std::endl;
+    } else {
+        if (avformat_find_stream_info(formatContext, nullptr) < 0) {
+            std::cerr << "Could not find stream information." << std::endl;
+            close(); // Use our own close() to clean up
+            return false;
+        }
+        CodecParameterCache::global().store(cacheKey, formatContext);
     }
+    metrics->markStartup(StartupMilestone::STREAMS_PROBED);
 
-    av_dump_format(formatContext, 0, url.c_str(), 0);
+    if (!fastStart) {
+        av_dump_format(formatContext, 0, url.c_str(), 0);
+    }
 
     // --- Call our new helpers ---
     if (!initVideoStream()) {
@@ -63,18 +172,351 @@ bool M3U8StreamStrategy::open(const std::string& url) {
         return false;
     }
 
+    // Audio is optional: a video-only stream is timed by the wall clock
     if (!initAudioStream()) {
-        std::cerr << "Failed to initialize audio stream." << std::endl;
-        close();
-        return false;
+        std::cerr << "No usable audio stream, playing video only." << std::endl;
+        closeAudioStream();
     }
 
+    metrics->markStartup(StartupMilestone::DECODERS_OPENED);
+
+    // A recorded input can be moved around in; a live one only through its
+    // time-shift buffer. The prefetcher's byte stream only for MPEG-TS VOD.
+    seekable = !timeShiftConfig.enabled &&
+               (prefetcher ? prefetcher->canSeek() : formatContext->duration != AV_NOPTS_VALUE && formatContext->duration > 0);
+    keyframeIndex.clear();
+    keyframeIndexPath.clear();
+    if (seekable && !seekConfig.indexDirectory.empty()) {
+        std::ostringstream name;
+        name << seekConfig.indexDirectory << '/' << std::hex << std::hash<std::string>{}(url) << ".keyframes";
+        keyframeIndexPath = name.str();
+        if (keyframeIndex.load(keyframeIndexPath, videoStream->time_base.num, videoStream->time_base.den)) {
+            std::cout << "Loaded " << keyframeIndex.size() << " keyframes from " << keyframeIndexPath << std::endl;
+        }
+    }
+    keyframesIndexed = keyframeIndex.size();
+
+    // --- Start the pipeline: demuxer feeding one decoder thread per stream type ---
+    videoPackets.flush();
+    audioPackets.flush();
+    timeShift.reset();
+    if (timeShiftConfig.enabled) {
+        // The demuxer fills the buffer, its own thread replays it into the queues
+        timeShift = std::make_unique<TimeShiftBuffer>(timeShiftConfig);
+        timeShiftPosition = 0.0;
+        timeShiftSeconds = 0.0;
+        timeShiftThread = std::thread(&M3U8StreamStrategy::timeShiftLoop, this);
+    }
+    demuxThread = std::thread(&M3U8StreamStrategy::demuxLoop, this);
+    audioThread = std::thread(&M3U8StreamStrategy::audioDecodeLoop, this);
+
     std::cout << "M3U8 Stream Strategy opened successfully." << std::endl;
     return true;
 }
 
+int M3U8StreamStrategy::interruptCallback(void* opaque) {
+    auto* self = static_cast<M3U8StreamStrategy*>(opaque);
+    return self->stopRequested.load() ? 1 : 0;
+}
+
+std::string M3U8StreamStrategy::codecCacheKey(const std::string& url) const {
+    // Variants encoded alike share parameters, whichever channel they belong to
+    std::string key = prefetcher ? prefetcher->getCodecKey() : std::string();
+    return key.empty() ? url : key;
+}
+
+bool M3U8StreamStrategy::openPrefetcher(const std::string& url) {
+    if (!prefetchConfig.enabled) {
+        return false;
+    }
+
+    auto candidate = std::make_unique<HlsPrefetcher>(prefetchConfig);
+    HlsPrefetcher* opening = candidate.get();
+    candidate->setAbrProbe([this](AbrInputs& inputs) {
+        inputs.demuxedSeconds = static_cast<double>(videoPackets.size()) * frameDuration.load();
+        inputs.decodedFrames = frameQueueProbe ? static_cast<int>(frameQueueProbe()) : -1;
+        inputs.displayWidth = displayWidth.load();
+        inputs.displayHeight = displayHeight.load();
+    });
+
+    // Published before loading the playlists, so that interrupt() can abort them
+    {
+        std::lock_guard<std::mutex> lock(prefetcherMutex);
+        prefetcher = std::move(candidate);
+        if (stopRequested) {
+            prefetcher->abort();
+        }
+    }
+
+    auto* buffer = opening->open(url) ? static_cast<uint8_t*>(av_malloc(PREFETCH_IO_BUFFER_SIZE)) : nullptr;
+    if (buffer) {
+        ioContext = avio_alloc_context(buffer, PREFETCH_IO_BUFFER_SIZE, 0, opening,
+                                       &M3U8StreamStrategy::readPrefetched, nullptr, nullptr);
+        if (!ioContext) {
+            std::cerr << "Could not allocate the prefetch IO context." << std::endl;
+            av_free(buffer);
+        }
+    }
+    if (!ioContext) {
+        std::lock_guard<std::mutex> lock(prefetcherMutex);
+        prefetcher.reset();
+        return false;
+    }
+
+    formatContext->pb = ioContext;
+    formatContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+    return true;
+}
+
+int M3U8StreamStrategy::readPrefetched(void* opaque, uint8_t* buffer, int size) {
+    return static_cast<HlsPrefetcher*>(opaque)->read(buffer, size);
+}
+
+void M3U8StreamStrategy::interrupt() {
+    stopRequested = true;
+    {
+        std::lock_guard<std::mutex> lock(prefetcherMutex);
+        if (prefetcher) {
+            prefetcher->abort(); // Wakes a demuxer waiting for a segment, or an open
+        }
+    }
+    videoPackets.abort();
+    audioPackets.abort();
+    if (timeShift) {
+        timeShift->abort();
+    }
+    pauseChanged.notify_all();
+}
+
+void M3U8StreamStrategy::setDisplaySize(int width, int height) {
+    // Read by the prefetcher's ABR after each segment
+    displayWidth = width;
+    displayHeight = height;
+}
+
+void M3U8StreamStrategy::setOutputSize(int width, int height) {
+    // Picked up by the decoding thread at its next frame
+    requestedOutputWidth = std::max(width, 0);
+    requestedOutputHeight = std::max(height, 0);
+}
+
+bool M3U8StreamStrategy::setInputCallback(std::function<void()> callback) {
+    // Video decoding only ever waits on this queue
+    videoPackets.setReadyCallback(std::move(callback));
+    return true;
+}
+
+void M3U8StreamStrategy::setDecoderThreadCount(int threads) {
+    // Picked up by the decoding thread at its next keyframe
+    requestedDecoderThreads = std::max(threads, 0);
+}
+
+bool M3U8StreamStrategy::setStandby(bool enabled) {
+    // The time-shift buffer already keeps the stream without decoding it
+    if (!formatContext || !videoCodecCtx || timeShift)
+        return !enabled;
+
+    std::lock_guard<std::mutex> lock(standbyMutex);
+    if (standby == enabled)
+        return true;
+
+    if (enabled) {
+        // What waits for the decoders now would be stale when the stream comes back
+        standby = true;
+        standbyAnchorNs = 0;
+        videoPackets.clear();
+        audioPackets.clear();
+        videoFlushPending = true;
+        audioFlushPending = true;
+        audioRingStale = true;
+        audioClock = 0.0;
+
+        // The decoder sits idle until the stream comes back, and then takes
+        // its share again at the first keyframe
+        if (decoderConfig.budget) {
+            decoderConfig.budget->release(decoderThreads.exchange(0));
+        }
+        std::cout << "Stream on standby." << std::endl;
+        return true;
+    }
+
+    // The held GOP goes ahead of anything the demuxer reads next, which waits
+    // for this lock. Nothing has been decoding, so the queues have room for it.
+    videoPackets.clear();
+    audioPackets.clear();
+    resumeAtKeyframe = standbyPackets.empty();
+    for (AVPacket* packet : standbyPackets) {
+        (packet->stream_index == videoStreamIndex ? videoPackets : audioPackets).push(packet);
+    }
+    std::cout << "Stream promoted from standby with " << standbyPackets.size() << " held packets." << std::endl;
+    standbyPackets.clear();
+    standbyPacketCount = 0;
+    standby = false;
+    return true;
+}
+
+bool M3U8StreamStrategy::startRecording(const RecorderConfig& config) {
+    if (!formatContext || recording) {
+        return false;
+    }
+
+    auto candidate = std::make_unique<StreamRecorder>(config);
+    if (!candidate->start(formatContext, videoStreamIndex, audioStreamIndex)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(recorderMutex);
+    recorder = std::move(candidate);
+    recording = true;
+    return true;
+}
+
+void M3U8StreamStrategy::stopRecording() {
+    {
+        // The demuxer pushes under this lock, so nothing arrives after it
+        std::lock_guard<std::mutex> lock(recorderMutex);
+        if (!recording) {
+            return;
+        }
+        recording = false;
+    }
+    recorder->stop();
+}
+
+RecorderStats M3U8StreamStrategy::getRecorderStats() const {
+    std::lock_guard<std::mutex> lock(recorderMutex);
+    return recorder ? recorder->getStats() : RecorderStats{};
+}
+
+bool M3U8StreamStrategy::seek(double seconds, SeekMode mode) {
+    if (!formatContext || !videoCodecCtx || std::isnan(seconds)) {
+        return false;
+    }
+    // Only a time-shift buffer has a live edge to go back to
+    if (!timeShift && (!seekable || std::isinf(seconds))) {
+        return false;
+    }
+    // Nothing would carry the seek out, and the queues still hold the end of the stream
+    if (demuxFinished) {
+        return false;
+    }
+
+    // The demuxer or the feeder moves the input; emptying the queues here
+    // wakes it if it waits for room, and it empties them again once it has moved
+    seekMode = mode;
+    seekTarget = seconds;
+    seekStartNs = StreamMetrics::now();
+    seekPending = true;
+    videoPackets.clear();
+    audioPackets.clear();
+    pauseChanged.notify_all();
+    return true;
+}
+
+void M3U8StreamStrategy::setPaused(bool pause) {
+    {
+        std::lock_guard<std::mutex> lock(pauseMutex);
+        paused = pause;
+    }
+    pauseChanged.notify_all();
+}
+
+SeekStats M3U8StreamStrategy::getSeekStats() const {
+    SeekStats stats;
+    stats.seeks = seekCount;
+    stats.indexedSeeks = indexedSeekCount;
+    stats.packetsSkipped = seekPacketsSkipped;
+    stats.framesSkipped = seekFramesSkipped;
+    stats.keyframesIndexed = keyframesIndexed;
+    const uint64_t measured = seeksMeasured;
+    stats.lastMs = static_cast<double>(lastSeekNs) / 1e6;
+    stats.averageMs = measured ? static_cast<double>(totalSeekNs) / 1e6 / static_cast<double>(measured) : 0.0;
+    stats.maxMs = static_cast<double>(maxSeekNs) / 1e6;
+    return stats;
+}
+
+bool M3U8StreamStrategy::seekInput(double target, double& keyframeSeconds) {
+    // With the keyframe known, the demuxer goes straight to it; otherwise
+    // it lands at or before the target and decoding starts at the first keyframe
+    KeyframeIndex::Keyframe keyframe;
+    const bool indexed = keyframeIndex.find(target, keyframe);
+    const double landing = indexed ? keyframe.seconds : target;
+
+    if (prefetcher) {
+        // One byte stream of concatenated segments: restart it at the segment
+        // holding the keyframe, and drop what the demuxer has buffered
+        const double origin = formatContext->start_time != AV_NOPTS_VALUE
+            ? (double)formatContext->start_time / AV_TIME_BASE
+            : 0.0;
+        if (prefetcher->seek(landing - origin) < 0.0) {
+            return false;
+        }
+        avio_flush(ioContext);
+        ioContext->eof_reached = 0; // Not cleared by the flush, and the input may have ended
+        avformat_flush(formatContext);
+    } else {
+        const int64_t timestamp = indexed ? keyframe.pts : (int64_t)(target / av_q2d(videoStream->time_base));
+        if (av_seek_frame(formatContext, videoStreamIndex, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
+            return false;
+        }
+    }
+
+    keyframeIndex.breakRun();
+    keyframeSeconds = indexed ? keyframe.seconds : NO_SKIP;
+    if (indexed) {
+        indexedSeekCount++;
+    }
+    return true;
+}
+
+void M3U8StreamStrategy::restartDecoders(SeekMode mode, double target) {
+    // What waits for the decoders, and what they hold, is from before the
+    // seek; queues the demuxer finished at the end of the input take packets again
+    videoPackets.reopen();
+    audioPackets.reopen();
+    videoFlushPending = true;
+    audioFlushPending = true;
+    audioRingStale = true;
+    audioClock = 0.0;
+
+    const double skipUntil = mode == SeekMode::ACCURATE && std::isfinite(target) ? target : NO_SKIP;
+    videoSkipUntil = skipUntil;
+    audioSkipUntil = skipUntil;
+    discontinuityPts = AV_NOPTS_VALUE; // A seek re-anchors playback anyway
+    seekCount++;
+}
+
+void M3U8StreamStrategy::finishSeek() {
+    // The first frame at the new position, on the decoding thread
+    if (seekStartNs.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    const int64_t start = seekStartNs.exchange(0);
+    if (start == 0) {
+        return;
+    }
+    const int64_t latency = StreamMetrics::now() - start;
+    metrics->record(MetricStage::SEEK, latency);
+    lastSeekNs = latency;
+    totalSeekNs += latency;
+    seeksMeasured++;
+    int64_t longest = maxSeekNs.load();
+    while (latency > longest && !maxSeekNs.compare_exchange_weak(longest, latency)) {}
+}
+
+TimeShiftRange M3U8StreamStrategy::getTimeShiftRange() const {
+    if (!timeShift) {
+        return {};
+    }
+    TimeShiftRange range = timeShift->getRange();
+    range.position = timeShiftPosition;
+    return range;
+}
+
 void M3U8StreamStrategy::setAudioCallback(AudioCallback callback)
 {
+    // The audio thread may already be running
+    std::lock_guard<std::mutex> lock(audioCallbackMutex);
     audioCallback = std::move(callback);
 }
 
@@ -100,45 +542,246 @@ bool M3U8StreamStrategy::initVideoStream() {
         return false;
     }
 
+    configureDecoderThreads();
+    videoCodecCtx->lowres = lowresFor(videoCodec);
+
     if (avcodec_open2(videoCodecCtx, videoCodec, nullptr) < 0) {
         std::cerr << "Could not open video codec." << std::endl;
         return false;
     }
 
-    // --- Setup the RGBA Converter ---
+    std::cout << "Video decoder using " << decoderThreads << " thread(s), "
+              << (videoCodecCtx->active_thread_type & FF_THREAD_FRAME ? "frame" :
+                  videoCodecCtx->active_thread_type & FF_THREAD_SLICE ? "slice" : "no")
+              << " threading." << std::endl;
+    if (videoCodecCtx->lowres > 0) {
+        std::cout << "Video decoded at 1/" << (1 << videoCodecCtx->lowres) << " resolution." << std::endl;
+    }
+
     videoWidth = videoCodecCtx->width;
     videoHeight = videoCodecCtx->height;
 
-    swsContext = sws_getContext(
-        videoWidth, videoHeight, videoCodecCtx->pix_fmt, // Source
-        videoWidth, videoHeight, AV_PIX_FMT_RGBA,      // Destination
-        SWS_BILINEAR, nullptr, nullptr, nullptr
-    );
+    AVRational frameRate = av_guess_frame_rate(formatContext, videoStream, nullptr);
+    if (frameRate.num > 0 && frameRate.den > 0) {
+        frameDuration = av_q2d(av_inv_q(frameRate));
+    }
 
-    if (!swsContext) {
-        std::cerr << "Could not initialize SwsContext." << std::endl;
+    // The converter is set up once the first frame shows what the decoder
+    // really produces; see configureOutput(). Only the frame shell is kept
+    // here: each converted image gets its own ref-counted buffer that
+    // travels with the VideoFrame to the consumer.
+    outputFrame = av_frame_alloc();
+    videoDecodeFrame = av_frame_alloc();
+    if (!outputFrame || !videoDecodeFrame) {
+        std::cerr << "Could not allocate video frames." << std::endl;
         return false;
     }
 
-    rgbaFrame = av_frame_alloc();
-    if (!rgbaFrame) {
-        std::cerr << "Could not allocate RGBA frame." << std::endl;
+    return true;
+}
+
+int M3U8StreamStrategy::requestedThreadCount() const {
+    int requested = requestedDecoderThreads;
+    if (requested <= 0) {
+        requested = decoderConfig.threadCount;
+    }
+    if (requested <= 0) {
+        requested = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    return requested;
+}
+
+void M3U8StreamStrategy::configureDecoderThreads() {
+    const int requested = requestedThreadCount();
+
+    // Streams sharing a budget only get what the others have left over
+    decoderThreads = decoderConfig.budget ? decoderConfig.budget->acquire(requested) : requested;
+    videoCodecCtx->thread_count = decoderThreads;
+
+    switch (decoderConfig.threading) {
+        case DecoderThreading::FRAME:
+            videoCodecCtx->thread_type = FF_THREAD_FRAME;
+            break;
+        case DecoderThreading::SLICE:
+            videoCodecCtx->thread_type = FF_THREAD_SLICE;
+            break;
+        case DecoderThreading::AUTO:
+            videoCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+            break;
+    }
+}
+
+int M3U8StreamStrategy::lowresFor(const AVCodec* codec) const {
+    // The largest reduction that still covers the output size; only a few
+    // codecs (MJPEG, MPEG-4 part 2...) can decode at a fraction of the size
+    const int width = requestedOutputWidth;
+    const int height = requestedOutputHeight;
+    if (width <= 0 || height <= 0 || !codec || !videoStream) {
+        return 0;
+    }
+    const AVCodecParameters* parameters = videoStream->codecpar;
+    int lowres = 0;
+    while (lowres < codec->max_lowres &&
+           (parameters->width >> (lowres + 1)) >= width && (parameters->height >> (lowres + 1)) >= height) {
+        ++lowres;
+    }
+    return lowres;
+}
+
+bool M3U8StreamStrategy::beginDecoderSwitch(const AVPacket* packet) {
+    // An open decoder keeps its lowres and thread count: a new one takes
+    // over at a keyframe, once the old one has handed out every frame it
+    // still holds
+    if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+        return false;
+    }
+    const AVCodec* codec = videoCodecCtx->codec;
+    const int lowres = codec->max_lowres > 0 ? lowresFor(codec) : videoCodecCtx->lowres;
+
+    // A share that changed, or threads handed back on standby, are traded
+    // in the budget now; the old decoder only has a few frames left
+    const int held = decoderThreads;
+    const int requested = requestedThreadCount();
+    int threads = held;
+    if (requested != held) {
+        threads = decoderConfig.budget ? decoderConfig.budget->resize(held, requested) : requested;
+    }
+    if (lowres == videoCodecCtx->lowres && threads == held) {
+        return false;
+    }
+
+    AVCodecContext* decoder = avcodec_alloc_context3(codec);
+    bool opened = decoder && avcodec_parameters_to_context(decoder, videoStream->codecpar) >= 0;
+    if (opened) {
+        decoder->thread_count = threads;
+        decoder->thread_type = videoCodecCtx->thread_type;
+        decoder->lowres = lowres;
+        opened = avcodec_open2(decoder, codec, nullptr) >= 0;
+        if (!opened) {
+            std::cerr << "Could not reopen the video decoder at 1/" << (1 << lowres)
+                      << " resolution with " << threads << " thread(s)." << std::endl;
+        }
+    }
+    if (!opened || avcodec_send_packet(videoCodecCtx, nullptr) < 0) {
+        avcodec_free_context(&decoder);
+        if (decoderConfig.budget && threads != held) {
+            decoderThreads = decoderConfig.budget->resize(threads, held);
+        }
         return false;
     }
+    nextVideoCodecCtx = decoder;
+    nextDecoderThreads = threads;
+    return true;
+}
+
+void M3U8StreamStrategy::finishDecoderSwitch() {
+    // Never null in between, for the checks other threads make
+    std::swap(nextVideoCodecCtx, videoCodecCtx);
+    avcodec_free_context(&nextVideoCodecCtx);
+    decoderThreads = nextDecoderThreads;
+    nextDecoderThreads = 0;
+    videoDecoderDrained = false;
+    std::cout << "Video decoded at 1/" << (1 << videoCodecCtx->lowres) << " resolution with "
+              << decoderThreads << " thread(s)." << std::endl;
+}
+
+void M3U8StreamStrategy::discardDecoderSwitch() {
+    packetPool.release(pendingVideoPacket);
+    pendingVideoPacket = nullptr;
+    if (!nextVideoCodecCtx) {
+        return;
+    }
+    avcodec_free_context(&nextVideoCodecCtx);
+
+    // The budget holds the new decoder's share; it goes back to the old one's
+    if (decoderConfig.budget && nextDecoderThreads != decoderThreads) {
+        decoderThreads = decoderConfig.budget->resize(nextDecoderThreads, decoderThreads);
+    }
+    nextDecoderThreads = 0;
+}
+
+void M3U8StreamStrategy::outputSizeFor(int width, int height, int& outWidth, int& outHeight) const {
+    // Never larger than the decoded picture; reduced sizes are kept even for 4:2:0
+    const int requestedWidth = requestedOutputWidth;
+    const int requestedHeight = requestedOutputHeight;
+    outWidth = width;
+    outHeight = height;
+    if (requestedWidth <= 0 || requestedHeight <= 0) {
+        return;
+    }
+    if (requestedWidth < width) {
+        outWidth = std::max(2, requestedWidth & ~1);
+    }
+    if (requestedHeight < height) {
+        outHeight = std::max(2, requestedHeight & ~1);
+    }
+}
+
+static AVPixelFormat toAVPixelFormat(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::IYUV: return AV_PIX_FMT_YUV420P;
+        case PixelFormat::NV12: return AV_PIX_FMT_NV12;
+        case PixelFormat::RGBA: return AV_PIX_FMT_RGBA;
+    }
+    return AV_PIX_FMT_RGBA;
+}
+
+bool M3U8StreamStrategy::configureOutput(const AVFrame* decodedFrame) {
+    int targetWidth = 0;
+    int targetHeight = 0;
+    outputSizeFor(decodedFrame->width, decodedFrame->height, targetWidth, targetHeight);
+    if (decodedFrame->format == sourceFormat &&
+        decodedFrame->width == videoWidth && decodedFrame->height == videoHeight &&
+        targetWidth == outputWidth && targetHeight == outputHeight) {
+        return true;
+    }
+
+    sourceFormat = decodedFrame->format;
+    videoWidth = decodedFrame->width;
+    videoHeight = decodedFrame->height;
+    outputWidth = targetWidth;
+    outputHeight = targetHeight;
+    const bool scaling = outputWidth != videoWidth || outputHeight != videoHeight;
+
+    // Pass the decoder's own buffers through if the client can render them
+    // as they are; a format it can render is only scaled
+    passthrough = false;
+    outputFormat = toAVPixelFormat(acceptedFormats.front());
+    for (PixelFormat accepted : acceptedFormats) {
+        if (toAVPixelFormat(accepted) == sourceFormat) {
+            passthrough = !scaling;
+            outputFormat = sourceFormat;
+            break;
+        }
+    }
+
+    if (swsContext) {
+        sws_freeContext(swsContext);
+        swsContext = nullptr;
+    }
+
+    if (passthrough) {
+        std::cout << "Passing decoded video through without conversion." << std::endl;
+        return true;
+    }
 
-    rgbaFrame->format = AV_PIX_FMT_RGBA;
-    rgbaFrame->width = videoWidth;
-    rgbaFrame->height = videoHeight;
+    // Otherwise convert to the client's preferred format, at the output size
+    swsContext = sws_getContext(
+        videoWidth, videoHeight, (AVPixelFormat)sourceFormat,    // Source
+        outputWidth, outputHeight, (AVPixelFormat)outputFormat,  // Destination
+        SWS_BILINEAR, nullptr, nullptr, nullptr
+    );
 
-    int rgbaBufferSize = av_image_get_buffer_size(AV_PIX_FMT_RGBA, videoWidth, videoHeight, 1);
-    rgbaBuffer = (uint8_t*)av_malloc(rgbaBufferSize * sizeof(uint8_t));
-    if (!rgbaBuffer) {
-        std::cerr << "Could not allocate RGBA buffer." << std::endl;
+    if (!swsContext) {
+        std::cerr << "Could not initialize SwsContext." << std::endl;
+        sourceFormat = -1;
         return false;
     }
 
-    av_image_fill_arrays(rgbaFrame->data, rgbaFrame->linesize, rgbaBuffer,
-                         AV_PIX_FMT_RGBA, videoWidth, videoHeight, 1);
+    if (scaling) {
+        std::cout << "Scaling video from " << videoWidth << "x" << videoHeight
+                  << " to " << outputWidth << "x" << outputHeight << "." << std::endl;
+    }
 
     return true;
 }
@@ -146,6 +789,10 @@ bool M3U8StreamStrategy::initVideoStream() {
 // Define our target audio format (you can move this to the top of the .cpp file)
 #define TARGET_SAMPLE_RATE 44100
 #define TARGET_SAMPLE_FORMAT AV_SAMPLE_FMT_S16
+#define TARGET_RESAMPLE_SAMPLES 4096
+
+// How much decoded audio the pull-mode ring can hold ahead of the device
+#define AUDIO_RING_SECONDS 1
 
 const AVChannelLayout TARGET_CHANNEL_LAYOUT = AV_CHANNEL_LAYOUT_STEREO;
 
@@ -195,38 +842,61 @@ bool M3U8StreamStrategy::initAudioStream() {
         return false;
     }
 
-    audioResampleBufferSize = av_samples_get_buffer_size(nullptr, TARGET_CHANNEL_LAYOUT.nb_channels, 4096, TARGET_SAMPLE_FORMAT, 1);
+    audioResampleBufferSize = av_samples_get_buffer_size(nullptr, TARGET_CHANNEL_LAYOUT.nb_channels, TARGET_RESAMPLE_SAMPLES, TARGET_SAMPLE_FORMAT, 1);
     audioResampleBuffer = (uint8_t*)av_malloc(audioResampleBufferSize);
     if (!audioResampleBuffer) {
         std::cerr << "Could not allocate audio resample buffer." << std::endl;
         return false;
     }
 
+    audioDecodeFrame = av_frame_alloc();
+    if (!audioDecodeFrame) {
+        std::cerr << "Could not allocate audio frame." << std::endl;
+        return false;
+    }
+
+    int bytesPerFrame = TARGET_CHANNEL_LAYOUT.nb_channels * av_get_bytes_per_sample(TARGET_SAMPLE_FORMAT);
+    audioRing = std::make_unique<AudioRingBuffer>(TARGET_SAMPLE_RATE * bytesPerFrame * AUDIO_RING_SECONDS,
+                                                  bytesPerFrame, TARGET_SAMPLE_RATE);
+    audioRing->getClock().setOutputLatency(audioOutputLatency);
+    lastAudioReadNs = 0;
+
     return true;
 }
 
 
 void M3U8StreamStrategy::closeVideoStream() {
+    discardDecoderSwitch();
+    videoDecoderDrained = false;
     if (videoCodecCtx) {
         avcodec_free_context(&videoCodecCtx);
         videoCodecCtx = nullptr;
     }
+    if (decoderThreads > 0 && decoderConfig.budget) {
+        decoderConfig.budget->release(decoderThreads);
+    }
+    decoderThreads = 0;
     if (swsContext) {
         sws_freeContext(swsContext);
         swsContext = nullptr;
     }
-    if (rgbaBuffer) {
-        av_free(rgbaBuffer);
-        rgbaBuffer = nullptr;
+    if (outputFrame) {
+        av_frame_free(&outputFrame);
+        outputFrame = nullptr;
     }
-    if (rgbaFrame) {
-        av_frame_free(&rgbaFrame);
-        rgbaFrame = nullptr;
+    if (videoDecodeFrame) {
+        av_frame_free(&videoDecodeFrame);
+        videoDecodeFrame = nullptr;
     }
     videoStream = nullptr;
     videoStreamIndex = -1;
     videoWidth = 0;
     videoHeight = 0;
+    outputWidth = 0;
+    outputHeight = 0;
+    sourceFormat = -1;
+    outputFormat = -1;
+    passthrough = false;
 }
 
 void M3U8StreamStrategy::closeAudioStream() {
@@ -242,6 +912,11 @@ void M3U8StreamStrategy::closeAudioStream() {
         av_free(audioResampleBuffer);
         audioResampleBuffer = nullptr;
     }
+    if (audioDecodeFrame) {
+        av_frame_free(&audioDecodeFrame);
+        audioDecodeFrame = nullptr;
+    }
+    audioRing.reset();
     audioStream = nullptr;
     audioStreamIndex = -1;
     audioResampleBufferSize = 0;
@@ -249,60 +924,496 @@ void M3U8StreamStrategy::closeAudioStream() {
 }
 
 
-PacketType M3U8StreamStrategy::processNextFrame(VideoFrame& outFrame) {
-    if (!formatContext || !videoCodecCtx || !swsContext) {
-        return PacketType::ERROR;
-    }
+void M3U8StreamStrategy::demuxLoop() {
+    Tracer::setThreadName("demux " + std::to_string(traceStream));
+
+    // Fast start: whatever comes before the first keyframe cannot be shown
+    // cleanly, and audio ahead of it would only hold the first picture back
+    bool waitingForKeyframe = startupConfig.fastStart;
+
+    // After a seek: decoding starts at this keyframe, or the first one if unknown
+    double seekKeyframe = NO_SKIP;
+    bool seeking = false;
+
+    // Read past an EXT-X-DISCONTINUITY, and no video timestamp since
+    bool discontinuityPending = false;
+
+    while (!stopRequested) {
+        // Seeks move the input here, between two reads
+        if (!timeShift && seekPending.exchange(false)) {
+            const double target = seekTarget;
+            if (seekInput(target, seekKeyframe)) {
+                restartDecoders(seekMode, target);
+                waitingForKeyframe = true;
+                seeking = true;
+            } else {
+                std::cerr << "Could not seek to " << target << " s." << std::endl;
+                seekStartNs = 0;
+            }
+        }
 
-    AVPacket* packet = av_packet_alloc();
-    AVFrame* yuvFrame = av_frame_alloc();
+        AVPacket* packet = packetPool.acquire();
+        if (!packet) {
+            std::cerr << "Could not allocate packet." << std::endl;
+            break;
+        }
 
-    // This loop now handles BOTH audio and video
-    while (av_read_frame(formatContext, packet) >= 0) {
-        if (packet->stream_index == videoStreamIndex) {
-            handleVideoPacket(packet, yuvFrame, outFrame);
+        int64_t demuxStart = StreamMetrics::now();
+        {
+            TraceScope trace("av_read_frame");
+            int ret = av_read_frame(formatContext, packet);
+            if (ret < 0) {
+                packetPool.release(packet);
+                if (ret == AVERROR_EOF && seekable && !timeShift && !stopRequested) {
+                    // A VOD input ends well ahead of playback: the decoders play
+                    // out the rest, while the demuxer stays for a seek back
+                    keyframeIndex.endRun();
+                    videoPackets.finish();
+                    audioPackets.finish();
+                    waitAtEnd();
+                    continue;
+                }
+                break; // End of a live stream, error or interrupted
+            }
+            if (packet->stream_index == videoStreamIndex) {
+                trace.flow(TraceFlow::START, Tracer::frameId(traceStream, packet->pts));
+            }
+        }
+        metrics->record(MetricStage::DEMUX_WAIT, StreamMetrics::now() - demuxStart);
+        metrics->add(MetricCounter::BYTES_DEMUXED, packet->size);
+
+        // The recording takes everything, whether or not it is decoded
+        if (recording) {
+            std::lock_guard<std::mutex> lock(recorderMutex);
+            if (recording) {
+                recorder->push(packet);
+            }
+        }
 
-            // reutrn to the main thread for handling this video frame
-            av_packet_unref(packet);
-            av_packet_free(&packet);
-            av_frame_free(&yuvFrame);
-            return PacketType::VIDEO;
+        // Timestamps may jump at an EXT-X-DISCONTINUITY: the frame of the
+        // first video packet after it re-anchors the presentation
+        if (prefetcher && packet->pos >= 0 && prefetcher->passedDiscontinuity(packet->pos)) {
+            discontinuityPending = true;
+        }
+        if (discontinuityPending && packet->stream_index == videoStreamIndex && packet->pts != AV_NOPTS_VALUE) {
+            discontinuityPts = packet->pts;
+            discontinuityPending = false;
+        }
+
+        const bool videoKeyframe = packet->stream_index == videoStreamIndex && (packet->flags & AV_PKT_FLAG_KEY);
+        const double videoSeconds = videoKeyframe && packet->pts != AV_NOPTS_VALUE
+            ? (double)packet->pts * av_q2d(videoStream->time_base)
+            : NO_SKIP;
+        if (seekable && videoKeyframe && packet->pts != AV_NOPTS_VALUE) {
+            keyframeIndex.add(packet->pts, videoSeconds);
+            keyframesIndexed = keyframeIndex.size();
+        }
+
+        // Time shift: the feeder hands the buffered packets to the decoders
+        if (timeShift) {
+            appendTimeShift(packet);
+            packetPool.release(packet);
+            continue;
+        }
+
+        // Standby: hold the current GOP instead of decoding it
+        if (standby) {
+            paceStandby(packet);
+            if (holdStandbyPacket(packet)) {
+                continue;
+            }
+        }
+        if (resumeAtKeyframe.exchange(false)) {
+            waitingForKeyframe = true;
+        }
+
+        if (waitingForKeyframe) {
+            // A seek may land ahead of the keyframe picked from the index; what
+            // comes before it is never decoded
+            if (!videoKeyframe || videoSeconds < seekKeyframe - frameDuration / 2) {
+                if (seeking) {
+                    seekPacketsSkipped++;
+                }
+                packetPool.release(packet);
+                continue;
+            }
+            waitingForKeyframe = false;
+            seeking = false;
+            seekKeyframe = NO_SKIP;
+        }
+
+        // Each queue hands its packets to an independent decoder thread, so
+        // audio keeps flowing while video decode catches up and the decoders
+        // keep working through what is buffered while the network stalls.
+        if (packet->stream_index == videoStreamIndex) {
+            TraceScope trace("video packet push"); // Blocks while the video decoder is behind
+            videoPackets.push(packet);
+            metrics->markStartup(StartupMilestone::FIRST_PACKET);
         }
         else if (packet->stream_index == audioStreamIndex && isAudioEnabled) {
+            TraceScope trace("audio packet push");
+            audioPackets.push(packet);
+        }
+        else {
+            packetPool.release(packet);
+        }
+    }
+
+    if (timeShift) {
+        timeShift->finish(); // The feeder finishes the queues once it has replayed the rest
+    } else {
+        demuxFinished = true;
+        videoPackets.finish();
+        audioPackets.finish();
+    }
+}
+
+void M3U8StreamStrategy::waitAtEnd() {
+    std::unique_lock<std::mutex> lock(pauseMutex);
+    // Seeks and interrupt() notify without the lock; the timeout covers a missed wakeup
+    while (!seekPending && !stopRequested) {
+        pauseChanged.wait_for(lock, std::chrono::milliseconds(50));
+    }
+}
+
+void M3U8StreamStrategy::appendTimeShift(const AVPacket* packet) {
+    const bool video = packet->stream_index == videoStreamIndex;
+    if (!video && !(packet->stream_index == audioStreamIndex && isAudioEnabled)) {
+        return;
+    }
+
+    const int64_t ts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    if (ts != AV_NOPTS_VALUE) {
+        timeShiftSeconds = (double)ts * av_q2d(formatContext->streams[packet->stream_index]->time_base);
+    }
+    timeShift->append(packet, timeShiftSeconds, video && (packet->flags & AV_PKT_FLAG_KEY));
+}
+
+void M3U8StreamStrategy::timeShiftLoop() {
+    Tracer::setThreadName("time shift " + std::to_string(traceStream));
+
+    // The buffer starts at a keyframe, and so does every seek
+    uint64_t position = 0;
+    while (!stopRequested) {
+        if (seekPending.exchange(false)) {
+            // Past the live edge there is nothing to be accurate to
+            const double target = std::min<double>(seekTarget, timeShift->getRange().end);
+            position = timeShift->keyframeAtOrBefore(target);
+            timeShiftPosition = timeShift->secondsAt(position);
+            indexedSeekCount++;
+            restartDecoders(seekMode, target);
+        }
+
+        if (paused) {
+            std::unique_lock<std::mutex> lock(pauseMutex);
+            // Seeks and interrupt() notify without the lock; the timeout covers a missed wakeup
+            pauseChanged.wait_for(lock, std::chrono::milliseconds(50),
+                                  [&] { return !paused || seekPending || stopRequested; });
+            continue;
+        }
+
+        // Short waits at the live edge, so that seeks and pauses are seen
+        AVPacket* packet = nullptr;
+        TimeShiftRead result = timeShift->read(position, &packet, std::chrono::milliseconds(50));
+        if (result == TimeShiftRead::END) {
+            break;
+        }
+        if (result == TimeShiftRead::WAITING) {
+            continue;
+        }
+
+        timeShiftPosition = timeShift->secondsAt(position - 1);
+        if (packet->stream_index == videoStreamIndex) {
+            TraceScope trace("video packet push");
+            videoPackets.push(packet);
+            metrics->markStartup(StartupMilestone::FIRST_PACKET);
+        } else {
+            TraceScope trace("audio packet push");
+            audioPackets.push(packet);
+        }
+    }
+
+    demuxFinished = true;
+    videoPackets.finish();
+    audioPackets.finish();
+}
+
+bool M3U8StreamStrategy::holdStandbyPacket(AVPacket* packet) {
+    std::lock_guard<std::mutex> lock(standbyMutex);
+    if (!standby) {
+        return false; // Promoted meanwhile; the caller queues it as usual
+    }
+
+    const bool video = packet->stream_index == videoStreamIndex;
+    const bool keyframe = video && (packet->flags & AV_PKT_FLAG_KEY);
+    const bool audio = packet->stream_index == audioStreamIndex && isAudioEnabled;
+
+    // A keyframe starts over; anything before the first one cannot be decoded
+    if (keyframe) {
+        freeStandbyPackets();
+    }
+    if (standbyPackets.size() >= STANDBY_MAX_PACKETS) {
+        freeStandbyPackets(); // Too long a GOP to hand over; wait for the next one
+    }
+    if (keyframe || (!standbyPackets.empty() && (video || audio))) {
+        standbyPackets.push_back(packet);
+    } else {
+        packetPool.release(packet);
+    }
+    standbyPacketCount = standbyPackets.size();
+    return true;
+}
+
+void M3U8StreamStrategy::paceStandby(const AVPacket* packet) {
+    // Without decoding, nothing holds the demuxer back; a recording would be
+    // read to its end in seconds. Video pts set the pace, as playback would.
+    if (packet->stream_index != videoStreamIndex || packet->pts == AV_NOPTS_VALUE) {
+        return;
+    }
+
+    const double pts = (double)packet->pts * av_q2d(videoStream->time_base);
+    auto ahead = [&]() {
+        double elapsed = static_cast<double>(PlaybackClock::monotonicNow() - standbyAnchorNs) / 1e9;
+        return pts - standbyAnchorPts - elapsed;
+    };
+
+    double wait = ahead();
+    if (standbyAnchorNs == 0 || std::abs(wait) > STANDBY_RESYNC_SECONDS) {
+        standbyAnchorNs = PlaybackClock::monotonicNow();
+        standbyAnchorPts = pts;
+        return;
+    }
+
+    // Short naps, so that promotion and close() are not held up
+    while (wait > 0.0 && standby && !stopRequested) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(std::min(wait, 0.01)));
+        wait = ahead();
+    }
+}
+
+void M3U8StreamStrategy::freeStandbyPackets() {
+    // standbyMutex held, or the demuxer stopped
+    // Back to the pool, from which the demuxer reads the next GOP
+    for (AVPacket* packet : standbyPackets) {
+        packetPool.release(packet);
+    }
+    standbyPackets.clear();
+    standbyPacketCount = 0;
+}
+
+void M3U8StreamStrategy::flushVideoDecoderIfNeeded() {
+    // After a standby the next packet is a keyframe; frames the decoder
+    // still holds from before would come out in between
+    if (videoFlushPending.exchange(false)) {
+        avcodec_flush_buffers(videoCodecCtx);
+        videoDecoderDrained = false;
+
+        // A decoder switch in progress starts over at the next keyframe
+        discardDecoderSwitch();
+    }
+}
+
+void M3U8StreamStrategy::audioDecodeLoop() {
+    Tracer::setThreadName("audio decode " + std::to_string(traceStream));
+
+    do {
+        AVPacket* packet = nullptr;
+        while (audioPackets.pop(&packet)) {
+            TraceScope trace("audio decode");
+            if (audioFlushPending.exchange(false) && audioCodecCtx) {
+                avcodec_flush_buffers(audioCodecCtx);
+            }
             handleAudioPacket(packet);
-            av_packet_unref(packet);
-            return PacketType::AUDIO;
+            packetPool.release(packet);
         }
+        if (stopRequested || !audioCodecCtx) {
+            break;
+        }
+
+        // End of input: the decoder and the resampler hand out the last of the audio
+        TraceScope trace("audio decode");
+        handleAudioPacket(nullptr);
+        drainAudioResampler();
+
+        // A seek back from the end reopens the queue, and its flush restarts the decoder
+    } while (audioPackets.waitReopened());
+}
+
+PacketType M3U8StreamStrategy::processNextFrame(VideoFrame& outFrame) {
+    // Runs on the caller's thread, which is the video decode worker
+    size_t count = 0;
+    return decodeVideo(&outFrame, 1, count, true);
+}
+
+PacketType M3U8StreamStrategy::tryProcessNextFrame(VideoFrame& outFrame) {
+    // Runs on whichever pool worker picked up this stream
+    size_t count = 0;
+    return decodeVideo(&outFrame, 1, count, false);
+}
+
+PacketType M3U8StreamStrategy::processNextFrames(VideoFrameBatch& outFrames, bool wait) {
+    return decodeVideo(outFrames.frames + outFrames.count, VideoFrameBatch::CAPACITY - outFrames.count,
+                       outFrames.count, wait);
+}
+
+PacketType M3U8StreamStrategy::decodeVideo(VideoFrame* frames, size_t capacity, size_t& count, bool wait) {
+    if (!formatContext || !videoCodecCtx) {
+        return PacketType::ERROR;
+    }
+    if (capacity == 0) {
+        return PacketType::OTHER;
     }
 
-    // End of stream or error
-    av_packet_free(&packet);
-    av_frame_free(&yuvFrame);
+    while (!stopRequested) {
+        flushVideoDecoderIfNeeded();
+
+        // What the decoder already has ready goes first; it only takes a
+        // packet once it has nothing left to hand out
+        size_t received = receiveVideoFrames(frames, capacity);
+        if (received > 0) {
+            count += received;
+            return PacketType::VIDEO;
+        }
+        if (videoDecoderDrained) {
+            if (!nextVideoCodecCtx) {
+                return PacketType::ERROR; // Drained at the end of the stream
+            }
+            finishDecoderSwitch();
+        }
+
+        AVPacket* packet = pendingVideoPacket;
+        pendingVideoPacket = nullptr;
+        if (!packet && !(wait ? videoPackets.pop(&packet) : videoPackets.tryPop(&packet))) {
+            if (!videoPackets.atEnd()) {
+                return PacketType::OTHER;
+            }
+            if (stopRequested || avcodec_send_packet(videoCodecCtx, nullptr) < 0) {
+                return PacketType::ERROR;
+            }
+            continue; // End of input: the decoder hands out the frames it still holds
+        }
+
+        if (beginDecoderSwitch(packet)) {
+            pendingVideoPacket = packet; // For the new decoder, once the old one is drained
+            continue;
+        }
+        if (!sendVideoPacket(packet)) {
+            pendingVideoPacket = packet; // Sent again once the decoder's frames are taken
+            continue;
+        }
+        packetPool.release(packet);
+    }
     return PacketType::ERROR;
 }
 
-void M3U8StreamStrategy::handleVideoPacket(AVPacket* packet, AVFrame* yuvFrame, VideoFrame& outFrame) {
-    if (avcodec_send_packet(videoCodecCtx, packet) == 0) {
-        int ret = avcodec_receive_frame(videoCodecCtx, yuvFrame);
+bool M3U8StreamStrategy::sendVideoPacket(const AVPacket* packet) {
+    TraceScope trace("decode");
+    videoDecodeStartNs = StreamMetrics::now();
+    int ret = avcodec_send_packet(videoCodecCtx, packet);
+    if (ret == AVERROR(EAGAIN)) {
+        return false;
+    }
+    if (ret < 0) {
+        // A damaged packet costs its frame, not the stream
+        metrics->add(MetricCounter::PACKETS_REJECTED);
+        std::cerr << "Error sending video packet to decoder: " << ret << std::endl;
+    }
+    return true;
+}
+
+size_t M3U8StreamStrategy::receiveVideoFrames(VideoFrame* frames, size_t capacity) {
+    size_t count = 0;
+    while (count < capacity) {
+        TraceScope trace("decode");
+        int ret = avcodec_receive_frame(videoCodecCtx, videoDecodeFrame);
+        if (ret == AVERROR_EOF) {
+            videoDecoderDrained = true;
+            break;
+        }
+        if (ret < 0) {
+            break; // Wants another packet
+        }
+        // Frame threading hands frames out packets later; the pts still ties them to their packet
+        trace.flow(TraceFlow::STEP, Tracer::frameId(traceStream, videoDecodeFrame->pts));
+        if (handleVideoFrame(videoDecodeFrame, frames[count])) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool M3U8StreamStrategy::handleVideoFrame(AVFrame* yuvFrame, VideoFrame& outFrame) {
+    uint64_t frameId = Tracer::frameId(traceStream, yuvFrame->pts);
+
+    // Each frame of a batch counts from the previous one
+    const int64_t decodedAt = StreamMetrics::now();
+    int64_t decodeNs = decodedAt - videoDecodeStartNs;
+    videoDecodeStartNs = decodedAt;
+    metrics->record(MetricStage::DECODE, decodeNs);
+    lastDecodeNs.store(decodeNs, std::memory_order_relaxed);
+    metrics->markStartup(StartupMilestone::FIRST_FRAME);
+
+    // Accurate seek: frames ahead of the target only lead the decoder up to it
+    double timestamp = (double)yuvFrame->pts * av_q2d(videoStream->time_base);
+    if (timestamp < videoSkipUntil - frameDuration / 2) {
+        seekFramesSkipped++;
+        av_frame_unref(yuvFrame);
+        return false;
+    }
+    if (videoSkipUntil != NO_SKIP) {
+        videoSkipUntil = NO_SKIP;
+    }
+    finishSeek();
+
+    const bool discontinuity = yuvFrame->pts != AV_NOPTS_VALUE && yuvFrame->pts == discontinuityPts;
+    if (discontinuity) {
+        discontinuityPts = AV_NOPTS_VALUE;
+    }
+
+    // --- We have a video frame! ---
+    if (!configureOutput(yuvFrame)) {
+        av_frame_unref(yuvFrame);
+        return false;
+    }
 
-        if (ret == 0) {
-            // --- We have a video frame! ---
-            sws_scale(
-                swsContext,
-                yuvFrame->data, yuvFrame->linesize,
-                0, videoHeight,
-                rgbaFrame->data, rgbaFrame->linesize
-            );
+    if (passthrough) {
+        // The client renders the decoder's format: hand over the
+        // decoder's own buffer without touching a single pixel.
+        outFrame = VideoFrame::take(yuvFrame, timestamp);
+        outFrame.traceId = frameId;
+        outFrame.discontinuity = discontinuity;
+        return !outFrame.empty();
+    }
 
-            outFrame.width = videoWidth;
-            outFrame.height = videoHeight;
-            outFrame.timestamp = (double)yuvFrame->pts * av_q2d(videoStream->time_base);
+    // Convert straight into a ref-counted buffer, which the
+    // VideoFrame then references; the pixels are never copied again.
+    // The buffer comes from the stream's pool and returns to it
+    // once the consumer drops the frame.
+    if (!framePool.acquire(outputFrame, outputFormat, outputWidth, outputHeight)) {
+        std::cerr << "Could not allocate output buffer." << std::endl;
+        av_frame_unref(yuvFrame);
+        return false;
+    }
 
-            int bufferSize = videoWidth * videoHeight * 4; // RGBA
-            outFrame.data.resize(bufferSize);
-            memcpy(outFrame.data.data(), rgbaBuffer, bufferSize);
-        }
+    int64_t convertStart = StreamMetrics::now();
+    {
+        TraceScope convertTrace("sws_scale", frameId);
+        sws_scale(
+            swsContext,
+            yuvFrame->data, yuvFrame->linesize,
+            0, videoHeight,
+            outputFrame->data, outputFrame->linesize
+        );
     }
+    metrics->record(MetricStage::CONVERT, StreamMetrics::now() - convertStart);
+    videoDecodeStartNs = StreamMetrics::now();
+
+    outFrame = VideoFrame::take(outputFrame, timestamp);
+    outFrame.traceId = frameId;
+    outFrame.discontinuity = discontinuity;
+
+    av_frame_unref(yuvFrame);
+    return !outFrame.empty();
 }
 
 void M3U8StreamStrategy::handleAudioPacket(AVPacket* packet) {
@@ -313,25 +1424,33 @@ void M3U8StreamStrategy::handleAudioPacket(AVPacket* packet) {
 
     // Send the raw packet to the decoder
     if (avcodec_send_packet(audioCodecCtx, packet) < 0) {
+        metrics->add(MetricCounter::PACKETS_REJECTED);
         std::cerr << "Error sending audio packet to decoder." << std::endl;
         return;
     }
 
-    AVFrame* frame = av_frame_alloc();
-    if (!frame) {
-        std::cerr << "Could not allocate audio frame." << std::endl;
-        return;
-    }
+    AVFrame* frame = audioDecodeFrame;
 
     // Receive all decoded frames from the packet
     while (avcodec_receive_frame(audioCodecCtx, frame) == 0) {
         // We have a decoded audio frame (likely in a planar format)
+        double pts = frame->pts != AV_NOPTS_VALUE
+            ? (double)frame->pts * av_q2d(audioStream->time_base)
+            : -1.0;
+
+        // Accurate seek: the audio starts with the picture
+        if (audioSkipUntil != NO_SKIP) {
+            if (pts >= 0.0 && pts < audioSkipUntil) {
+                continue;
+            }
+            audioSkipUntil = NO_SKIP;
+        }
 
         // --- 1. Resample it to our target format (16-bit stereo) ---
         int resampled_data_size = swr_convert(
             swrContext,
             &audioResampleBuffer,       // [out] The buffer to fill
-            audioResampleBufferSize,    // [in]  The max size of our buffer
+            TARGET_RESAMPLE_SAMPLES,    // [in]  The max samples our buffer holds
             (const uint8_t**)frame->data, // [in]  The input audio data
             frame->nb_samples             // [in]  Number of input samples
         );
@@ -341,28 +1460,137 @@ void M3U8StreamStrategy::handleAudioPacket(AVPacket* packet) {
             continue; // Continue to next frame
         }
 
-        // --- 2. Calculate the size in bytes of the resampled data ---
-        int bytes_to_queue = resampled_data_size * TARGET_CHANNEL_LAYOUT.nb_channels * av_get_bytes_per_sample(TARGET_SAMPLE_FORMAT);
+        // --- 2. Hand the audio to the client ---
+        queueAudio(resampled_data_size, pts);
 
-        // --- 3. Push the audio bytes into SDL's queue ---
-        // This is the magic step. SDL will take this data and play it on its own thread.
-        // The first argument '1' is the audio device ID, which SDLWindow opens.
-        if (audioCallback(audioResampleBuffer, bytes_to_queue)) {
-            // std::cerr << "Audio callback failed to queue audio data." << std::endl;
-        }
-
-        // --- 4. Update the audio clock ---
+        // --- 3. Update the audio clock ---
         // This is crucial for A/V sync. We track the timestamp of the last
         // audio frame we successfully processed.
-        if (frame->pts != AV_NOPTS_VALUE) {
-            audioClock = (double)frame->pts * av_q2d(audioStream->time_base);
+        if (pts >= 0.0) {
+            audioClock = pts;
+        }
+    }
+}
+
+void M3U8StreamStrategy::drainAudioResampler() {
+    if (!swrContext) {
+        return;
+    }
+
+    // The resampler holds back a few samples of every frame for its filter
+    int samples = 0;
+    while ((samples = swr_convert(swrContext, &audioResampleBuffer, TARGET_RESAMPLE_SAMPLES, nullptr, 0)) > 0) {
+        queueAudio(samples, -1.0);
+    }
+}
+
+void M3U8StreamStrategy::queueAudio(int samples, double pts) {
+    int bytes_to_queue = samples * TARGET_CHANNEL_LAYOUT.nb_channels * av_get_bytes_per_sample(TARGET_SAMPLE_FORMAT);
+
+    // Push mode: a client callback (e.g. SDL_QueueAudio) takes them.
+    // Pull mode: they wait in our ring until the device asks for them.
+    bool pushed = false;
+    {
+        std::lock_guard<std::mutex> lock(audioCallbackMutex);
+        if (audioCallback) {
+            audioCallback(audioResampleBuffer, bytes_to_queue);
+            pushed = true;
         }
     }
+    if (!pushed) {
+        writeAudio(audioResampleBuffer, bytes_to_queue, pts);
+    }
+}
+
+void M3U8StreamStrategy::writeAudio(const uint8_t* data, int size, double pts) {
+    // Back from standby, the reader empties the ring first; audio written
+    // before it has would go with the stale audio
+    while (audioRingStale && !stopRequested) {
+        int64_t lastRead = lastAudioReadNs.load(std::memory_order_relaxed);
+        if (lastRead == 0 || PlaybackClock::monotonicNow() - lastRead > AUDIO_CONSUMER_TIMEOUT_NS) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    size_t written = 0;
+    while (written < (size_t)size && !stopRequested) {
+        written += audioRing->write(data + written, size - written, written == 0 ? pts : -1.0);
+        if (written == (size_t)size) {
+            break;
+        }
+
+        // The ring is full. Wait for the device to drain it, unless nobody
+        // has pulled for a while, in which case the audio is dropped so
+        // that it cannot hold up the demuxer and, through it, the video.
+        int64_t lastRead = lastAudioReadNs.load(std::memory_order_relaxed);
+        if (lastRead == 0 || PlaybackClock::monotonicNow() - lastRead > AUDIO_CONSUMER_TIMEOUT_NS) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+int M3U8StreamStrategy::readAudio(uint8_t* out, int size) {
+    lastAudioReadNs.store(PlaybackClock::monotonicNow(), std::memory_order_relaxed);
+    if (!audioRing) {
+        std::fill(out, out + size, uint8_t(0));
+        return 0;
+    }
+    if (audioRingStale.exchange(false)) {
+        audioRing->discard(); // Left over from before a standby or a seek
+    }
+    if (paused) {
+        // Keeps the ring, and with it the clock, where the pause found them
+        std::fill(out, out + size, uint8_t(0));
+        return 0;
+    }
+    return (int)audioRing->read(out, size);
+}
 
-    av_frame_free(&frame);
+void M3U8StreamStrategy::setAudioOutputLatency(double seconds) {
+    audioOutputLatency = seconds;
+    if (audioRing) {
+        audioRing->getClock().setOutputLatency(seconds);
+    }
 }
 
 void M3U8StreamStrategy::close() {
+    // Stop the pipeline threads before tearing down what they use
+    interrupt();
+    if (demuxThread.joinable()) {
+        demuxThread.join();
+    }
+    if (audioThread.joinable()) {
+        audioThread.join();
+    }
+    if (timeShiftThread.joinable()) {
+        timeShiftThread.join();
+    }
+    videoPackets.flush();
+    audioPackets.flush();
+    stopRecording();
+    freeStandbyPackets();
+    standby = false;
+    resumeAtKeyframe = false;
+    videoFlushPending = false;
+    audioFlushPending = false;
+    audioRingStale = false;
+    seekPending = false;
+    seekStartNs = 0;
+    videoSkipUntil = NO_SKIP;
+    audioSkipUntil = NO_SKIP;
+    paused = false;
+
+    // The demuxer has stopped; what it learned speeds up the next open's seeks
+    if (!keyframeIndexPath.empty() && videoStream && keyframeIndex.size() > 0) {
+        if (!keyframeIndex.save(keyframeIndexPath, videoStream->time_base.num, videoStream->time_base.den)) {
+            std::cerr << "Could not save the keyframe index to " << keyframeIndexPath << std::endl;
+        }
+    }
+    keyframeIndexPath.clear();
+    seekable = false;
+
     closeVideoStream();
     closeAudioStream();
 
@@ -372,9 +1600,66 @@ void M3U8StreamStrategy::close() {
         formatContext = nullptr;
     }
 
+    // A custom IO context outlives the format context; the buffer may have been replaced by FFmpeg
+    if (ioContext) {
+        av_freep(&ioContext->buffer);
+        avio_context_free(&ioContext);
+    }
+    {
+        std::lock_guard<std::mutex> lock(prefetcherMutex);
+        prefetcher.reset();
+    }
+
     std::cout << "M3U8 Stream Strategy closed." << std::endl;
 }
 
 double M3U8StreamStrategy::getClock() {
+    // Pull mode: the lock-free position of what is being heard right now,
+    // unless that is audio from before a standby nobody has discarded yet
+    if (audioRing && !audioRingStale) {
+        double position = audioRing->getClock().position();
+        if (position >= 0.0) {
+            return position;
+        }
+    }
     return audioClock;
 }
+
+FramePoolStats M3U8StreamStrategy::getFramePoolStats() const {
+    return framePool.getStats();
+}
+
+PacketPoolStats M3U8StreamStrategy::getPacketPoolStats() const {
+    return packetPool.getStats();
+}
+
+QueueDepths M3U8StreamStrategy::getQueueDepths() const {
+    QueueDepths depths;
+    depths.videoPackets = videoPackets.size();
+    depths.audioPackets = audioPackets.size();
+    depths.packetBytes = videoPackets.bytes() + audioPackets.bytes();
+    depths.standbyPackets = standbyPacketCount.load();
+    return depths;
+}
+
+PrefetchStats M3U8StreamStrategy::getPrefetchStats() const {
+    std::lock_guard<std::mutex> lock(prefetcherMutex);
+    return prefetcher ? prefetcher->getStats() : PrefetchStats{};
+}
+
+DecodeStats M3U8StreamStrategy::getDecodeStats() const {
+    DecodeStats stats;
+    const LatencyHistogram& decode = metrics->histogram(MetricStage::DECODE);
+    const LatencyHistogram& demux = metrics->histogram(MetricStage::DEMUX_WAIT);
+    const LatencyHistogram& convert = metrics->histogram(MetricStage::CONVERT);
+
+    stats.framesDecoded = decode.count();
+    stats.totalDecodeMs = static_cast<double>(decode.sumNs()) / 1e6;
+    stats.lastDecodeMs = static_cast<double>(lastDecodeNs.load(std::memory_order_relaxed)) / 1e6;
+    stats.threadCount = decoderThreads;
+    stats.packetsDemuxed = demux.count();
+    stats.totalDemuxMs = static_cast<double>(demux.sumNs()) / 1e6;
+    stats.framesConverted = convert.count();
+    stats.totalConvertMs = static_cast<double>(convert.sumNs()) / 1e6;
+    return stats;
+}
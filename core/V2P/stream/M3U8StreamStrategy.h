@@ -2,15 +2,33 @@
 
 #include "IStreamStrategy.h"
 #include "VideoFrame.h"
+#include "FramePool.h"
+#include "PacketQueue.h"
+#include "PacketPool.h"
+#include "KeyframeIndex.h"
+#include "V2P/utils/AudioRingBuffer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <vector>
 
 // Forward-declare FFmpeg types
 struct AVFormatContext;
 struct AVCodecContext;
+struct AVCodec;
 struct AVStream;
 struct SwsContext;
 struct SwrContext;
 struct AVFrame;
 struct AVPacket;
+struct AVIOContext;
+
+class HlsPrefetcher;
+class StreamRecorder;
+class TimeShiftBuffer;
 
 /**
  * @brief A concrete strategy for handling HLS (.m3u8) streams.
@@ -24,35 +42,142 @@ public:
 
     void setAudioCallback(AudioCallback callback) override;
 
-    // Updated method signature
+    // Pops compressed video from the demuxer's queue and decodes it
     PacketType processNextFrame(VideoFrame& outFrame) override;
+    PacketType tryProcessNextFrame(VideoFrame& outFrame) override;
+    PacketType processNextFrames(VideoFrameBatch& outFrames, bool wait) override;
+
+    void interrupt() override;
 
     // Get the clock from audio stream
     double getClock() override;
 
+    int readAudio(uint8_t* out, int size) override;
+
+    void setAudioOutputLatency(double seconds) override;
+
+    void setDisplaySize(int width, int height) override;
+
+    void setOutputSize(int width, int height) override;
+    void setDecoderThreadCount(int threads) override;
+    bool setInputCallback(std::function<void()> callback) override;
+
+    bool setStandby(bool enabled) override;
+
+    bool startRecording(const RecorderConfig& config) override;
+    void stopRecording() override;
+    RecorderStats getRecorderStats() const override;
+
+    bool seek(double seconds, SeekMode mode) override;
+    SeekStats getSeekStats() const override;
+    void setPaused(bool pause) override;
+    TimeShiftRange getTimeShiftRange() const override;
+
+    FramePoolStats getFramePoolStats() const override;
+
+    PacketPoolStats getPacketPoolStats() const override;
+
+    DecodeStats getDecodeStats() const override;
+
+    QueueDepths getQueueDepths() const override;
+
+    PrefetchStats getPrefetchStats() const override;
+
     void close() override;
 
 private:
     // Helpers for initialization and cleanup
     bool initVideoStream();
     bool initAudioStream();
+    void configureDecoderThreads();
+    int requestedThreadCount() const;
+    bool configureOutput(const AVFrame* decodedFrame);
+    void outputSizeFor(int width, int height, int& outWidth, int& outHeight) const;
+    int lowresFor(const AVCodec* codec) const;
+
+    // Switches to a decoder at another lowres or thread count: begin drains
+    // the old one and holds the keyframe back, finish takes over once it is
+    // drained, discard gives up on it
+    bool beginDecoderSwitch(const AVPacket* packet);
+    void finishDecoderSwitch();
+    void discardDecoderSwitch();
     void closeVideoStream();
     void closeAudioStream();
 
+    // Pipeline threads
+    void demuxLoop();
+    void waitAtEnd(); // The demuxer at the end of a VOD input, until a seek or a stop
+    void audioDecodeLoop();
+    static int interruptCallback(void* opaque);
+
+    // Puts an HlsPrefetcher in front of the demuxer; false leaves the URL to FFmpeg
+    bool openPrefetcher(const std::string& url);
+    static int readPrefetched(void* opaque, uint8_t* buffer, int size);
+
+    // Where CodecParameterCache keeps this stream's parameters
+    std::string codecCacheKey(const std::string& url) const;
+
+    // Standby: keeps the packet if it belongs to the current GOP, frees it
+    // otherwise. False if the stream is no longer on standby.
+    bool holdStandbyPacket(AVPacket* packet);
+    void paceStandby(const AVPacket* packet);
+    void freeStandbyPackets();
+
+    // Time shift: replays the buffer into the packet queues
+    void timeShiftLoop();
+    void appendTimeShift(const AVPacket* packet);
+
+    // Seeking: moves the input (demux thread), then has the decoders start over
+    bool seekInput(double target, double& keyframeSeconds);
+    void restartDecoders(SeekMode mode, double target);
+    void finishSeek();
+
+    // Drops what an earlier decode left behind, on the decoding thread
+    void flushVideoDecoderIfNeeded();
+
+    // Audio decoding, on audioThread; a null packet drains the decoder
     void handleAudioPacket(AVPacket* packet);
-    void handleVideoPacket(AVPacket* packet, AVFrame* yuvFrame, VideoFrame& outFrame);
+    void drainAudioResampler();
+    void queueAudio(int samples, double pts);
+    void writeAudio(const uint8_t* data, int size, double pts);
+
+    // Video decoding, on the thread asking for frames: appends up to capacity frames
+    PacketType decodeVideo(VideoFrame* frames, size_t capacity, size_t& count, bool wait);
+    bool sendVideoPacket(const AVPacket* packet); // False if the decoder wants frames taken first
+    size_t receiveVideoFrames(VideoFrame* frames, size_t capacity);
+    bool handleVideoFrame(AVFrame* yuvFrame, VideoFrame& outFrame);
 
     // Video members
     AVFormatContext* formatContext;
+    std::unique_ptr<HlsPrefetcher> prefetcher; // Feeds formatContext through ioContext when set
+    mutable std::mutex prefetcherMutex; // For interrupt() and stats; the opening thread owns the pointer
+    AVIOContext* ioContext;
     AVCodecContext* videoCodecCtx;
     AVStream* videoStream;
     int videoStreamIndex;
 
-    SwsContext* swsContext;
-    AVFrame* rgbaFrame;
-    uint8_t* rgbaBuffer;
+    SwsContext* swsContext; // Only set when the output format needs converting
+    AVFrame* outputFrame; // Reusable shell for the scaler output
+    FramePool framePool; // Recycles the converted buffers handed to consumers
     int videoWidth;
     int videoHeight;
+    int sourceFormat; // AVPixelFormat the decoder produces
+    int outputFormat; // AVPixelFormat handed to the client
+    bool passthrough; // Decoded frames are already in an accepted format
+
+    // Decoder threads granted (and owed back to decoderConfig.budget); 0
+    // while on standby, when the idle decoder's threads go back to the budget
+    std::atomic<int> decoderThreads;
+    std::atomic<int> requestedDecoderThreads; // 0 for decoderConfig.threadCount
+
+    // Stage timings go to the metrics histograms; this is the latest decode only
+    std::atomic<int64_t> lastDecodeNs;
+    std::atomic<double> frameDuration; // Seconds per frame, to turn queued packets into time
+
+    // Where the client draws the stream, for the ABR; 0 if unknown
+    std::atomic<int> displayWidth;
+    std::atomic<int> displayHeight;
+    uint32_t traceStream; // Tracer frame ids: this stream's half, the pts is the other
 
     // Audio members
     AVCodecContext* audioCodecCtx;
@@ -61,7 +186,104 @@ private:
     SwrContext* swrContext;
     uint8_t* audioResampleBuffer; // A buffer to hold resampled audio
     int audioResampleBufferSize;
-    double audioClock; // Tracks the timestamp of the last *decoded* audio frame
+    std::atomic<double> audioClock; // Tracks the timestamp of the last *decoded* audio frame
+    std::unique_ptr<AudioRingBuffer> audioRing; // Pull-mode output, drained by readAudio()
+    std::atomic<int64_t> lastAudioReadNs; // When readAudio() last ran; 0 if never
+    double audioOutputLatency; // Device latency, kept for rings created later
 
     AudioCallback audioCallback; // Callback for decoded audio data
+    std::mutex audioCallbackMutex;
+
+    // Pipeline: demuxThread -> {videoPackets, audioPackets} -> decoders.
+    // Video is decoded on the thread calling processNextFrame(), audio on audioThread.
+    static constexpr size_t VIDEO_PACKET_QUEUE_SIZE = 300;
+    static constexpr size_t AUDIO_PACKET_QUEUE_SIZE = 500;
+    static constexpr int64_t AUDIO_CONSUMER_TIMEOUT_NS = 1'000'000'000;
+    static constexpr int PREFETCH_IO_BUFFER_SIZE = 64 * 1024;
+    // Bounds a held GOP so that promotion always fits it into the packet queues
+    static constexpr size_t STANDBY_MAX_PACKETS = 240;
+    static constexpr double STANDBY_RESYNC_SECONDS = 2.0; // Pts jump that re-anchors the pacing
+
+    AVFrame* videoDecodeFrame; // Reused by the video decode thread
+    AVFrame* audioDecodeFrame; // Reused by the audio decode thread
+    PacketPool packetPool; // The demuxer reads into packets the decoders handed back
+    PacketQueue videoPackets;
+    PacketQueue audioPackets;
+    std::thread demuxThread;
+    std::thread audioThread;
+    std::atomic<bool> stopRequested;
+
+    // Warm standby: the demuxer files packets here instead of the queues.
+    // Video and audio in demux order, from the latest video keyframe on.
+    std::atomic<bool> standby;
+    std::mutex standbyMutex;
+    // Guarded by standbyMutex. Only ever appended to and emptied as a whole,
+    // so a vector reserved to STANDBY_MAX_PACKETS never allocates again.
+    std::vector<AVPacket*> standbyPackets;
+    std::atomic<size_t> standbyPacketCount;
+    std::atomic<int64_t> standbyAnchorNs; // Wall time of standbyAnchorPts; 0 re-anchors
+    double standbyAnchorPts; // Demux thread only
+    std::atomic<bool> resumeAtKeyframe; // Promoted without a GOP: the demuxer waits for one
+
+    // Set on standby and seeks, so that decoding resumes cleanly at the keyframe
+    std::atomic<bool> videoFlushPending;
+    std::atomic<bool> audioFlushPending;
+    std::atomic<bool> audioRingStale; // The reader discards the ring and resets its clock
+
+    // Stream-copy recording, fed by the demuxer; kept after stopping for its counters
+    std::unique_ptr<StreamRecorder> recorder;
+    mutable std::mutex recorderMutex;
+    std::atomic<bool> recording;
+
+    // Time shift: the demuxer appends every packet to the buffer instead of
+    // the queues, and timeShiftThread feeds the queues from a read position
+    // that seeks move around. Kept after close() for its range.
+    std::unique_ptr<TimeShiftBuffer> timeShift;
+    std::thread timeShiftThread;
+    std::atomic<double> timeShiftPosition; // Stream time of the last packet fed
+    double timeShiftSeconds; // Demux thread only: stream time of the last packet appended
+
+    // Paused: the feeder stops and readAudio() holds the ring where it is
+    std::atomic<bool> paused;
+    std::mutex pauseMutex;
+    std::condition_variable pauseChanged;
+
+    // Seeking: seek() files the request, and the demuxer or the time-shift
+    // feeder carries it out between two packets
+    std::atomic<bool> seekPending;
+    std::atomic<bool> demuxFinished; // Nothing feeds the packet queues any more; seeks are refused
+    std::atomic<double> seekTarget;
+    std::atomic<SeekMode> seekMode;
+    std::atomic<int64_t> seekStartNs; // Request time of the seek awaiting its first frame; 0 if none
+    std::atomic<double> videoSkipUntil; // Accurate seeks: earlier frames are decoded, not output
+    std::atomic<double> audioSkipUntil;
+    std::atomic<int64_t> discontinuityPts; // First video pts after an EXT-X-DISCONTINUITY, until its frame is out
+    bool seekable; // A recorded input the demuxer can move around in
+    KeyframeIndex keyframeIndex; // Demux thread, and open()/close() around it
+    std::string keyframeIndexPath; // Sidecar file; empty without SeekConfig::indexDirectory
+
+    std::atomic<uint64_t> seekCount;
+    std::atomic<uint64_t> indexedSeekCount;
+    std::atomic<uint64_t> seekPacketsSkipped;
+    std::atomic<uint64_t> seekFramesSkipped;
+    std::atomic<uint64_t> seeksMeasured;
+    std::atomic<size_t> keyframesIndexed;
+    std::atomic<int64_t> lastSeekNs;
+    std::atomic<int64_t> totalSeekNs;
+    std::atomic<int64_t> maxSeekNs;
+
+    // Decode at display size: frames are scaled to what the client draws,
+    // and decoded at a reduced resolution where the codec can
+    std::atomic<int> requestedOutputWidth; // 0 for the decoded size
+    std::atomic<int> requestedOutputHeight;
+    int outputWidth; // Decoding thread: size of the frames handed out
+    int outputHeight;
+
+    // Decoding thread: a decoder being drained hands its place to
+    // nextVideoCodecCtx, which then gets pendingVideoPacket first
+    AVCodecContext* nextVideoCodecCtx;
+    int nextDecoderThreads; // Already traded for decoderThreads in the budget
+    AVPacket* pendingVideoPacket;
+    bool videoDecoderDrained; // The decoder returned AVERROR_EOF
+    int64_t videoDecodeStartNs; // Since the last packet sent or frame handed out
 };
@@ -0,0 +1,56 @@
+#include "PacketPool.h"
+
+extern "C" {
+#include <libavcodec/packet.h>
+}
+
+PacketPool::PacketPool(size_t maxIdle)
+    : maxIdle(maxIdle) {
+    idle.reserve(maxIdle);
+}
+
+PacketPool::~PacketPool() {
+    for (AVPacket* packet : idle) {
+        av_packet_free(&packet);
+    }
+}
+
+AVPacket* PacketPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!idle.empty()) {
+            AVPacket* packet = idle.back();
+            idle.pop_back();
+            hits++;
+            return packet;
+        }
+        misses++;
+    }
+    return av_packet_alloc();
+}
+
+void PacketPool::release(AVPacket* packet) {
+    if (!packet) {
+        return;
+    }
+
+    // The payload goes back to whoever allocated it now, not when the struct is reused
+    av_packet_unref(packet);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (idle.size() < maxIdle) {
+            idle.push_back(packet);
+            return;
+        }
+    }
+    av_packet_free(&packet);
+}
+
+PacketPoolStats PacketPool::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    PacketPoolStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.idle = idle.size();
+    return stats;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Forward-declare FFmpeg types
+struct AVPacket;
+
+/**
+ * @brief Counters describing how well a PacketPool is recycling packets.
+ *
+ * In steady-state playback misses should stop growing: every packet the
+ * demuxer reads into then is one a decoder has already handed back.
+ */
+struct PacketPoolStats {
+    uint64_t hits = 0;   // Packets served from a recycled one
+    uint64_t misses = 0; // Packets that had to be allocated
+    size_t idle = 0;     // Packets waiting to be reused
+};
+
+/**
+ * @brief Recycles the AVPacket structs travelling from a demuxer to its
+ * decoders, so that the demuxer does not allocate one per packet.
+ *
+ * Only the struct is kept: release() drops the packet's reference to its
+ * payload. PacketQueues given the pool hand the packets they drop back to
+ * it; packets freed elsewhere are simply replaced by new ones. Thread-safe.
+ */
+class PacketPool {
+public:
+    /**
+     * @param maxIdle Packets kept for reuse; more are freed on release.
+     */
+    explicit PacketPool(size_t maxIdle = 1024);
+    ~PacketPool();
+
+    PacketPool(const PacketPool&) = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+
+    /**
+     * @brief Gets an empty packet, owned by the caller.
+     * @return The packet, or nullptr if it could not be allocated.
+     */
+    AVPacket* acquire();
+
+    /**
+     * @brief Hands a packet back, unreferencing it. Null is ignored.
+     */
+    void release(AVPacket* packet);
+
+    PacketPoolStats getStats() const;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<AVPacket*> idle; // Reserved up front, so that releasing never allocates
+    size_t maxIdle;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
@@ -0,0 +1,164 @@
+#include "PacketQueue.h"
+#include "PacketPool.h"
+
+extern "C" {
+#include <libavcodec/packet.h>
+}
+
+PacketQueue::~PacketQueue() {
+    std::lock_guard<std::mutex> lock(mutex);
+    clearLocked();
+}
+
+bool PacketQueue::push(AVPacket* packet) {
+    std::unique_lock<std::mutex> lock(mutex);
+    condFull.wait(lock, [this]() { return count < maxPackets || aborted; });
+
+    if (aborted) {
+        drop(packet);
+        return false;
+    }
+
+    pushLocked(packet);
+    condEmpty.notify_one();
+    if (count == 1 && readyCallback) {
+        readyCallback();
+    }
+    return true;
+}
+
+bool PacketQueue::tryPush(AVPacket* packet) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (aborted || count >= maxPackets) {
+        drop(packet);
+        return false;
+    }
+
+    pushLocked(packet);
+    condEmpty.notify_one();
+    if (count == 1 && readyCallback) {
+        readyCallback();
+    }
+    return true;
+}
+
+bool PacketQueue::pop(AVPacket** outPacket) {
+    std::unique_lock<std::mutex> lock(mutex);
+    condEmpty.wait(lock, [this]() { return count > 0 || finished || aborted; });
+
+    if (aborted || count == 0)
+        return false;
+
+    *outPacket = popLocked();
+    condFull.notify_one();
+    return true;
+}
+
+bool PacketQueue::tryPop(AVPacket** outPacket) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (aborted || count == 0)
+        return false;
+
+    *outPacket = popLocked();
+    condFull.notify_one();
+    return true;
+}
+
+bool PacketQueue::atEnd() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return aborted || (finished && count == 0);
+}
+
+void PacketQueue::finish() {
+    std::lock_guard<std::mutex> lock(mutex);
+    finished = true;
+    condEmpty.notify_all();
+    if (readyCallback) {
+        readyCallback();
+    }
+}
+
+void PacketQueue::abort() {
+    std::lock_guard<std::mutex> lock(mutex);
+    aborted = true;
+    condEmpty.notify_all();
+    condFull.notify_all();
+    if (readyCallback) {
+        readyCallback();
+    }
+}
+
+void PacketQueue::setReadyCallback(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    readyCallback = std::move(callback);
+}
+
+void PacketQueue::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    clearLocked();
+    finished = false;
+    aborted = false;
+    condFull.notify_all();
+}
+
+void PacketQueue::reopen() {
+    std::lock_guard<std::mutex> lock(mutex);
+    clearLocked();
+    finished = false;
+    condEmpty.notify_all();
+    condFull.notify_all();
+}
+
+bool PacketQueue::waitReopened() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condEmpty.wait(lock, [this]() { return !finished || aborted; });
+    return !aborted;
+}
+
+void PacketQueue::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    clearLocked();
+    condFull.notify_all();
+}
+
+size_t PacketQueue::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
+
+size_t PacketQueue::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totalBytes;
+}
+
+void PacketQueue::pushLocked(AVPacket* packet) {
+    packets[(head + count) % maxPackets] = packet;
+    count++;
+    totalBytes += packet->size;
+}
+
+AVPacket* PacketQueue::popLocked() {
+    AVPacket* packet = packets[head];
+    packets[head] = nullptr;
+    head = (head + 1) % maxPackets;
+    count--;
+    totalBytes -= packet->size;
+    return packet;
+}
+
+void PacketQueue::clearLocked() {
+    while (count > 0) {
+        drop(popLocked());
+    }
+    head = 0;
+    totalBytes = 0;
+}
+
+void PacketQueue::drop(AVPacket* packet) {
+    // A seek or a standby empties the queue; the demuxer reads on into the same packets
+    if (pool) {
+        pool->release(packet);
+    } else {
+        av_packet_free(&packet);
+    }
+}
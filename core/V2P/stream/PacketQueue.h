@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+// Forward-declare FFmpeg types
+struct AVPacket;
+
+class PacketPool;
+
+/**
+ * @brief Depths of the queues between the stages of a stream's pipeline.
+ */
+struct QueueDepths {
+    size_t videoPackets = 0;   // Compressed video waiting for the video decoder
+    size_t audioPackets = 0;   // Compressed audio waiting for the audio decoder
+    size_t packetBytes = 0;    // Bytes held by both packet queues
+    size_t videoFrames = 0;    // Decoded frames waiting for the client
+    size_t standbyPackets = 0; // Held back to the last keyframe while on standby
+};
+
+/**
+ * @brief A bounded, thread-safe queue of compressed packets between the
+ * demuxer and a decoder.
+ *
+ * The queue owns the packets it holds. finish() marks the end of input:
+ * consumers drain what is left and then see the end of the stream.
+ * abort() wakes everyone up and makes every further call fail.
+ * Packets are kept in a ring allocated with the queue, so pushing and
+ * popping never allocate. Packets the queue drops (clear(), flush(), a push
+ * that fails) go back to the PacketPool they came from, if one is given.
+ * A consumer that does not block on pop() can set
+ * a ready callback to hear when there is something to pop again.
+ */
+class PacketQueue {
+public:
+    /**
+     * @param maxPackets Packets held at most; pushing beyond blocks or fails.
+     * @param pool Where dropped packets go back to; nullptr frees them.
+     * It must outlive the queue.
+     */
+    explicit PacketQueue(size_t maxPackets = 256, PacketPool* pool = nullptr)
+        : packets(maxPackets), maxPackets(maxPackets), pool(pool) {}
+    ~PacketQueue();
+
+    PacketQueue(const PacketQueue&) = delete;
+    PacketQueue& operator=(const PacketQueue&) = delete;
+
+    /**
+     * @brief Push a packet, taking ownership of it.
+     * Blocks if queue is full until space becomes available.
+     * @return True if queued; false if aborted (the packet is then dropped).
+     */
+    bool push(AVPacket* packet);
+
+    /**
+     * @brief Push a packet, taking ownership of it. Never blocks.
+     * @return True if queued; false if full or aborted (the packet is then dropped).
+     */
+    bool tryPush(AVPacket* packet);
+
+    /**
+     * @brief Pop the oldest packet. Blocks until one is available.
+     * @param outPacket [out] Receives ownership of the packet.
+     * @return True if a packet was popped, false if finished and drained, or aborted.
+     */
+    bool pop(AVPacket** outPacket);
+
+    /**
+     * @brief Pop the oldest packet if there is one. Never blocks.
+     * @param outPacket [out] Receives ownership of the packet.
+     * @return True if a packet was popped, false if the queue is empty or aborted.
+     */
+    bool tryPop(AVPacket** outPacket);
+
+    /**
+     * @brief True once no packet will ever come out again: finished and drained, or aborted.
+     */
+    bool atEnd() const;
+
+    /**
+     * @brief Signal that no more packets will be pushed.
+     */
+    void finish();
+
+    /**
+     * @brief Abort the queue (wakes up any waiting threads).
+     */
+    void abort();
+
+    /**
+     * @brief Sets what to call when an empty queue gets a packet, or is
+     * finished or aborted; nullptr removes it. It runs on the pushing
+     * thread under the queue's lock, so once this returns the previous
+     * callback is no longer running. It must not call back into the queue.
+     */
+    void setReadyCallback(std::function<void()> callback);
+
+    /**
+     * @brief Drop all queued packets and re-arm a finished or aborted queue.
+     */
+    void flush();
+
+    /**
+     * @brief Drop all queued packets and re-arm a finished queue, e.g. when
+     * a demuxer at the end of its input seeks back. An aborted queue stays so.
+     */
+    void reopen();
+
+    /**
+     * @brief For a consumer that has drained a finished queue: blocks until
+     * reopen() or abort().
+     * @return True if reopened, false if aborted.
+     */
+    bool waitReopened();
+
+    /**
+     * @brief Drop all queued packets. Unlike flush(), a finished or aborted queue stays so.
+     */
+    void clear();
+
+    size_t size() const;
+    size_t bytes() const;
+
+private:
+    void pushLocked(AVPacket* packet);
+    AVPacket* popLocked();
+    void clearLocked();
+    void drop(AVPacket* packet);
+
+    mutable std::mutex mutex;
+    std::function<void()> readyCallback;
+    std::condition_variable condEmpty;
+    std::condition_variable condFull;
+    std::vector<AVPacket*> packets; // Ring of maxPackets slots
+    size_t maxPackets;
+    PacketPool* pool;
+    size_t head = 0; // Slot of the oldest packet
+    size_t count = 0;
+    size_t totalBytes = 0;
+    bool finished = false;
+    bool aborted = false;
+};
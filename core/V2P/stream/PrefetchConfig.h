@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Settings of the HLS segment prefetcher. Applied when the stream is opened.
+ */
+struct PrefetchConfig {
+    // Serve HLS playlists through HlsPrefetcher instead of FFmpeg's HLS
+    // demuxer. Playlists it cannot serve fall back to FFmpeg either way.
+    bool enabled = true;
+
+    int parallelFetches = 3;     // Segments downloaded at the same time
+    int segmentsAhead = 4;       // How far past the reader to fetch, in segments
+    size_t cacheBytes = 64 << 20; // Fetched but unread segments stop being prefetched beyond this
+
+    // Live playlists start this many segments from their end
+    int liveStartSegments = 3;
+
+    // Adaptive bitrate: move between the variants of a master playlist at
+    // segment boundaries (see AbrController). Off, the best variant is kept.
+    bool adaptive = true;
+    double initialBandwidth = 1'000'000; // Bits per second assumed until the first segment arrives
+    double bandwidthSafety = 0.8;        // Share of the measured throughput a variant may take
+};
+
+/**
+ * @brief What the prefetcher did for one stream.
+ */
+struct PrefetchStats {
+    bool active = false;          // False if the stream went through FFmpeg's HLS demuxer
+
+    uint64_t segmentsFetched = 0;
+    uint64_t bytesFetched = 0;
+    uint64_t fetchErrors = 0;     // Failed attempts, retries included
+    double totalFetchMs = 0.0;
+
+    uint64_t segmentsServed = 0;  // Segments the demuxer started reading
+    uint64_t readerWaits = 0;     // ... of which it had to wait for
+    uint64_t discontinuities = 0; // ... of which started after an EXT-X-DISCONTINUITY
+    double totalWaitMs = 0.0;
+
+    // Master playlists only
+    int variantHeight = 0;        // The variant new segments are fetched from
+    int64_t variantBandwidth = 0;
+    uint64_t variantSwitches = 0;
+    double estimatedBandwidth = 0.0; // Bits per second, as the ABR sees it
+};
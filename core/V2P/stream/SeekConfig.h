@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Where a seek lands.
+ */
+enum class SeekMode {
+    KEYFRAME,  // The last keyframe at or before the target: nothing decoded in vain
+    ACCURATE   // The target itself: decodes from that keyframe and discards what comes before
+};
+
+/**
+ * @brief Seeking in recorded (VOD) inputs. Applied when the stream is opened.
+ */
+struct SeekConfig {
+    // The keyframes seen while demuxing are kept as an index, so that a
+    // seek knows which keyframe it lands on. With a directory, the index is
+    // loaded from a sidecar file there on open and saved back on close.
+    std::string indexDirectory;
+};
+
+/**
+ * @brief Seek counters of a stream; latencies run from the request to the
+ * first frame decoded at the new position.
+ */
+struct SeekStats {
+    uint64_t seeks = 0;
+    uint64_t indexedSeeks = 0;   // Landed on a keyframe known from the index
+    uint64_t packetsSkipped = 0; // Demuxed after the seek but before its keyframe, never decoded
+    uint64_t framesSkipped = 0;  // Decoded in accurate mode ahead of the target
+    size_t keyframesIndexed = 0;
+    double lastMs = 0.0;
+    double averageMs = 0.0;
+    double maxMs = 0.0;
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief How a stream gets to its first picture. Applied when the stream is opened.
+ */
+struct StartupConfig {
+    // Minimise time to first frame: probe with the limits below, reuse codec
+    // parameters seen before (CodecParameterCache), skip the format dump,
+    // start decoding at a keyframe and present the first frame as soon as
+    // it is decoded, before A/V sync has anything to go on
+    bool fastStart = false;
+
+    // Probing limits under fastStart; FFmpeg's defaults are 5 MB and 5 s
+    int64_t probeSize = 256 * 1024;    // Bytes
+    int64_t analyzeDuration = 500'000; // Microseconds
+
+    // Open on a background thread: the factory returns at once, and
+    // hasEnded() stays false until the open has finished or failed
+    bool asyncOpen = false;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include "V2P/stream/VideoFrame.h"
+#include "V2P/stream/DecoderConfig.h"
+#include "V2P/stream/PrefetchConfig.h"
+#include "V2P/stream/StartupConfig.h"
+#include "V2P/stream/TimeShiftConfig.h"
+#include "V2P/stream/SeekConfig.h"
+
+/**
+ * @brief Client-side settings applied to a stream before it is opened.
+ */
+struct StreamOptions {
+    // Output formats the client can render, most preferred first. Decoded
+    // frames already in one of these are passed through untouched; anything
+    // else is converted to the first entry.
+    std::vector<PixelFormat> acceptedFormats = { PixelFormat::RGBA };
+
+    // Video decoder threading
+    DecoderConfig decoder;
+
+    // HLS segment fetching
+    PrefetchConfig prefetch;
+
+    // Probing, fast start and asynchronous open
+    StartupConfig startup;
+
+    // Pause, rewind and return to live from a buffer of the compressed stream
+    TimeShiftConfig timeShift;
+
+    // Keyframe index of recorded inputs
+    SeekConfig seek;
+
+    // Size the stream will be drawn at, if known; adaptive HLS picks its
+    // first variant with it. Update later with VideoStreamer::setDisplaySize().
+    int displayWidth = 0;
+    int displayHeight = 0;
+
+    // Size the frames are handed out at, 0 for the decoded size; set before
+    // open() so that the decoder starts at a reduced resolution where it can.
+    // Update later with VideoStreamer::setOutputSize().
+    int outputWidth = 0;
+    int outputHeight = 0;
+
+    // Leave decode steps to an external scheduler instead of spawning a
+    // thread per stream (see VideoStreamer::decodeStep)
+    bool externalScheduling = false;
+};
@@ -0,0 +1,313 @@
+#include "TimeShiftBuffer.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+TimeShiftBuffer::TimeShiftBuffer(TimeShiftConfig config) : config(std::move(config)) {}
+
+TimeShiftBuffer::~TimeShiftBuffer() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Entry& entry : entries) {
+        av_packet_free(&entry.packet);
+    }
+    entries.clear();
+    closeSpillFile();
+}
+
+void TimeShiftBuffer::append(const AVPacket* packet, double seconds, bool keyframe) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (finished || aborted) {
+            return;
+        }
+        // Nothing can be decoded before the first keyframe
+        if (entries.empty() && !keyframe) {
+            return;
+        }
+
+        Entry entry;
+        entry.packet = av_packet_clone(packet);
+        if (!entry.packet) {
+            return;
+        }
+        entry.size = packet->size;
+        entry.pts = packet->pts;
+        entry.dts = packet->dts;
+        entry.duration = packet->duration;
+        entry.streamIndex = packet->stream_index;
+        entry.flags = packet->flags;
+        entry.seconds = seconds;
+        entry.keyframe = keyframe;
+
+        if (keyframe) {
+            keyframes.push_back(firstPosition + entries.size());
+        }
+        entries.push_back(entry);
+        memoryBytes += entry.size;
+
+        // Age: drop the oldest GOP as long as the rest still spans the window
+        while (keyframes.size() > 1 &&
+               seconds - entries[keyframes[1] - firstPosition].seconds >= config.maxSeconds) {
+            dropOldestGop();
+        }
+
+        // Memory: move the oldest packets to the spill file, or drop them
+        while (memoryBytes > config.memoryBytes) {
+            if (spillOldest()) {
+                continue;
+            }
+            if (!dropOldestGop()) {
+                break;
+            }
+        }
+    }
+    appended.notify_all();
+}
+
+void TimeShiftBuffer::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    appended.notify_all();
+}
+
+void TimeShiftBuffer::abort() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        aborted = true;
+    }
+    appended.notify_all();
+}
+
+TimeShiftRead TimeShiftBuffer::read(uint64_t& position, AVPacket** outPacket, std::chrono::milliseconds wait) {
+    std::unique_lock<std::mutex> lock(mutex);
+    appended.wait_for(lock, wait, [&] {
+        return aborted || finished || position < firstPosition + entries.size();
+    });
+    if (aborted) {
+        return TimeShiftRead::END;
+    }
+
+    // Fell out of the window: the window starts at a keyframe
+    if (position < firstPosition) {
+        position = firstPosition;
+    }
+    if (position >= firstPosition + entries.size()) {
+        return finished ? TimeShiftRead::END : TimeShiftRead::WAITING;
+    }
+
+    const Entry& entry = entries[position - firstPosition];
+    AVPacket* packet = nullptr;
+    if (entry.packet) {
+        packet = av_packet_clone(entry.packet);
+    } else {
+        packet = av_packet_alloc();
+        if (packet && av_new_packet(packet, entry.size) < 0) {
+            av_packet_free(&packet);
+        }
+        if (packet) {
+            if (entry.size > 0) {
+                std::memcpy(packet->data, spillMap + entry.spillOffset, entry.size);
+            }
+            packet->pts = entry.pts;
+            packet->dts = entry.dts;
+            packet->duration = entry.duration;
+            packet->stream_index = entry.streamIndex;
+            packet->flags = entry.flags;
+        }
+    }
+    if (!packet) {
+        std::cerr << "Time shift: could not allocate a packet." << std::endl;
+        return TimeShiftRead::END;
+    }
+
+    position++;
+    *outPacket = packet;
+    return TimeShiftRead::PACKET;
+}
+
+uint64_t TimeShiftBuffer::keyframeAtOrBefore(double seconds) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (keyframes.empty()) {
+        return firstPosition;
+    }
+    uint64_t result = keyframes.front();
+    for (uint64_t keyframe : keyframes) {
+        if (entries[keyframe - firstPosition].seconds > seconds) {
+            break;
+        }
+        result = keyframe;
+    }
+    return result;
+}
+
+double TimeShiftBuffer::secondsAt(uint64_t position) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.empty()) {
+        return 0.0;
+    }
+    if (position < firstPosition) {
+        return entries.front().seconds;
+    }
+    if (position >= firstPosition + entries.size()) {
+        return entries.back().seconds;
+    }
+    return entries[position - firstPosition].seconds;
+}
+
+TimeShiftRange TimeShiftBuffer::getRange() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    TimeShiftRange range;
+    range.available = true;
+    if (!entries.empty()) {
+        range.start = entries.front().seconds;
+        range.end = entries.back().seconds;
+    }
+    range.packets = entries.size();
+    range.memoryBytes = memoryBytes;
+    range.spillBytes = spillBytesUsed;
+    return range;
+}
+
+bool TimeShiftBuffer::dropOldestGop() {
+    // Never the GOP being received
+    if (keyframes.size() < 2) {
+        return false;
+    }
+    const uint64_t end = keyframes[1];
+    while (firstPosition < end) {
+        Entry& entry = entries.front();
+        if (entry.packet) {
+            memoryBytes -= entry.size;
+            av_packet_free(&entry.packet);
+        } else {
+            spillBytesUsed -= entry.size;
+            spilledCount--;
+        }
+        entries.pop_front();
+        firstPosition++;
+    }
+    keyframes.pop_front();
+    if (spillBytesUsed == 0) {
+        spillWrite = 0;
+    }
+    return true;
+}
+
+bool TimeShiftBuffer::spillOldest() {
+    if (config.spillDirectory.empty() || spillFailed || spilledCount >= entries.size()) {
+        return false;
+    }
+    if (!spillMap && !openSpillFile()) {
+        return false;
+    }
+
+    Entry& entry = entries[spilledCount];
+    size_t offset = 0;
+    if (!allocateSpill(entry.size, offset)) {
+        return false;
+    }
+    if (entry.size > 0) {
+        std::memcpy(spillMap + offset, entry.packet->data, entry.size);
+    }
+    av_packet_free(&entry.packet);
+    entry.spillOffset = offset;
+    spilledCount++;
+    memoryBytes -= entry.size;
+    spillBytesUsed += entry.size;
+    return true;
+}
+
+bool TimeShiftBuffer::allocateSpill(int size, size_t& offset) {
+    const size_t bytes = static_cast<size_t>(size);
+    if (bytes > spillCapacity) {
+        return false;
+    }
+    if (spillBytesUsed == 0) {
+        offset = 0;
+        spillWrite = bytes;
+        return true;
+    }
+
+    // Spilled packets are the front of the window, so the oldest data starts
+    // at the first spilled packet that has any
+    size_t head = spillWrite;
+    for (size_t i = 0; i < spilledCount; ++i) {
+        if (entries[i].size > 0) {
+            head = entries[i].spillOffset;
+            break;
+        }
+    }
+
+    if (spillWrite > head) {
+        // Data in [head, spillWrite): append, or wrap to the start
+        if (spillWrite + bytes <= spillCapacity) {
+            offset = spillWrite;
+        } else if (bytes < head) {
+            offset = 0;
+        } else {
+            return false;
+        }
+    } else if (spillWrite + bytes < head) {
+        // Wrapped: the free space is [spillWrite, head)
+        offset = spillWrite;
+    } else {
+        return false;
+    }
+    spillWrite = offset + bytes;
+    return true;
+}
+
+bool TimeShiftBuffer::openSpillFile() {
+    std::string path = config.spillDirectory + "/v2p-timeshift-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+
+    spillFd = mkstemp(name.data());
+    if (spillFd < 0) {
+        std::cerr << "Time shift: could not create a spill file in " << config.spillDirectory << std::endl;
+        spillFailed = true;
+        return false;
+    }
+    // Only the mapping needs it; the file goes away with the descriptor
+    unlink(name.data());
+
+    if (ftruncate(spillFd, static_cast<off_t>(config.spillBytes)) != 0) {
+        std::cerr << "Time shift: could not size the spill file to " << config.spillBytes << " bytes." << std::endl;
+        closeSpillFile();
+        spillFailed = true;
+        return false;
+    }
+    void* map = mmap(nullptr, config.spillBytes, PROT_READ | PROT_WRITE, MAP_SHARED, spillFd, 0);
+    if (map == MAP_FAILED) {
+        std::cerr << "Time shift: could not map the spill file." << std::endl;
+        closeSpillFile();
+        spillFailed = true;
+        return false;
+    }
+    spillMap = static_cast<uint8_t*>(map);
+    spillCapacity = config.spillBytes;
+    return true;
+}
+
+void TimeShiftBuffer::closeSpillFile() {
+    if (spillMap) {
+        munmap(spillMap, spillCapacity);
+        spillMap = nullptr;
+    }
+    if (spillFd >= 0) {
+        close(spillFd);
+        spillFd = -1;
+    }
+    spillCapacity = 0;
+}
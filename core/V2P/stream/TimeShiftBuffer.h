@@ -0,0 +1,125 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "V2P/stream/TimeShiftConfig.h"
+
+// Forward-declare FFmpeg types
+struct AVPacket;
+
+/**
+ * @brief Outcome of TimeShiftBuffer::read().
+ */
+enum class TimeShiftRead {
+    PACKET,   // A packet was read
+    WAITING,  // Nothing at the position yet; try again
+    END       // Input finished and fully read, or aborted
+};
+
+/**
+ * @brief A bounded window of a stream's compressed packets, indexed by keyframe.
+ *
+ * The demuxer appends every packet it reads; a reader replays them from
+ * any position in the window. Positions are sequence numbers that keep
+ * counting as old packets leave the window. The window always starts at a
+ * video keyframe and is trimmed a whole GOP at a time, by age and, unless
+ * a spill file takes the oldest packet data off the heap, by memory.
+ *
+ * The spill file is a ring in a memory-mapped, already unlinked temporary
+ * file; only packet data and timing go there, side data is dropped.
+ * Thread-safe: one writer and any number of readers.
+ */
+class TimeShiftBuffer {
+public:
+    explicit TimeShiftBuffer(TimeShiftConfig config);
+    ~TimeShiftBuffer();
+
+    TimeShiftBuffer(const TimeShiftBuffer&) = delete;
+    TimeShiftBuffer& operator=(const TimeShiftBuffer&) = delete;
+
+    /**
+     * @brief Writer: adds a new reference to the packet.
+     * @param seconds The packet's stream time.
+     * @param keyframe True for a video keyframe; the window only starts at one.
+     */
+    void append(const AVPacket* packet, double seconds, bool keyframe);
+
+    /**
+     * @brief Writer: no more packets will come. Readers see END past the last one.
+     */
+    void finish();
+
+    /**
+     * @brief Wakes every reader and makes further reads return END.
+     */
+    void abort();
+
+    /**
+     * @brief Reader: the packet at `position`, waiting up to `wait` for it.
+     * A position that has left the window moves to the window's start.
+     * @param position [in/out] Advanced past the packet read.
+     * @param outPacket [out] Receives a new packet owned by the caller.
+     */
+    TimeShiftRead read(uint64_t& position, AVPacket** outPacket, std::chrono::milliseconds wait);
+
+    /**
+     * @brief The position of the last keyframe at or before `seconds`;
+     * the window's start if there is none, the latest keyframe past its end.
+     */
+    uint64_t keyframeAtOrBefore(double seconds) const;
+
+    /**
+     * @brief The stream time of a position, clamped to the window.
+     */
+    double secondsAt(uint64_t position) const;
+
+    /**
+     * @brief The window and its memory use; `position` is left to the caller.
+     */
+    TimeShiftRange getRange() const;
+
+private:
+    struct Entry {
+        AVPacket* packet = nullptr; // Null once spilled
+        size_t spillOffset = 0;
+        int size = 0;
+        int64_t pts = 0;
+        int64_t dts = 0;
+        int64_t duration = 0;
+        int streamIndex = 0;
+        int flags = 0;
+        double seconds = 0.0;
+        bool keyframe = false;
+    };
+
+    // All with mutex held
+    bool dropOldestGop();
+    bool spillOldest();
+    bool allocateSpill(int size, size_t& offset);
+    bool openSpillFile();
+    void closeSpillFile();
+
+    TimeShiftConfig config;
+    mutable std::mutex mutex;
+    std::condition_variable appended;
+    std::deque<Entry> entries;
+    std::deque<uint64_t> keyframes; // Positions of the video keyframes in the window
+    uint64_t firstPosition = 0;     // Position of entries.front()
+    size_t spilledCount = 0;        // Entries at the front that live in the spill file
+    size_t memoryBytes = 0;
+    size_t spillBytesUsed = 0;
+    bool finished = false;
+    bool aborted = false;
+
+    // Spill ring
+    int spillFd = -1;
+    uint8_t* spillMap = nullptr;
+    size_t spillCapacity = 0;
+    size_t spillWrite = 0;  // Where the next spilled packet goes
+    bool spillFailed = false;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief The time-shift (DVR) buffer of a live stream. Applied when the stream is opened.
+ */
+struct TimeShiftConfig {
+    // Keep the compressed stream behind the live edge, so that playback can
+    // pause, rewind and return to live without touching the network
+    bool enabled = false;
+
+    double maxSeconds = 300.0; // Window behind the live edge, rounded to whole GOPs
+
+    // Packet data kept in RAM. Beyond it the oldest packets move to a spill
+    // file mapped into memory, if a directory is given; otherwise, and once
+    // the spill file is full too, the oldest GOPs are dropped.
+    size_t memoryBytes = 256 * 1024 * 1024;
+    std::string spillDirectory;
+    size_t spillBytes = 2048ull * 1024 * 1024;
+};
+
+/**
+ * @brief What a time-shift buffer holds and where playback is in it, in stream seconds.
+ */
+struct TimeShiftRange {
+    bool available = false;  // False without a time-shift buffer
+    double start = 0.0;      // Oldest position a seek can reach (a keyframe)
+    double end = 0.0;        // Live edge: the newest packet received
+    double position = 0.0;   // The newest packet handed to the decoders
+    size_t packets = 0;
+    size_t memoryBytes = 0;  // Packet data in RAM
+    size_t spillBytes = 0;   // Packet data in the spill file
+};
@@ -0,0 +1,140 @@
+#include "VideoFrame.h"
+#include "FrameShellPool.h"
+
+#include <utility>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+}
+
+namespace {
+    PixelFormat toPixelFormat(int avFormat) {
+        switch (avFormat) {
+            case AV_PIX_FMT_YUV420P: return PixelFormat::IYUV;
+            case AV_PIX_FMT_NV12:    return PixelFormat::NV12;
+            default:                 return PixelFormat::RGBA;
+        }
+    }
+}
+
+void VideoFrame::describe(double frameTimestamp) {
+    for (int i = 0; i < 4; ++i) {
+        planes[i] = avFrame->data[i];
+        strides[i] = avFrame->linesize[i];
+    }
+    width = avFrame->width;
+    height = avFrame->height;
+    format = toPixelFormat(avFrame->format);
+    timestamp = frameTimestamp;
+}
+
+VideoFrame::~VideoFrame() {
+    reset();
+}
+
+VideoFrame::VideoFrame(VideoFrame&& other) noexcept {
+    *this = std::move(other);
+}
+
+VideoFrame& VideoFrame::operator=(VideoFrame&& other) noexcept {
+    if (this != &other) {
+        reset();
+
+        avFrame = std::exchange(other.avFrame, nullptr);
+        for (int i = 0; i < 4; ++i) {
+            planes[i] = std::exchange(other.planes[i], nullptr);
+            strides[i] = std::exchange(other.strides[i], 0);
+        }
+        width = std::exchange(other.width, 0);
+        height = std::exchange(other.height, 0);
+        format = std::exchange(other.format, PixelFormat::RGBA);
+        timestamp = std::exchange(other.timestamp, 0.0);
+        queuedAtNs = std::exchange(other.queuedAtNs, 0);
+        traceId = std::exchange(other.traceId, 0);
+        timeline = std::exchange(other.timeline, 0);
+        discontinuity = std::exchange(other.discontinuity, false);
+    }
+    return *this;
+}
+
+VideoFrame VideoFrame::wrap(const AVFrame* source, double timestamp) {
+    VideoFrame frame;
+    if (!source) {
+        return frame;
+    }
+
+    frame.avFrame = FrameShellPool::global().acquire();
+    if (!frame.avFrame) {
+        return frame;
+    }
+
+    // Takes a new reference on the source buffers; no pixels are copied
+    if (av_frame_ref(frame.avFrame, source) < 0) {
+        FrameShellPool::global().release(frame.avFrame);
+        frame.avFrame = nullptr;
+        return frame;
+    }
+
+    frame.describe(timestamp);
+    return frame;
+}
+
+VideoFrame VideoFrame::take(AVFrame* source, double timestamp) {
+    VideoFrame frame;
+    if (!source) {
+        return frame;
+    }
+
+    frame.avFrame = FrameShellPool::global().acquire();
+    if (!frame.avFrame) {
+        av_frame_unref(source);
+        return frame;
+    }
+
+    av_frame_move_ref(frame.avFrame, source);
+    frame.describe(timestamp);
+    return frame;
+}
+
+VideoFrame VideoFrame::ref() const {
+    VideoFrame frame = wrap(avFrame, timestamp);
+    frame.traceId = traceId;
+    frame.timeline = timeline;
+    frame.discontinuity = discontinuity;
+    return frame;
+}
+
+bool VideoFrame::copyTo(std::vector<uint8_t>& out) const {
+    if (!avFrame) {
+        return false;
+    }
+
+    const auto format = static_cast<AVPixelFormat>(avFrame->format);
+    int size = av_image_get_buffer_size(format, width, height, 1);
+    if (size < 0) {
+        return false;
+    }
+
+    out.resize(size);
+    return av_image_copy_to_buffer(out.data(), size, planes, strides, format, width, height, 1) >= 0;
+}
+
+void VideoFrame::reset() {
+    if (avFrame) {
+        FrameShellPool::global().release(avFrame);
+        avFrame = nullptr;
+    }
+    for (int i = 0; i < 4; ++i) {
+        planes[i] = nullptr;
+        strides[i] = 0;
+    }
+    width = 0;
+    height = 0;
+    format = PixelFormat::RGBA;
+    timestamp = 0.0;
+    queuedAtNs = 0;
+    traceId = 0;
+    timeline = 0;
+    discontinuity = false;
+}
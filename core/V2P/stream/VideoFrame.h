@@ -1,22 +1,136 @@
 #pragma once
 
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
+// Forward-declare FFmpeg types
+struct AVFrame;
+
 /**
- * @brief A simple, self-contained struct to hold one decoded video frame.
+ * @brief Pixel layouts a client can render, named after their SDL counterparts.
+ */
+enum class PixelFormat {
+    RGBA,   // Packed 8-bit RGBA
+    IYUV,   // Planar YUV 4:2:0: Y plane, then U, then V
+    NV12    // Y plane, then one interleaved UV plane
+};
+
+/**
+ * @brief One decoded video frame, backed by a reference-counted FFmpeg buffer.
  *
- * This struct owns its own data, making it safe to pass
- * from the engine thread to the UI thread (with a mutex).
- * The engine is expected to convert all video to RGBA for
- * easy rendering by clients like SDL.
+ * The frame holds a reference to the decoder/converter output instead of a
+ * private copy of the pixels, so handing it from the engine thread to the UI
+ * thread only moves a pointer. Frames are move-only; use ref() to share the
+ * same pixels with another consumer, or copyTo() when owned bytes are needed.
+ * The pixel format is one the client accepted (see
+ * IStreamStrategy::setAcceptedFormats); RGBA unless it said otherwise.
  */
 struct VideoFrame {
-    std::vector<uint8_t> data;
+    VideoFrame() = default;
+    ~VideoFrame();
+
+    VideoFrame(VideoFrame&& other) noexcept;
+    VideoFrame& operator=(VideoFrame&& other) noexcept;
+
+    VideoFrame(const VideoFrame&) = delete;
+    VideoFrame& operator=(const VideoFrame&) = delete;
+
+    /**
+     * @brief Creates a frame that references the buffers of an AVFrame.
+     * No pixel data is copied; the source frame can be unreferenced afterwards.
+     * @param source A ref-counted AVFrame (decoder or scaler output) in
+     * one of the formats listed in PixelFormat.
+     * @param timestamp Presentation timestamp in seconds.
+     * @return The new frame, or an empty frame if referencing failed.
+     */
+    static VideoFrame wrap(const AVFrame* source, double timestamp);
+
+    /**
+     * @brief Creates a frame that takes over the buffers of an AVFrame,
+     * which is left unreferenced and can be reused at once. Neither the
+     * frame struct (see FrameShellPool) nor a buffer reference is
+     * allocated, so this is what the decode loop uses.
+     * @param source A ref-counted AVFrame in one of the formats listed in PixelFormat.
+     * @param timestamp Presentation timestamp in seconds.
+     * @return The new frame, or an empty frame if source is null.
+     */
+    static VideoFrame take(AVFrame* source, double timestamp);
+
+    /**
+     * @brief Creates another frame sharing the same pixel buffers.
+     */
+    VideoFrame ref() const;
+
+    /**
+     * @brief Copies the pixels into a tightly packed, caller-owned buffer.
+     * @param out [out] Resized to the packed image size and filled.
+     * @return True on success, false if the frame is empty.
+     */
+    bool copyTo(std::vector<uint8_t>& out) const;
+
+    /**
+     * @brief Drops the reference to the pixel buffers; the AVFrame itself
+     * goes back to the FrameShellPool.
+     */
+    void reset();
+
+    bool empty() const { return avFrame == nullptr; }
+
+    /**
+     * @brief The underlying AVFrame, for consumers that talk to FFmpeg directly.
+     */
+    const AVFrame* getAVFrame() const { return avFrame; }
+
+    // Plane pointers and strides, valid for as long as this frame is alive
+    uint8_t* planes[4] = {};
+    int strides[4] = {};
 
     int width = 0;
     int height = 0;
+    PixelFormat format = PixelFormat::RGBA;
 
     // Presentation timestamp in seconds
     double timestamp = 0.0;
+
+    // When the frame was handed to the client queue (StreamMetrics::now()), or 0
+    int64_t queuedAtNs = 0;
+
+    // Ties the frame's spans together in a trace (see Tracer::frameId), or 0
+    uint64_t traceId = 0;
+
+    // The VideoStreamer timeline it was decoded in; frames from before a seek are dropped by it
+    uint32_t timeline = 0;
+
+    // First frame after an HLS discontinuity: its timestamp need not follow on from the last
+    bool discontinuity = false;
+
+private:
+    // Fills the plane pointers and the description from avFrame
+    void describe(double frameTimestamp);
+
+    AVFrame* avFrame = nullptr;
+};
+
+/**
+ * @brief Frames a decoder had ready at once, in presentation order. The
+ * slots are reused from one batch to the next, so batching never allocates.
+ */
+struct VideoFrameBatch {
+    static constexpr size_t CAPACITY = 16;
+
+    VideoFrame frames[CAPACITY];
+    size_t count = 0;
+
+    bool empty() const { return count == 0; }
+    bool full() const { return count == CAPACITY; }
+
+    /**
+     * @brief Drops the frames still in the batch.
+     */
+    void clear() {
+        for (size_t i = 0; i < count; ++i)
+            frames[i].reset();
+        count = 0;
+    }
 };
@@ -2,7 +2,7 @@
 #include "M3U8StreamStrategy.h"
 #include <iostream>
 
-std::unique_ptr<VideoStreamer> VideoStreamFactory::createVideoStreamer(const std::string& url)
+std::unique_ptr<VideoStreamer> VideoStreamFactory::createVideoStreamer(const std::string& url, const StreamOptions& options)
 {
     std::unique_ptr <VideoStreamer> streamer = nullptr;
 
@@ -16,8 +16,22 @@ std::unique_ptr<VideoStreamer> VideoStreamFactory::createVideoStreamer(const std
 
     if (streamer != nullptr)
     {
+        streamer->setAcceptedFormats(options.acceptedFormats);
+        streamer->setDecoderConfig(options.decoder);
+        streamer->setPrefetchConfig(options.prefetch);
+        streamer->setDisplaySize(options.displayWidth, options.displayHeight);
+        streamer->setOutputSize(options.outputWidth, options.outputHeight);
+        streamer->setStartupConfig(options.startup);
+        streamer->setTimeShiftConfig(options.timeShift);
+        streamer->setSeekConfig(options.seek);
+        streamer->setExternalScheduling(options.externalScheduling);
+
         std::cout << "Opening stream with URL: " << url << std::endl;
-        streamer->open(url);
+        if (options.startup.asyncOpen) {
+            streamer->openAsync(url);
+        } else {
+            streamer->open(url);
+        }
         return streamer;
     }
     return nullptr; // Unsupported URL
@@ -1,8 +1,9 @@
 #pragma once
 #include "VideoStreamer.h"
+#include "StreamOptions.h"
 
 class VideoStreamFactory
 {
 public:
-    static std::unique_ptr<VideoStreamer> createVideoStreamer(const std::string& url);
+    static std::unique_ptr<VideoStreamer> createVideoStreamer(const std::string& url, const StreamOptions& options = {});
 };
\ No newline at end of file
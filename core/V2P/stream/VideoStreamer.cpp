@@ -1,19 +1,42 @@
 #include "VideoStreamer.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <V2P/metrics/MetricsRegistry.h>
+#include <V2P/metrics/Tracer.h>
 // No need to include AVFrame here anymore
 
 VideoStreamer::VideoStreamer(std::unique_ptr<IStreamStrategy> strategy)
     : streamStrategy(std::move(strategy)),
-      isRunning(false) {}
+      isRunning(false) {
+    // close() stops the strategy before the queue goes away
+    if (streamStrategy) {
+        streamStrategy->setFrameQueueProbe([this]() { return videoQueue.size(); });
+    }
+}
 
 VideoStreamer::~VideoStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(openMutex);
+        closing = true;
+    }
     isRunning = false;
-    thread.join();
+    videoQueue.stop(); // Wakes run() if it is waiting for room
+    if (streamStrategy) {
+        streamStrategy->interrupt(); // ...or waiting for packets, or opening
+    }
+    if (openThread.joinable()) {
+        openThread.join();
+    }
+    if (thread.joinable()) {
+        thread.join();
+    }
     close();
 }
 
 bool VideoStreamer::open(const std::string& url) {
     if (streamStrategy) {
+        streamStrategy->getMetrics()->markStartup(StartupMilestone::OPEN_REQUESTED);
         if(!streamStrategy->open(url)){
             std::cerr << "Failed to open stream with URL: " << url << std::endl;
             return false;
@@ -21,21 +44,61 @@ bool VideoStreamer::open(const std::string& url) {
         }
         streamStrategy->enableAudio();
 
+        // Dashboards find the stream by its URL
+        streamStrategy->getMetrics()->setName(url);
+        MetricsRegistry::global().add(streamStrategy->getMetrics());
+
+        std::lock_guard<std::mutex> lock(openMutex);
+        if (closing) {
+            return false; // Destroyed while opening; the destructor closes the strategy
+        }
+        if (audioOutputLatency >= 0.0) {
+            streamStrategy->setAudioOutputLatency(audioOutputLatency);
+        }
+        if (standby && !streamStrategy->setStandby(true)) {
+            standby = false;
+        }
+        if (pendingRecording) {
+            streamStrategy->startRecording(*pendingRecording);
+            pendingRecording.reset();
+        }
+        isOpen = true;
         isRunning = true;
-        thread = std::thread(&VideoStreamer::run, this); // Spawns the new thread
+        if (!externalScheduling) {
+            thread = std::thread(&VideoStreamer::run, this); // Spawns the new thread
+        }
+        return true;
     }
     return false;
 }
 
+void VideoStreamer::openAsync(const std::string& url) {
+    if (!streamStrategy || opening || openThread.joinable())
+        return;
+
+    // Counted from here, not from when the thread gets going
+    streamStrategy->getMetrics()->markStartup(StartupMilestone::OPEN_REQUESTED);
+    opening = true;
+    openThread = std::thread([this, url]() {
+        Tracer::setThreadName("stream open");
+        open(url);
+        opening = false;
+    });
+}
+
 void VideoStreamer::run() {
     if (!streamStrategy) return;
+    Tracer::setThreadName("video decode");
 
+    // Every push empties the batch, so one instance serves the whole loop
+    VideoFrameBatch batch;
     while (isRunning) {
-        VideoFrame frame;
-        PacketType packetType = streamStrategy->processNextFrame(frame);
+        // Read before decoding: a seek from here on makes the frames stale
+        const uint32_t decodedTimeline = timeline.load(std::memory_order_acquire);
+        PacketType packetType = streamStrategy->processNextFrames(batch, true);
 
         if (packetType == PacketType::VIDEO) {
-            videoQueue.push(frame);
+            pushFrames(batch, true, decodedTimeline);
         }
         else if (packetType == PacketType::ERROR) {
             isRunning = false;
@@ -43,13 +106,115 @@ void VideoStreamer::run() {
     }
 }
 
+DecodeStepResult VideoStreamer::decodeStep() {
+    if (opening) return DecodeStepResult::IDLE;
+    if (!streamStrategy || !isRunning) return DecodeStepResult::ENDED;
+
+    // Frames decoded while the queue was full go first, unless a seek came in between
+    uint32_t current = timeline.load(std::memory_order_acquire);
+    if (current != producedTimeline) {
+        producedTimeline = current;
+        pendingFrames.clear();
+    }
+    if (!pendingFrames.empty()) {
+        return pushFrames(pendingFrames, false, producedTimeline) > 0 ? DecodeStepResult::FRAME : DecodeStepResult::BLOCKED;
+    }
+
+    switch (streamStrategy->processNextFrames(pendingFrames, false)) {
+        case PacketType::VIDEO:
+            return pushFrames(pendingFrames, false, current) > 0 ? DecodeStepResult::FRAME : DecodeStepResult::BLOCKED;
+        case PacketType::ERROR:
+            isRunning = false;
+            return DecodeStepResult::ENDED;
+        default:
+            return DecodeStepResult::IDLE;
+    }
+}
+
+size_t VideoStreamer::pushFrames(VideoFrameBatch& batch, bool wait, uint32_t decodedTimeline) {
+    if (batch.empty())
+        return 0;
+
+    int64_t queueStart = StreamMetrics::now();
+    double timestamps[VideoFrameBatch::CAPACITY];
+    size_t pushed = 0;
+    {
+        // A long span here is back-pressure: the client is not taking frames
+        TraceScope trace("frame queue push");
+        for (size_t i = 0; i < batch.count; ++i) {
+            VideoFrame& frame = batch.frames[i];
+            frame.queuedAtNs = queueStart; // Residency is measured when the client pops it
+            frame.timeline = decodedTimeline;
+            timestamps[i] = frame.timestamp;
+            trace.flow(TraceFlow::STEP, frame.traceId);
+        }
+
+        // One queue update for whatever fits; waiting, the rest follows as room frees up
+        pushed = videoQueue.tryPushBatch(batch.frames, batch.count);
+        while (wait && pushed < batch.count && videoQueue.push(std::move(batch.frames[pushed]))) {
+            pushed++;
+        }
+    }
+
+    // Frames not taken move to the front, for the next call
+    for (size_t i = pushed; i < batch.count; ++i) {
+        batch.frames[i - pushed] = std::move(batch.frames[i]);
+    }
+    batch.count -= pushed;
+    if (pushed == 0)
+        return 0;
+
+    framesQueued.fetch_add(pushed, std::memory_order_relaxed);
+    totalQueueNs.fetch_add(StreamMetrics::now() - queueStart, std::memory_order_relaxed);
+
+    // Smoothed pts delta; ignores discontinuities and the first frame
+    for (size_t i = 0; i < pushed; ++i) {
+        double previous = lastPushedTimestamp.exchange(timestamps[i], std::memory_order_relaxed);
+        double delta = timestamps[i] - previous;
+        if (previous > 0.0 && delta > 0.0 && delta < 1.0) {
+            double interval = frameInterval.load(std::memory_order_relaxed);
+            frameInterval.store(interval + (delta - interval) * 0.1, std::memory_order_relaxed);
+        }
+    }
+    return pushed;
+}
+
+double VideoStreamer::getDecodeDeadline(double now) const {
+    double interval = frameInterval.load(std::memory_order_relaxed);
+
+    // With a playback clock, the next frame is due when the clock reaches its pts
+    double clock = getClock();
+    double lastPts = lastPushedTimestamp.load(std::memory_order_relaxed);
+    if (clock > 0.0 && lastPts > 0.0) {
+        return now + (lastPts + interval - clock);
+    }
+
+    // Otherwise the queued frames last one interval each
+    return now + static_cast<double>(videoQueue.size()) * interval;
+}
+
 bool VideoStreamer::getNextVideoFrame(VideoFrame& outFrame)
 {
-    if (streamStrategy) {
-        auto result = videoQueue.tryPop(outFrame);
-        return true;
+    if (!streamStrategy)
+        return false;
+
+    // A frame decoded before a seek can still be pushed after it emptied the queue
+    const uint32_t current = timeline.load(std::memory_order_acquire);
+    while (videoQueue.tryPop(outFrame)) {
+        if (outFrame.timeline == current) {
+            recordResidency(outFrame);
+            return true;
+        }
+        outFrame.reset();
+    }
+    return false;
+}
+
+void VideoStreamer::recordResidency(const VideoFrame& frame) const
+{
+    if (frame.queuedAtNs > 0) {
+        streamStrategy->getMetrics()->record(MetricStage::QUEUE_RESIDENCY, StreamMetrics::now() - frame.queuedAtNs);
     }
-    return true;
 }
 
 bool VideoStreamer::updateFrame(VideoFrame& outFrame, uint32_t bufferedBytes, int bytesPerSecond)
@@ -58,7 +223,7 @@ bool VideoStreamer::updateFrame(VideoFrame& outFrame, uint32_t bufferedBytes, in
         return false;
 
     // Try to get a video frame
-    if (!videoQueue.tryPop(outFrame))
+    if (!getNextVideoFrame(outFrame))
         return false;
 
     // --- Timing & Synchronization ---
@@ -67,48 +232,174 @@ bool VideoStreamer::updateFrame(VideoFrame& outFrame, uint32_t bufferedBytes, in
         return false;
 
     double audioClock = streamStrategy->getClock();
-    double bufferedSeconds = static_cast<double>(bufferedBytes) / static_cast<double>(bytesPerSecond);
+    // Only push-mode clients have audio queued beyond the engine's clock
+    double bufferedSeconds = bytesPerSecond > 0
+        ? static_cast<double>(bufferedBytes) / static_cast<double>(bytesPerSecond)
+        : 0.0;
 
     double actualAudioTime = audioClock - bufferedSeconds;
     double delay = videoTimestamp - actualAudioTime;
 
-    // --- Sync thresholds ---
-    constexpr double SMALL_EARLY_THRESHOLD = 0.010;
-    constexpr double DROP_LATE_THRESHOLD   = -0.050;
-    constexpr double MAX_WAIT_MS           = 50.0;
-
-    // Debug info (optional)
-    std::cout << "Video TS: " << videoTimestamp
-              << " | Audio TS: " << actualAudioTime
-              << " | Delay: " << delay << " seconds." << std::endl;
-
-    // --- Sync logic ---
-    if (delay > SMALL_EARLY_THRESHOLD) {
-        return true;
-    } else if (delay < DROP_LATE_THRESHOLD) {
-        std::cout << "Dropping late frame.\n";
-        return true;
-    }
+    // How far off the clock the frame is; the caller decides whether to wait or drop
+    streamStrategy->getMetrics()->record(MetricStage::SYNC_DELAY,
+                                         static_cast<int64_t>(std::abs(delay) * 1e9));
 
     return true; // frame ready for rendering
 }
 
 double VideoStreamer::getClock() const
 {
-    if (streamStrategy) {
+    if (streamStrategy && isOpen) {
         return streamStrategy->getClock();
     }
     return 0.0;
 }
 
+FramePoolStats VideoStreamer::getFramePoolStats() const
+{
+    if (streamStrategy && isOpen) {
+        return streamStrategy->getFramePoolStats();
+    }
+    return {};
+}
+
+PacketPoolStats VideoStreamer::getPacketPoolStats() const
+{
+    if (streamStrategy && isOpen) {
+        return streamStrategy->getPacketPoolStats();
+    }
+    return {};
+}
+
+DecodeStats VideoStreamer::getDecodeStats() const
+{
+    DecodeStats stats;
+    if (streamStrategy && isOpen) {
+        stats = streamStrategy->getDecodeStats();
+    }
+    stats.framesQueued = framesQueued.load(std::memory_order_relaxed);
+    stats.totalQueueMs = static_cast<double>(totalQueueNs.load(std::memory_order_relaxed)) / 1e6;
+    return stats;
+}
+
+QueueDepths VideoStreamer::getQueueDepths() const
+{
+    QueueDepths depths;
+    if (streamStrategy && isOpen) {
+        depths = streamStrategy->getQueueDepths();
+    }
+    depths.videoFrames = videoQueue.size();
+    return depths;
+}
+
 void VideoStreamer::close()
 {
     std::cout << "Closing VideoStreamer..." << std::endl;
+
+    // An open still in progress is abandoned first
+    if (openThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(openMutex);
+            closing = true;
+        }
+        if (streamStrategy) {
+            streamStrategy->interrupt();
+        }
+        openThread.join();
+    }
+
     if (streamStrategy) {
         streamStrategy->close();
     }
 
     isOpen = false;
+    isRunning = false;
+}
+
+bool VideoStreamer::setStandby(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(openMutex);
+    if (!streamStrategy)
+        return false;
+    if (!isOpen) {
+        // An open in progress applies it once the strategy is ready
+        standby = enabled && opening;
+        return standby == enabled;
+    }
+    if (standby == enabled)
+        return true;
+
+    // Frames from before the standby must not show ahead of the held keyframe.
+    // Coming back, they go before the strategy starts feeding the decoder.
+    if (!enabled) {
+        dropQueuedFrames();
+    }
+    if (!streamStrategy->setStandby(enabled))
+        return false;
+    if (enabled) {
+        dropQueuedFrames();
+    }
+    standby = enabled;
+    return true;
+}
+
+bool VideoStreamer::startRecording(const RecorderConfig& config)
+{
+    std::lock_guard<std::mutex> lock(openMutex);
+    if (!streamStrategy)
+        return false;
+    if (!isOpen) {
+        // An open in progress starts it once the strategy is ready
+        if (!opening)
+            return false;
+        pendingRecording = config;
+        return true;
+    }
+    return streamStrategy->startRecording(config);
+}
+
+void VideoStreamer::stopRecording()
+{
+    std::lock_guard<std::mutex> lock(openMutex);
+    pendingRecording.reset();
+    if (streamStrategy && isOpen) {
+        streamStrategy->stopRecording();
+    }
+}
+
+bool VideoStreamer::seek(double seconds, SeekMode mode)
+{
+    // Decoding that has ended does not start again
+    if (!streamStrategy || !isOpen || !isRunning || !streamStrategy->seek(seconds, mode))
+        return false;
+
+    // Only the queue: a frame the decoder is still pushing may follow, but
+    // it carries the old timeline and getNextVideoFrame() drops it
+    VideoFrame stale;
+    while (videoQueue.tryPop(stale)) {
+        stale.reset();
+    }
+    lastPushedTimestamp.store(0.0, std::memory_order_relaxed);
+    timeline.fetch_add(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void VideoStreamer::setPaused(bool pause)
+{
+    if (!streamStrategy || paused == pause)
+        return;
+    streamStrategy->setPaused(pause);
+    paused = pause;
+}
+
+void VideoStreamer::dropQueuedFrames()
+{
+    VideoFrame stale;
+    while (videoQueue.tryPop(stale)) {
+        stale.reset(); // Hands the buffer back to the pool
+    }
+    pendingFrames.clear();
+    lastPushedTimestamp.store(0.0, std::memory_order_relaxed);
 }
 
 void VideoStreamer::setAudioCallback(AudioCallback callback) const
@@ -117,3 +408,22 @@ void VideoStreamer::setAudioCallback(AudioCallback callback) const
         streamStrategy->setAudioCallback(std::move(callback));
     }
 }
+
+int VideoStreamer::readAudio(uint8_t* out, int size) const
+{
+    if (streamStrategy && isOpen) {
+        return streamStrategy->readAudio(out, size);
+    }
+    std::fill(out, out + size, uint8_t(0));
+    return 0;
+}
+
+void VideoStreamer::setAudioOutputLatency(double seconds)
+{
+    // An open in progress applies it once the strategy is ready
+    std::lock_guard<std::mutex> lock(openMutex);
+    audioOutputLatency = seconds;
+    if (streamStrategy && isOpen) {
+        streamStrategy->setAudioOutputLatency(seconds);
+    }
+}
@@ -3,9 +3,24 @@
 #include <string>
 #include <memory>
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <limits>
 
 #include "IStreamStrategy.h"
 #include "VideoFrame.h"
+#include "V2P/utils/SpscRingBuffer.h"
+
+/**
+ * @brief Outcome of one VideoStreamer::decodeStep().
+ */
+enum class DecodeStepResult {
+    FRAME,    // A frame was decoded and queued for the client
+    IDLE,     // No compressed input was ready
+    BLOCKED,  // The client's frame queue is full
+    ENDED     // End of stream or error; no further steps are needed
+};
 
 /**
  * @brief The main context class that the client interacts with.
@@ -19,27 +34,203 @@ public:
 
     bool open(const std::string& url);
 
+    /**
+     * @brief Runs open() on a background thread and returns at once.
+     * Until it has finished, hasEnded() is false and no frames arrive; a
+     * failed open ends the stream.
+     */
+    void openAsync(const std::string& url);
+
+    // True while an openAsync() is in progress
+    bool isOpening() const { return opening; }
+
+    /**
+     * @brief Hands decoding over to an external scheduler. Must be called before open().
+     * No decode thread is spawned; the owner calls decodeStep() instead.
+     */
+    void setExternalScheduling(bool enabled) { externalScheduling = enabled; }
+    bool isExternallyScheduled() const { return externalScheduling; }
+
+    /**
+     * @brief Decodes at most one batch of frames without blocking, for
+     * externally scheduled streams: whatever the decoder had ready.
+     * Any thread may call it, but never two at once.
+     */
+    DecodeStepResult decodeStep();
+
+    /**
+     * @brief True once decoding has stopped (end of stream, error or close()), or before open().
+     * Frames already queued can still be read.
+     */
+    bool hasEnded() const { return !isRunning && !opening; }
+
+    /**
+     * @brief When the stream needs its next decoded frame, on the monotonic
+     * clock of PresentationScheduler::monotonicNow().
+     * @param now The current monotonic time in seconds.
+     */
+    double getDecodeDeadline(double now) const;
+
+    /**
+     * @brief Average time between decoded frames in seconds (1/30 until measured).
+     */
+    double getFrameInterval() const { return frameInterval.load(std::memory_order_relaxed); }
+
     bool getNextVideoFrame(VideoFrame& outFrame);
 
     bool updateFrame(VideoFrame& outFrame, uint32_t bufferedBytes, int bytesPerSecond);
 
     double getClock() const;
 
+    FramePoolStats getFramePoolStats() const;
+    PacketPoolStats getPacketPoolStats() const;
+
+    /**
+     * @brief The stream's latency histograms and counters; the client adds
+     * its own stages (sync, upload, present) here.
+     */
+    StreamMetrics* getMetrics() const { return streamStrategy ? streamStrategy->getMetrics().get() : nullptr; }
+
+    DecodeStats getDecodeStats() const;
+
+    // Depth of every queue in the pipeline, including decoded frames
+    QueueDepths getQueueDepths() const;
+
+    PrefetchStats getPrefetchStats() const {
+        return streamStrategy && isOpen ? streamStrategy->getPrefetchStats() : PrefetchStats{};
+    }
+
     void setAudioCallback(AudioCallback callback) const;
 
+    // Pull-mode audio, see IStreamStrategy::readAudio()
+    int readAudio(uint8_t* out, int size) const;
+    void setAudioOutputLatency(double seconds);
+
+    /**
+     * @brief Puts the stream on warm standby or brings it back, see
+     * IStreamStrategy::setStandby(). Decoded frames still queued are dropped.
+     * Call from the thread that reads the frames; an externally scheduled
+     * stream must be out of its scheduler while this runs. During an
+     * openAsync() the request is applied once the open completes.
+     * @return False if the stream cannot stand by (it then keeps playing).
+     */
+    bool setStandby(bool enabled);
+    bool isStandby() const { return standby; }
+
+    /**
+     * @brief Copies the compressed stream into files, see
+     * IStreamStrategy::startRecording(). During an openAsync() the
+     * recording starts once the open completes.
+     */
+    bool startRecording(const RecorderConfig& config);
+    void stopRecording();
+    RecorderStats getRecorderStats() const {
+        return streamStrategy && isOpen ? streamStrategy->getRecorderStats() : RecorderStats{};
+    }
+
+    /**
+     * @brief Moves playback to a stream time, see IStreamStrategy::seek().
+     * Decoded frames still queued are dropped and getTimeline() changes, so
+     * that the presentation re-anchors on the next frame. Call from the
+     * thread that reads the frames, on an open stream whose decoding has
+     * not ended.
+     */
+    bool seek(double seconds, SeekMode mode = SeekMode::KEYFRAME);
+    bool seekToLive() { return seek(std::numeric_limits<double>::infinity()); }
+
+    SeekStats getSeekStats() const {
+        return streamStrategy && isOpen ? streamStrategy->getSeekStats() : SeekStats{};
+    }
+
+    /**
+     * @brief Pauses or resumes, see IStreamStrategy::setPaused(). The
+     * presentation holds the current frame meanwhile.
+     */
+    void setPaused(bool pause);
+    bool isPaused() const { return paused; }
+
+    // Changes on every seek: the next frame does not follow on from the last one shown
+    uint32_t getTimeline() const { return timeline.load(std::memory_order_acquire); }
+
+    TimeShiftRange getTimeShiftRange() const {
+        return streamStrategy && isOpen ? streamStrategy->getTimeShiftRange() : TimeShiftRange{};
+    }
+
+    // Where the client draws the stream, see IStreamStrategy::setDisplaySize()
+    void setDisplaySize(int width, int height) const {
+        if (streamStrategy)
+            streamStrategy->setDisplaySize(width, height);
+    }
+
+    // Size of the frames handed out, see IStreamStrategy::setOutputSize()
+    void setOutputSize(int width, int height) const {
+        if (streamStrategy)
+            streamStrategy->setOutputSize(width, height);
+    }
+
+    // See IStreamStrategy::setInputCallback()
+    bool setInputCallback(std::function<void()> callback) const {
+        return streamStrategy && streamStrategy->setInputCallback(std::move(callback));
+    }
+
+    // See IStreamStrategy::setDecoderThreadCount()
+    void setDecoderThreadCount(int threads) const {
+        if (streamStrategy)
+            streamStrategy->setDecoderThreadCount(threads);
+    }
+
 
     void close();
 
     void enableAudio() { streamStrategy->enableAudio(); }
     void disableAudio() { streamStrategy->disableAudio(); }
 
+    // Must be called before open()
+    void setAcceptedFormats(std::vector<PixelFormat> formats) { streamStrategy->setAcceptedFormats(std::move(formats)); }
+    void setDecoderConfig(DecoderConfig config) { streamStrategy->setDecoderConfig(std::move(config)); }
+    void setPrefetchConfig(PrefetchConfig config) { streamStrategy->setPrefetchConfig(config); }
+    void setTimeShiftConfig(TimeShiftConfig config) { streamStrategy->setTimeShiftConfig(std::move(config)); }
+    void setSeekConfig(SeekConfig config) { streamStrategy->setSeekConfig(std::move(config)); }
+    void setStartupConfig(StartupConfig config) {
+        startupConfig = config;
+        streamStrategy->setStartupConfig(config);
+    }
+
+    const StartupConfig& getStartupConfig() const { return startupConfig; }
+
 private:
     std::unique_ptr<IStreamStrategy> streamStrategy;
 
     void run(); // worker thread function
-    bool isOpen = false;
+    size_t pushFrames(VideoFrameBatch& batch, bool wait, uint32_t decodedTimeline);
+    void recordResidency(const VideoFrame& frame) const;
+    void dropQueuedFrames();
+    bool externalScheduling = false;
+    StartupConfig startupConfig;
+
+    // The strategy is only touched from other threads once isOpen is set
+    std::atomic<bool> isOpen{false};
+    std::atomic<bool> opening{false};
+    std::atomic<bool> closing{false};  // Set under openMutex; a finishing open then starts nothing
+    std::atomic<bool> standby{false};  // Set under openMutex
+    std::mutex openMutex;
+    double audioOutputLatency = -1.0;  // Applied when the open completes; -1 if never set
+    std::optional<RecorderConfig> pendingRecording; // Started when the open completes
+    std::atomic<bool> paused{false};
+    std::atomic<uint32_t> timeline{0};
+    uint32_t producedTimeline = 0; // decodeStep() only: the timeline pendingFrames were decoded in
+    std::thread openThread;
+
+    SpscRingBuffer<VideoFrame> videoQueue{30}; // The bridge: run() or decodeStep() produces, the UI thread consumes
+    VideoFrameBatch pendingFrames;             // Decoded by decodeStep(), not yet taken by the queue
+
+    // Timing of the produced frames, for deadline scheduling
+    std::atomic<double> lastPushedTimestamp{0.0};
+    std::atomic<double> frameInterval{1.0 / 30.0};
 
-    ThreadSafeFrameQueue videoQueue; // The bridge
+    // Queue stage timings
+    std::atomic<uint64_t> framesQueued{0};
+    std::atomic<int64_t> totalQueueNs{0};
     std::thread thread;
     std::atomic<bool> isRunning;
     std::atomic<double> audioClock;
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "V2P/utils/PlaybackClock.h"
+
+/**
+ * @brief A lock-free single-producer/single-consumer ring of interleaved PCM,
+ * drained by the audio device in pull mode.
+ *
+ * The decoder writes samples together with the pts of their first sample;
+ * the device callback reads whatever it needs, pads underruns with silence
+ * and publishes the position of what it just took to a PlaybackClock.
+ * read() never blocks, locks or allocates, so it is safe to call from a
+ * real-time audio callback.
+ */
+class AudioRingBuffer {
+public:
+    /**
+     * @param capacityBytes Ring size; rounded up to a power of two.
+     * @param bytesPerFrame Bytes per sample frame (all channels).
+     * @param sampleRate Sample frames per second.
+     */
+    AudioRingBuffer(size_t capacityBytes, int bytesPerFrame, int sampleRate)
+        : mask(roundUpToPowerOfTwo(capacityBytes) - 1),
+          bytesPerFrame(bytesPerFrame),
+          sampleRate(sampleRate),
+          data(std::make_unique<uint8_t[]>(mask + 1)) {}
+
+    AudioRingBuffer(const AudioRingBuffer&) = delete;
+    AudioRingBuffer& operator=(const AudioRingBuffer&) = delete;
+
+    /**
+     * @brief Producer: copies in as many bytes as fit. Never blocks.
+     * @param pts Stream time of the first sample in seconds, or a negative
+     * value to continue from the previous samples.
+     * @return The number of bytes written.
+     */
+    size_t write(const uint8_t* source, size_t size, double pts) {
+        const uint64_t w = writePos.load(std::memory_order_relaxed);
+        const uint64_t r = readPos.load(std::memory_order_acquire);
+        size = std::min(size, (mask + 1) - static_cast<size_t>(w - r));
+        size -= size % bytesPerFrame;
+        if (size == 0)
+            return 0;
+
+        if (pts >= 0.0)
+            pushMarker(w / bytesPerFrame, pts);
+
+        const size_t offset = static_cast<size_t>(w & mask);
+        const size_t first = std::min(size, (mask + 1) - offset);
+        std::memcpy(data.get() + offset, source, first);
+        std::memcpy(data.get(), source + first, size - first);
+
+        writePos.store(w + size, std::memory_order_release);
+        return size;
+    }
+
+    /**
+     * @brief Consumer: fills the output, padding with silence on underrun,
+     * and publishes the playback position of what was handed out.
+     * @return The number of bytes of real audio (the rest is silence).
+     */
+    size_t read(uint8_t* out, size_t size) {
+        const uint64_t r = readPos.load(std::memory_order_relaxed);
+        const uint64_t w = writePos.load(std::memory_order_acquire);
+        size_t available = std::min(size, static_cast<size_t>(w - r));
+        available -= available % bytesPerFrame;
+
+        if (available > 0) {
+            const size_t offset = static_cast<size_t>(r & mask);
+            const size_t first = std::min(available, (mask + 1) - offset);
+            std::memcpy(out, data.get() + offset, first);
+            std::memcpy(out + first, data.get(), available - first);
+
+            const uint64_t samplePosition = r / bytesPerFrame;
+            double pts = ptsAt(samplePosition);
+            readPos.store(r + available, std::memory_order_release);
+
+            const double period = static_cast<double>(size / bytesPerFrame) / sampleRate;
+            clock.publish(pts, samplePosition, PlaybackClock::monotonicNow(), period);
+        }
+
+        if (available < size)
+            std::memset(out + available, 0, size - available);
+        return available;
+    }
+
+    /**
+     * @brief Consumer: drops everything waiting (e.g. audio from before a
+     * standby) and forgets the playback position.
+     */
+    void discard() {
+        const uint64_t w = writePos.load(std::memory_order_acquire);
+        ptsAt(w / bytesPerFrame); // Retires the markers of the dropped audio
+        readPos.store(w, std::memory_order_release);
+        clock.reset();
+    }
+
+    /**
+     * @brief Bytes waiting to be played.
+     */
+    size_t size() const {
+        return static_cast<size_t>(writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire));
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    const PlaybackClock& getClock() const { return clock; }
+    PlaybackClock& getClock() { return clock; }
+
+private:
+    struct Marker {
+        uint64_t samplePosition = 0;
+        double pts = 0.0;
+    };
+
+    static constexpr size_t MARKER_COUNT = 256;
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value)
+            result <<= 1;
+        return result;
+    }
+
+    // Producer: remembers where a new pts starts. A full marker ring just
+    // drops the marker; the position is then extrapolated from the last one.
+    void pushMarker(uint64_t samplePosition, double pts) {
+        const size_t t = markerTail.load(std::memory_order_relaxed);
+        if (t - markerHead.load(std::memory_order_acquire) >= MARKER_COUNT)
+            return;
+        markers[t % MARKER_COUNT] = { samplePosition, pts };
+        markerTail.store(t + 1, std::memory_order_release);
+    }
+
+    // Consumer: the pts of a sample, from the last marker at or before it
+    double ptsAt(uint64_t samplePosition) {
+        size_t h = markerHead.load(std::memory_order_relaxed);
+        const size_t t = markerTail.load(std::memory_order_acquire);
+        while (h != t && markers[h % MARKER_COUNT].samplePosition <= samplePosition) {
+            currentMarker = markers[h % MARKER_COUNT];
+            ++h;
+        }
+        markerHead.store(h, std::memory_order_release);
+
+        return currentMarker.pts +
+               static_cast<double>(samplePosition - currentMarker.samplePosition) / sampleRate;
+    }
+
+    const size_t mask;
+    const int bytesPerFrame;
+    const int sampleRate;
+    std::unique_ptr<uint8_t[]> data;
+
+    Marker markers[MARKER_COUNT];
+    Marker currentMarker; // Consumer only
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> writePos{0};
+    std::atomic<size_t> markerTail{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> readPos{0};
+    std::atomic<size_t> markerHead{0};
+
+    alignas(CACHE_LINE_SIZE) PlaybackClock clock;
+};
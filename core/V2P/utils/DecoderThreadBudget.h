@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief A pool of decoder threads shared by every stream that draws from it.
+ *
+ * Streams acquire threads when their decoder is opened and release them when
+ * it is closed, so the sum of all decoder threads stays within the machine's
+ * means. A stream always gets at least one thread, even when the budget is
+ * exhausted, because it must be able to decode at all.
+ */
+class DecoderThreadBudget {
+public:
+    /**
+     * @param totalThreads Threads to share; 0 means one per hardware thread.
+     */
+    explicit DecoderThreadBudget(int totalThreads = 0)
+        : totalThreads(resolveTotal(totalThreads)) {}
+
+    /**
+     * @brief Takes up to the requested number of threads from the budget.
+     * @return The number of threads granted (at least 1).
+     */
+    int acquire(int requested) {
+        std::lock_guard<std::mutex> lock(mutex);
+        int available = std::max(1, totalThreads - threadsInUse);
+        int granted = std::clamp(requested, 1, available);
+        threadsInUse += granted;
+        return granted;
+    }
+
+    /**
+     * @brief Trades threads already held for a new request, e.g. when a
+     * decoder is reopened with another share. Never grants more than what
+     * is held plus what is left in the budget.
+     * @return The number of threads now held (at least 1).
+     */
+    int resize(int held, int requested) {
+        std::lock_guard<std::mutex> lock(mutex);
+        int available = std::max(1, totalThreads - threadsInUse + held);
+        int granted = std::clamp(requested, 1, available);
+        threadsInUse = std::max(0, threadsInUse - held + granted);
+        return granted;
+    }
+
+    /**
+     * @brief Returns threads previously granted by acquire() or resize().
+     */
+    void release(int threads) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threadsInUse = std::max(0, threadsInUse - threads);
+    }
+
+    /**
+     * @brief Changes the size of the budget. Threads already granted are kept
+     * until their holders resize or release them.
+     */
+    void setTotal(int threads) {
+        std::lock_guard<std::mutex> lock(mutex);
+        totalThreads = resolveTotal(threads);
+    }
+
+    int getTotal() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return totalThreads;
+    }
+
+    int getInUse() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return threadsInUse;
+    }
+
+private:
+    static int resolveTotal(int threads) {
+        if (threads > 0)
+            return threads;
+        return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+
+    mutable std::mutex mutex;
+    int totalThreads;
+    int threadsInUse = 0;
+};
@@ -5,6 +5,7 @@ public:
     struct SyncDecision {
         bool show = false;
         bool drop = false;
+        bool late = false;      // shown, but noticeably behind the clock
         double waitUntil = 0.0; // absolute timestamp (seconds)
     };
 
@@ -25,6 +26,7 @@ public:
         } else {
             // Frame is on time → show now
             result.show = true;
+            result.late = diff < -EARLY_THRESHOLD;
         }
 
         return result;
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief Escapes a string for use inside a JSON string or a Prometheus
+ * label value: backslashes, quotes and control characters.
+ */
+inline std::string escapeJson(const std::string& value) {
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '\\': result += "\\\\"; break;
+            case '"':  result += "\\\""; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char code[7];
+                    std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned char>(c));
+                    result += code;
+                } else {
+                    result += c;
+                }
+                break;
+        }
+    }
+    return result;
+}
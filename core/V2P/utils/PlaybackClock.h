@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @brief The audio playback position, readable from any thread without locking.
+ *
+ * The audio output publishes a (pts, sample position, monotonic time)
+ * triple every time it pulls samples. Readers extrapolate from the latest
+ * triple with the monotonic clock, which gives a sub-millisecond estimate
+ * of what is audible right now without asking the device how much it has
+ * queued. The triple is published with a sequence lock: the single writer
+ * never waits, and readers retry in the rare case they overlap a write.
+ */
+class PlaybackClock {
+public:
+    struct Snapshot {
+        double pts = 0.0;              // Stream time of the first sample handed to the device
+        uint64_t samplePosition = 0;   // Samples handed to the device before it
+        int64_t timeNs = 0;            // Monotonic time of the hand-over
+        double periodSeconds = 0.0;    // Duration of the audio handed over
+        bool valid = false;
+    };
+
+    /**
+     * @brief Publishes a new position. Only one thread may publish.
+     */
+    void publish(double pts, uint64_t samplePosition, int64_t timeNs, double periodSeconds) {
+        const uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        publishedPts.store(pts, std::memory_order_relaxed);
+        publishedSamplePosition.store(samplePosition, std::memory_order_relaxed);
+        publishedTimeNs.store(timeNs, std::memory_order_relaxed);
+        publishedPeriod.store(periodSeconds, std::memory_order_relaxed);
+
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief Reads the latest published triple.
+     */
+    Snapshot load() const {
+        Snapshot snapshot;
+        uint32_t before, after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            snapshot.pts = publishedPts.load(std::memory_order_relaxed);
+            snapshot.samplePosition = publishedSamplePosition.load(std::memory_order_relaxed);
+            snapshot.timeNs = publishedTimeNs.load(std::memory_order_relaxed);
+            snapshot.periodSeconds = publishedPeriod.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        snapshot.valid = before != 0;
+        return snapshot;
+    }
+
+    /**
+     * @brief The stream time being heard at the given monotonic time, in seconds.
+     * Extrapolation stops after two periods, so the clock stalls with the audio.
+     * @return The position, or a negative value if nothing was played yet.
+     */
+    double positionAt(int64_t timeNs) const {
+        Snapshot snapshot = load();
+        if (!snapshot.valid)
+            return -1.0;
+
+        double elapsed = static_cast<double>(timeNs - snapshot.timeNs) / 1e9;
+        if (elapsed < 0.0)
+            elapsed = 0.0;
+        if (elapsed > 2.0 * snapshot.periodSeconds)
+            elapsed = 2.0 * snapshot.periodSeconds;
+
+        return snapshot.pts + elapsed - outputLatency.load(std::memory_order_relaxed);
+    }
+
+    double position() const { return positionAt(monotonicNow()); }
+
+    /**
+     * @brief Sets how long the device takes to play samples handed to it.
+     */
+    void setOutputLatency(double seconds) { outputLatency.store(seconds, std::memory_order_relaxed); }
+
+    /**
+     * @brief Forgets the published position (e.g. after a seek). Writer only.
+     */
+    void reset() {
+        publish(0.0, 0, 0, 0.0);
+        sequence.store(0, std::memory_order_release);
+    }
+
+    static int64_t monotonicNow() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<double> publishedPts{0.0};
+    std::atomic<uint64_t> publishedSamplePosition{0};
+    std::atomic<int64_t> publishedTimeNs{0};
+    std::atomic<double> publishedPeriod{0.0};
+    std::atomic<double> outputLatency{0.0};
+};
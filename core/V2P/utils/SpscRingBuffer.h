@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief A bounded, wait-free single-producer/single-consumer ring buffer.
+ *
+ * Exactly one thread may call the push functions and exactly one (other)
+ * thread may call the pop functions. tryPush/tryPop never block or lock;
+ * producer and consumer indices live on separate cache lines and each side
+ * keeps a cached copy of the other's index, so the shared lines are only
+ * touched when the cached view says the ring looks full or empty.
+ *
+ * Blocking is optional. When enabled, push() and pop() sleep on an atomic
+ * wait (a futex on Linux) only while the ring is full or empty, and the
+ * other side only issues a wake-up when it knows someone is sleeping.
+ *
+ * Items are moved in and out; a moved-from item must not keep resources
+ * alive (true for VideoFrame, which is empty after a move).
+ */
+template <typename T>
+class SpscRingBuffer {
+public:
+    /**
+     * @param capacity Maximum number of items; rounded up to a power of two.
+     * @param blocking Enables push()/pop(). Costs one fence per operation.
+     */
+    explicit SpscRingBuffer(size_t capacity = 30, bool blocking = true)
+        : mask(roundUpToPowerOfTwo(capacity) - 1),
+          blocking(blocking),
+          slots(std::make_unique<T[]>(mask + 1)) {}
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    /**
+     * @brief Producer: moves an item in if there is room. Never blocks.
+     * @return True if the item was pushed, false if the ring is full.
+     */
+    bool tryPush(T&& item) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask)
+                return false;
+        }
+
+        slots[t & mask] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+        wake(consumerWaiting, itemSignal);
+        return true;
+    }
+
+    /**
+     * @brief Producer: moves in as many items as there is room for, with a
+     * single index update and at most one wake-up. Never blocks.
+     * @return The number of items pushed, taken from the front of the array.
+     */
+    size_t tryPushBatch(T* items, size_t count) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        size_t room = mask + 1 - (t - cachedHead);
+        if (room < count) {
+            cachedHead = head.load(std::memory_order_acquire);
+            room = mask + 1 - (t - cachedHead);
+        }
+        const size_t pushed = std::min(room, count);
+        if (pushed == 0)
+            return 0;
+
+        for (size_t i = 0; i < pushed; ++i)
+            slots[(t + i) & mask] = std::move(items[i]);
+        tail.store(t + pushed, std::memory_order_release);
+        wake(consumerWaiting, itemSignal);
+        return pushed;
+    }
+
+    /**
+     * @brief Producer: pushes an item, sleeping while the ring is full.
+     * @return True if pushed, false if the ring was stopped.
+     */
+    bool push(T&& item) {
+        while (!stopped.load(std::memory_order_acquire)) {
+            if (tryPush(std::move(item)))
+                return true;
+
+            const uint32_t signal = spaceSignal.load(std::memory_order_acquire);
+            if (prepareWait(producerWaiting, [this] { return isFull(); }))
+                spaceSignal.wait(signal, std::memory_order_acquire);
+            producerWaiting.store(false, std::memory_order_relaxed);
+        }
+        return false;
+    }
+
+    /**
+     * @brief Consumer: moves the oldest item out if there is one. Never blocks.
+     * @return True if an item was popped, false if the ring is empty.
+     */
+    bool tryPop(T& outItem) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail)
+                return false;
+        }
+
+        outItem = std::move(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        wake(producerWaiting, spaceSignal);
+        return true;
+    }
+
+    /**
+     * @brief Consumer: pops an item, sleeping while the ring is empty.
+     * @return True if popped, false if stopped and drained.
+     */
+    bool pop(T& outItem) {
+        while (true) {
+            if (tryPop(outItem))
+                return true;
+            if (stopped.load(std::memory_order_acquire))
+                return tryPop(outItem);
+
+            const uint32_t signal = itemSignal.load(std::memory_order_acquire);
+            if (prepareWait(consumerWaiting, [this] { return isEmpty(); }))
+                itemSignal.wait(signal, std::memory_order_acquire);
+            consumerWaiting.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Consumer: drops every queued item.
+     */
+    void clear() {
+        T discarded;
+        while (tryPop(discarded))
+            discarded = T();
+    }
+
+    /**
+     * @brief Stop the ring (wakes up any sleeping thread).
+     */
+    void stop() {
+        stopped.store(true, std::memory_order_release);
+        itemSignal.fetch_add(1, std::memory_order_release);
+        spaceSignal.fetch_add(1, std::memory_order_release);
+        itemSignal.notify_all();
+        spaceSignal.notify_all();
+    }
+
+    /**
+     * @brief Re-arms a stopped ring. Only call while neither side is active.
+     */
+    void restart() {
+        stopped.store(false, std::memory_order_release);
+    }
+
+    /**
+     * @brief Approximate number of queued items; exact when called by either side.
+     */
+    size_t size() const {
+        const size_t h = head.load(std::memory_order_acquire);
+        const size_t t = tail.load(std::memory_order_acquire);
+        return t - h;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value)
+            result <<= 1;
+        return result;
+    }
+
+    bool isFull() const {
+        return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed) > mask;
+    }
+
+    bool isEmpty() const {
+        return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_relaxed);
+    }
+
+    // Announces a sleeper, then re-checks the condition. The fence pairs with
+    // the one in wake(), so either the sleeper sees the new index or the other
+    // side sees the flag.
+    template <typename Condition>
+    bool prepareWait(std::atomic<bool>& waitingFlag, Condition stillBlocked) {
+        if (!blocking)
+            return false;
+        waitingFlag.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return stillBlocked() && !stopped.load(std::memory_order_acquire);
+    }
+
+    void wake(std::atomic<bool>& waitingFlag, std::atomic<uint32_t>& signal) {
+        if (!blocking)
+            return;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waitingFlag.load(std::memory_order_relaxed)) {
+            waitingFlag.store(false, std::memory_order_relaxed);
+            signal.fetch_add(1, std::memory_order_release);
+            signal.notify_one();
+        }
+    }
+
+    const size_t mask;
+    const bool blocking;
+    std::unique_ptr<T[]> slots;
+
+    // Consumer-owned line
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0};
+    size_t cachedTail = 0;
+
+    // Producer-owned line
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+
+    // Sleep/wake state, only touched when blocking is enabled
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> consumerWaiting{false};
+    std::atomic<uint32_t> itemSignal{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> producerWaiting{false};
+    std::atomic<uint32_t> spaceSignal{0};
+    std::atomic<bool> stopped{false};
+};
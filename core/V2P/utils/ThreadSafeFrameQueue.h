@@ -13,12 +13,13 @@ public:
     /**
      * @brief Push a new frame into the queue.
      * Blocks if queue is full until space becomes available.
+     * The frame is moved in, so only its buffer reference changes hands.
      */
-    void push(const VideoFrame& frame) {
+    void push(VideoFrame&& frame) {
         std::unique_lock<std::mutex> lock(mutex);
         condFull.wait(lock, [this]() { return queue.size() < maxSize; });
 
-        queue.push(frame);
+        queue.push(std::move(frame));
         condEmpty.notify_one();
     }
 
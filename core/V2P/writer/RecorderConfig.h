@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Where and how a StreamRecorder writes. The container follows the
+ * file extension (.mp4, .mkv, .ts, ...).
+ */
+struct RecorderConfig {
+    // Output file. When splitting, every file gets a number before the
+    // extension: "show.mp4" becomes "show_000.mp4", "show_001.mp4", ...
+    std::string path = "recording.mp4";
+
+    // Start a new file at the first keyframe past either limit; 0 disables it
+    int64_t maxBytes = 0;
+    double maxSeconds = 0.0;
+
+    // Packets waiting for the writer. The demuxer never waits for the
+    // recording: when the disk falls this far behind, packets are dropped.
+    size_t queuePackets = 2000;
+};
+
+/**
+ * @brief Counters of a StreamRecorder.
+ */
+struct RecorderStats {
+    uint64_t packetsWritten = 0;
+    uint64_t packetsDropped = 0;  // Queue full, or before the first keyframe
+    uint64_t bytesWritten = 0;
+    uint64_t filesWritten = 0;    // Including the one being written
+    std::string currentFile;      // Empty until the first keyframe
+};
@@ -0,0 +1,271 @@
+#include "StreamRecorder.h"
+#include "V2P/metrics/Tracer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+}
+
+namespace {
+    const AVRational MICROSECONDS = { 1, AV_TIME_BASE };
+
+    // Further than this between two packets of a track is a discontinuity, not a gap
+    constexpr int64_t MAX_TIMESTAMP_STEP_US = 10 * AV_TIME_BASE;
+}
+
+StreamRecorder::StreamRecorder(RecorderConfig config)
+    : config(std::move(config)),
+      packets(std::max<size_t>(this->config.queuePackets, 1)) {}
+
+StreamRecorder::~StreamRecorder() {
+    stop();
+    for (Track& track : tracks) {
+        avcodec_parameters_free(&track.parameters);
+    }
+}
+
+bool StreamRecorder::start(const AVFormatContext* input, int videoStreamIndex, int audioStreamIndex) {
+    if (started || !input) {
+        return false;
+    }
+
+    // Copied, so that the recording does not depend on the input staying open
+    for (int index : { videoStreamIndex, audioStreamIndex }) {
+        if (index < 0 || index >= static_cast<int>(input->nb_streams)) {
+            continue;
+        }
+        const AVStream* stream = input->streams[index];
+
+        Track track;
+        track.inputIndex = index;
+        track.parameters = avcodec_parameters_alloc();
+        if (!track.parameters || avcodec_parameters_copy(track.parameters, stream->codecpar) < 0) {
+            std::cerr << "Could not copy codec parameters for recording." << std::endl;
+            avcodec_parameters_free(&track.parameters);
+            return false;
+        }
+        track.timeBaseNum = stream->time_base.num;
+        track.timeBaseDen = stream->time_base.den;
+        track.maxStep = av_rescale_q(MAX_TIMESTAMP_STEP_US, MICROSECONDS, stream->time_base);
+        tracks.push_back(track);
+    }
+
+    if (tracks.empty() || tracks.front().inputIndex != videoStreamIndex) {
+        std::cerr << "Recording needs a video stream." << std::endl;
+        return false;
+    }
+
+    started = true;
+    thread = std::thread(&StreamRecorder::writeLoop, this);
+    return true;
+}
+
+void StreamRecorder::push(const AVPacket* packet) {
+    if (!started || !findTrack(packet->stream_index)) {
+        return;
+    }
+
+    // A new reference to the same data; the demuxer keeps its packet
+    AVPacket* copy = av_packet_clone(packet);
+    if (!copy || !packets.tryPush(copy)) {
+        packetsDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void StreamRecorder::stop() {
+    if (!started) {
+        return;
+    }
+    packets.finish(); // The writer empties the queue, then finalizes the file
+    if (thread.joinable()) {
+        thread.join();
+    }
+    packets.flush();
+    started = false;
+}
+
+RecorderStats StreamRecorder::getStats() const {
+    RecorderStats stats;
+    stats.packetsWritten = packetsWritten.load(std::memory_order_relaxed);
+    stats.packetsDropped = packetsDropped.load(std::memory_order_relaxed);
+    stats.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+    stats.filesWritten = filesWritten.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(fileMutex);
+    stats.currentFile = currentFile;
+    return stats;
+}
+
+void StreamRecorder::writeLoop() {
+    Tracer::setThreadName("recorder");
+
+    AVPacket* packet = nullptr;
+    while (packets.pop(&packet)) {
+        Track* track = findTrack(packet->stream_index);
+        const bool keyframe = track == &tracks.front() && (packet->flags & AV_PKT_FLAG_KEY);
+        const int64_t ts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+        if (output && ts != AV_NOPTS_VALUE) {
+            bridgeJump(*track, ts);
+        }
+
+        // Files start, and are split, on a video keyframe with a timestamp
+        if (keyframe && ts != AV_NOPTS_VALUE) {
+            // Time since the start of the file, or the stream time of the first keyframe
+            const int64_t us = av_rescale_q(output ? ts - track->startTs : ts,
+                                            AVRational{ track->timeBaseNum, track->timeBaseDen }, MICROSECONDS);
+            bool split = output &&
+                ((config.maxBytes > 0 && fileBytes >= config.maxBytes) ||
+                 (config.maxSeconds > 0.0 && us >= static_cast<int64_t>(config.maxSeconds * 1e6)));
+            if (!output || split) {
+                // The keyframe goes to zero, and every track moves along with it
+                const bool first = !output;
+                closeFile();
+                for (Track& t : tracks) {
+                    t.startTs = (first ? 0 : t.startTs) +
+                                av_rescale_q(us, MICROSECONDS, AVRational{ t.timeBaseNum, t.timeBaseDen });
+                }
+                if (openFile() && first) {
+                    bridgeJump(*track, ts);
+                }
+            }
+        }
+
+        if (output) {
+            TraceScope trace("recorder write");
+            writePacket(packet, *track);
+        } else {
+            packetsDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        av_packet_free(&packet);
+    }
+
+    closeFile();
+}
+
+void StreamRecorder::bridgeJump(Track& track, int64_t ts) {
+    if (track.hasLast) {
+        const int64_t step = ts - track.lastTs;
+        if (step < 0 || step > track.maxStep) {
+            // Moved so that this packet follows the last one written by its usual step
+            track.startTs += step - track.lastStep;
+        } else if (step > 0) {
+            track.lastStep = step;
+        }
+    }
+    track.lastTs = ts;
+    track.hasLast = true;
+}
+
+bool StreamRecorder::openFile() {
+    const std::string path = filePath(filesWritten.load(std::memory_order_relaxed));
+
+    // The container follows the extension
+    if (avformat_alloc_output_context2(&output, nullptr, nullptr, path.c_str()) < 0 || !output) {
+        std::cerr << "Could not create recording context for " << path << std::endl;
+        output = nullptr;
+        return false;
+    }
+
+    bool ok = true;
+    for (const Track& track : tracks) {
+        AVStream* stream = avformat_new_stream(output, nullptr);
+        if (!stream || avcodec_parameters_copy(stream->codecpar, track.parameters) < 0) {
+            ok = false;
+            break;
+        }
+        stream->codecpar->codec_tag = 0; // The input container's tag may mean nothing in the output
+        stream->time_base = AVRational{ track.timeBaseNum, track.timeBaseDen };
+    }
+
+    if (ok && !(output->oformat->flags & AVFMT_NOFILE)) {
+        ok = avio_open(&output->pb, path.c_str(), AVIO_FLAG_WRITE) >= 0;
+    }
+    if (ok) {
+        ok = avformat_write_header(output, nullptr) >= 0;
+    }
+    if (!ok) {
+        std::cerr << "Could not open recording file: " << path << std::endl;
+        if (!(output->oformat->flags & AVFMT_NOFILE)) {
+            avio_closep(&output->pb);
+        }
+        avformat_free_context(output);
+        output = nullptr;
+        return false;
+    }
+
+    fileBytes = 0;
+    filesWritten.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        currentFile = path;
+    }
+    std::cout << "Recording to " << path << std::endl;
+    return true;
+}
+
+void StreamRecorder::closeFile() {
+    if (!output) {
+        return;
+    }
+    av_write_trailer(output);
+    if (!(output->oformat->flags & AVFMT_NOFILE)) {
+        avio_closep(&output->pb);
+    }
+    avformat_free_context(output);
+    output = nullptr;
+}
+
+void StreamRecorder::writePacket(AVPacket* packet, Track& track) {
+    const int trackIndex = static_cast<int>(&track - tracks.data());
+    AVStream* stream = output->streams[trackIndex];
+
+    // Rebased so that the file starts at zero; the muxer shifts the few
+    // audio packets that were demuxed after, but belong before, the keyframe
+    if (packet->pts != AV_NOPTS_VALUE) {
+        packet->pts -= track.startTs;
+    }
+    if (packet->dts != AV_NOPTS_VALUE) {
+        packet->dts -= track.startTs;
+    }
+    av_packet_rescale_ts(packet, AVRational{ track.timeBaseNum, track.timeBaseDen }, stream->time_base);
+    packet->stream_index = trackIndex;
+    packet->pos = -1;
+
+    const int size = packet->size;
+    if (av_interleaved_write_frame(output, packet) < 0) {
+        std::cerr << "Error while writing recorded packet." << std::endl;
+        packetsDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    fileBytes += size;
+    packetsWritten.fetch_add(1, std::memory_order_relaxed);
+    bytesWritten.fetch_add(size, std::memory_order_relaxed);
+}
+
+std::string StreamRecorder::filePath(uint64_t index) const {
+    if (config.maxBytes <= 0 && config.maxSeconds <= 0.0) {
+        return config.path;
+    }
+
+    // "show.mp4" -> "show_007.mp4"
+    size_t slash = config.path.find_last_of("/\\");
+    size_t dot = config.path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        dot = config.path.size();
+    }
+    char number[32];
+    std::snprintf(number, sizeof(number), "_%03llu", static_cast<unsigned long long>(index));
+    return config.path.substr(0, dot) + number + config.path.substr(dot);
+}
+
+StreamRecorder::Track* StreamRecorder::findTrack(int inputIndex) {
+    for (Track& track : tracks) {
+        if (track.inputIndex == inputIndex) {
+            return &track;
+        }
+    }
+    return nullptr;
+}
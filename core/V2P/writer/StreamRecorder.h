@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "V2P/writer/RecorderConfig.h"
+#include "V2P/stream/PacketQueue.h"
+
+// Forward-declare FFmpeg types
+struct AVFormatContext;
+struct AVCodecParameters;
+struct AVPacket;
+
+/**
+ * @brief Records a stream by copying its compressed packets into a file,
+ * without decoding or encoding anything.
+ *
+ * The demuxer hands every packet to push(), which only queues a new
+ * reference; a thread of the recorder's own muxes them. Recording starts
+ * at the first video keyframe, timestamps are rebased so that each file
+ * starts at zero, and files are split at keyframes by size or duration.
+ * A track whose timestamps jump back or far ahead (a live discontinuity,
+ * the 33-bit MPEG-TS wrap, a seek) carries on one step after its last
+ * packet, so the file stays continuous.
+ */
+class StreamRecorder {
+public:
+    explicit StreamRecorder(RecorderConfig config);
+    ~StreamRecorder();
+
+    StreamRecorder(const StreamRecorder&) = delete;
+    StreamRecorder& operator=(const StreamRecorder&) = delete;
+
+    /**
+     * @brief Takes the codec parameters of the streams to record and starts the writer thread.
+     * @param input The open input; only read during this call.
+     * @param videoStreamIndex The video stream, whose keyframes start and split files.
+     * @param audioStreamIndex An audio stream to record along, or -1.
+     * @return True on success, false if the streams cannot be recorded.
+     */
+    bool start(const AVFormatContext* input, int videoStreamIndex, int audioStreamIndex);
+
+    /**
+     * @brief Queues a packet of the input; others than the recorded streams
+     * are ignored. Never blocks. Called by the demuxer.
+     */
+    void push(const AVPacket* packet);
+
+    /**
+     * @brief Writes what is queued, finalizes the file and stops the writer thread.
+     */
+    void stop();
+
+    RecorderStats getStats() const;
+
+private:
+    struct Track {
+        int inputIndex = -1;
+        AVCodecParameters* parameters = nullptr;
+        int timeBaseNum = 1;  // Input time base
+        int timeBaseDen = 1;
+        int64_t startTs = 0;  // Input timestamp mapped to zero in the current file
+        int64_t lastTs = 0;   // Of the last packet written; valid if hasLast
+        int64_t lastStep = 1; // Last forward step between two packets
+        int64_t maxStep = 0;  // A step past this is a jump
+        bool hasLast = false;
+    };
+
+    void writeLoop();
+    void bridgeJump(Track& track, int64_t ts);
+    bool openFile();
+    void closeFile();
+    void writePacket(AVPacket* packet, Track& track);
+    std::string filePath(uint64_t index) const;
+    Track* findTrack(int inputIndex);
+
+    RecorderConfig config;
+    std::vector<Track> tracks; // Video first; fixed once started
+    PacketQueue packets;
+    std::thread thread;
+    bool started = false;
+
+    // Writer thread only
+    AVFormatContext* output = nullptr;
+    int64_t fileBytes = 0;
+
+    std::atomic<uint64_t> packetsWritten{0};
+    std::atomic<uint64_t> packetsDropped{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> filesWritten{0};
+    mutable std::mutex fileMutex;
+    std::string currentFile; // Guarded by fileMutex
+};
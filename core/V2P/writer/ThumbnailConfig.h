@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief How a ThumbnailExtractor lays out its images.
+ */
+enum class ThumbnailLayout {
+    SPRITE,  // Grids of columns x rows thumbnails per JPEG, plus a WebVTT map of them
+    SINGLE   // One JPEG per thumbnail, plus a WebVTT listing them
+};
+
+/**
+ * @brief What a ThumbnailExtractor takes from every input, and where it goes.
+ */
+struct ThumbnailConfig {
+    std::string outputDirectory = ".";
+
+    // Thumbnail size; a height of 0 follows the picture's aspect ratio.
+    // Both are rounded down to even numbers.
+    int width = 160;
+    int height = 0;
+
+    // At most one thumbnail per interval: the first keyframe at or past it
+    double intervalSeconds = 10.0;
+    int maxThumbnails = 0; // Per input; 0 for no limit
+
+    ThumbnailLayout layout = ThumbnailLayout::SPRITE;
+    int columns = 10;
+    int rows = 10;
+
+    int quality = 5; // JPEG quantizer, from 2 (best) to 31
+
+    // Inputs extracted at once; 0 for one per core. Each decodes on one thread.
+    int threads = 0;
+};
+
+/**
+ * @brief What came out of one input.
+ */
+struct ThumbnailResult {
+    std::string input;
+    bool ok = false;
+    int thumbnails = 0;
+    int files = 0;                  // JPEGs written
+    uint64_t keyframesDecoded = 0;
+    uint64_t packetsSkipped = 0;    // Video packets never handed to the decoder
+    double seconds = 0.0;
+};
+
+/**
+ * @brief Totals of a ThumbnailExtractor::run().
+ */
+struct ThumbnailStats {
+    size_t inputs = 0;
+    size_t failed = 0;
+    uint64_t thumbnails = 0;
+    uint64_t files = 0;
+    uint64_t keyframesDecoded = 0;
+    uint64_t packetsSkipped = 0;
+    double seconds = 0.0;            // Wall time of the whole run
+    double thumbnailsPerSecond = 0.0;
+    std::vector<ThumbnailResult> results; // In input order
+};
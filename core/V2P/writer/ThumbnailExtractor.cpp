@@ -0,0 +1,503 @@
+#include "ThumbnailExtractor.h"
+#include "V2P/metrics/StreamMetrics.h"
+#include "V2P/metrics/Tracer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#include <libavutil/imgutils.h>
+}
+
+namespace {
+    // A seek costs a request or a disk seek; for shorter gaps reading on is cheaper
+    constexpr double SEEK_AHEAD_SECONDS = 5.0;
+
+    int evenDown(int value) {
+        return std::max(2, value & ~1);
+    }
+
+    std::string vttTime(double seconds) {
+        const int64_t ms = static_cast<int64_t>(std::llround(std::max(seconds, 0.0) * 1000.0));
+        char text[32];
+        std::snprintf(text, sizeof(text), "%02lld:%02lld:%02lld.%03lld",
+                      static_cast<long long>(ms / 3600000), static_cast<long long>(ms / 60000 % 60),
+                      static_cast<long long>(ms / 1000 % 60), static_cast<long long>(ms % 1000));
+        return text;
+    }
+
+    /**
+     * @brief One input's extraction: demuxer, keyframe-only decoder, the sheet
+     * being filled and the JPEG encoder.
+     */
+    class ThumbnailJob {
+    public:
+        ThumbnailJob(const ThumbnailConfig& config, std::string name, const std::atomic<bool>& aborted)
+            : config(config), name(std::move(name)), aborted(aborted) {}
+        ~ThumbnailJob();
+
+        ThumbnailJob(const ThumbnailJob&) = delete;
+        ThumbnailJob& operator=(const ThumbnailJob&) = delete;
+
+        bool open(const std::string& url);
+        bool run(ThumbnailResult& result);
+
+    private:
+        struct Cue {
+            double seconds = 0.0;
+            int file = 0;
+            int cell = 0;
+        };
+
+        bool openDecoder(const AVCodec* codec);
+        bool openSheet();
+        bool full(const ThumbnailResult& result) const;
+        void decodePacket(const AVPacket* input, ThumbnailResult& result);
+        void addThumbnail(const AVFrame* frame, ThumbnailResult& result);
+        void writeSheet(ThumbnailResult& result);
+        void clearSheet();
+        bool writeIndex() const;
+        std::string fileName(int index) const;
+        static int interruptCallback(void* opaque);
+
+        const ThumbnailConfig& config;
+        const std::string name;
+        const std::atomic<bool>& aborted;
+
+        AVFormatContext* formatContext = nullptr;
+        AVCodecContext* decoder = nullptr;
+        AVCodecContext* encoder = nullptr;
+        SwsContext* scaler = nullptr;
+        AVFrame* decoded = nullptr;
+        AVFrame* sheet = nullptr;
+        AVPacket* packet = nullptr;
+        AVPacket* encoded = nullptr;
+
+        int videoStreamIndex = -1;
+        double timeBase = 0.0;
+        double origin = 0.0;   // Stream time of the input's start
+        double duration = 0.0; // 0 if unknown
+
+        int thumbWidth = 0;
+        int thumbHeight = 0;
+        int columns = 1;
+        int rows = 1;
+        int cell = 0;          // Next cell of the sheet being filled
+        int sheetIndex = 0;
+        std::vector<Cue> cues;
+    };
+
+    ThumbnailJob::~ThumbnailJob() {
+        av_packet_free(&packet);
+        av_packet_free(&encoded);
+        av_frame_free(&decoded);
+        av_frame_free(&sheet);
+        sws_freeContext(scaler);
+        avcodec_free_context(&encoder);
+        avcodec_free_context(&decoder);
+        if (formatContext) {
+            avformat_close_input(&formatContext);
+        }
+    }
+
+    int ThumbnailJob::interruptCallback(void* opaque) {
+        return static_cast<ThumbnailJob*>(opaque)->aborted.load() ? 1 : 0;
+    }
+
+    bool ThumbnailJob::open(const std::string& url) {
+        formatContext = avformat_alloc_context();
+        if (!formatContext) {
+            return false;
+        }
+        formatContext->interrupt_callback.callback = &ThumbnailJob::interruptCallback;
+        formatContext->interrupt_callback.opaque = this;
+
+        if (avformat_open_input(&formatContext, url.c_str(), nullptr, nullptr) < 0) {
+            std::cerr << "Could not open " << url << std::endl;
+            formatContext = nullptr; // Freed on failure
+            return false;
+        }
+        if (avformat_find_stream_info(formatContext, nullptr) < 0) {
+            std::cerr << "Could not find stream information in " << url << std::endl;
+            return false;
+        }
+
+        const AVCodec* codec = nullptr;
+        videoStreamIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+        if (videoStreamIndex < 0 || !codec) {
+            std::cerr << "No decodable video stream in " << url << std::endl;
+            return false;
+        }
+
+        // Demuxers that can skip samples (MP4, MKV) then read keyframes only
+        for (unsigned i = 0; i < formatContext->nb_streams; ++i) {
+            formatContext->streams[i]->discard = static_cast<int>(i) == videoStreamIndex ? AVDISCARD_NONKEY : AVDISCARD_ALL;
+        }
+
+        const AVStream* stream = formatContext->streams[videoStreamIndex];
+        timeBase = av_q2d(stream->time_base);
+        origin = formatContext->start_time != AV_NOPTS_VALUE ? (double)formatContext->start_time / AV_TIME_BASE : 0.0;
+        duration = formatContext->duration != AV_NOPTS_VALUE ? (double)formatContext->duration / AV_TIME_BASE : 0.0;
+
+        packet = av_packet_alloc();
+        encoded = av_packet_alloc();
+        decoded = av_frame_alloc();
+        return packet && encoded && decoded && openDecoder(codec) && openSheet();
+    }
+
+    bool ThumbnailJob::openDecoder(const AVCodec* codec) {
+        const AVCodecParameters* parameters = formatContext->streams[videoStreamIndex]->codecpar;
+        decoder = avcodec_alloc_context3(codec);
+        if (!decoder || avcodec_parameters_to_context(decoder, parameters) < 0) {
+            return false;
+        }
+
+        // The workers already run one input each; keyframes need no
+        // in-loop filtering to make a recognisable thumbnail
+        decoder->thread_count = 1;
+        decoder->skip_frame = AVDISCARD_NONKEY;
+        decoder->skip_loop_filter = AVDISCARD_ALL;
+        decoder->flags2 |= AV_CODEC_FLAG2_FAST;
+
+        // Decoders that can (MJPEG, MPEG-4 part 2...) decode at a fraction of the size
+        int lowres = 0;
+        while (lowres < codec->max_lowres && (parameters->width >> (lowres + 1)) >= config.width) {
+            ++lowres;
+        }
+        decoder->lowres = lowres;
+
+        if (avcodec_open2(decoder, codec, nullptr) < 0) {
+            std::cerr << "Could not open the " << codec->name << " decoder." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool ThumbnailJob::openSheet() {
+        const AVCodecParameters* parameters = formatContext->streams[videoStreamIndex]->codecpar;
+        if (parameters->width <= 0 || parameters->height <= 0) {
+            return false;
+        }
+
+        // The displayed shape, which anamorphic video only gets from its sample aspect ratio
+        double aspect = (double)parameters->width / parameters->height;
+        if (parameters->sample_aspect_ratio.num > 0 && parameters->sample_aspect_ratio.den > 0) {
+            aspect *= av_q2d(parameters->sample_aspect_ratio);
+        }
+        thumbWidth = evenDown(config.width);
+        thumbHeight = config.height > 0 ? evenDown(config.height) : evenDown((int)std::lround(thumbWidth / aspect));
+        if (config.layout == ThumbnailLayout::SPRITE) {
+            columns = std::max(config.columns, 1);
+            rows = std::max(config.rows, 1);
+        }
+
+        sheet = av_frame_alloc();
+        if (!sheet) {
+            return false;
+        }
+        sheet->format = AV_PIX_FMT_YUVJ420P;
+        sheet->width = columns * thumbWidth;
+        sheet->height = rows * thumbHeight;
+        if (av_frame_get_buffer(sheet, 0) < 0) {
+            return false;
+        }
+        clearSheet();
+
+        const AVCodec* codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+        encoder = codec ? avcodec_alloc_context3(codec) : nullptr;
+        if (!encoder) {
+            std::cerr << "No JPEG encoder available." << std::endl;
+            return false;
+        }
+        encoder->width = sheet->width;
+        encoder->height = sheet->height;
+        encoder->pix_fmt = AV_PIX_FMT_YUVJ420P;
+        encoder->time_base = AVRational{ 1, 1 };
+        encoder->flags |= AV_CODEC_FLAG_QSCALE;
+        encoder->global_quality = FF_QP2LAMBDA * std::clamp(config.quality, 2, 31);
+        if (avcodec_open2(encoder, codec, nullptr) < 0) {
+            std::cerr << "Could not open the JPEG encoder." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool ThumbnailJob::full(const ThumbnailResult& result) const {
+        return config.maxThumbnails > 0 && result.thumbnails >= config.maxThumbnails;
+    }
+
+    bool ThumbnailJob::run(ThumbnailResult& result) {
+        const double interval = std::max(config.intervalSeconds, 0.0);
+        double due = -std::numeric_limits<double>::infinity(); // Time of the next thumbnail
+        double lastTaken = due;
+        bool seekAhead = interval >= SEEK_AHEAD_SECONDS;
+        bool seeked = false;
+
+        while (!aborted && !full(result)) {
+            if (av_read_frame(formatContext, packet) < 0) {
+                break; // End of input, error or aborted
+            }
+            if (packet->stream_index != videoStreamIndex) {
+                av_packet_unref(packet);
+                continue;
+            }
+            if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+                result.packetsSkipped++;
+                av_packet_unref(packet);
+                continue;
+            }
+
+            const int64_t ts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+            const double seconds = ts != AV_NOPTS_VALUE ? (double)ts * timeBase - origin : due;
+
+            // A seek that went nowhere: read on instead
+            if (seeked) {
+                seeked = false;
+                seekAhead = seekAhead && seconds > lastTaken;
+            }
+            if (seconds < due) {
+                result.packetsSkipped++;
+                av_packet_unref(packet);
+                continue;
+            }
+
+            decodePacket(packet, result);
+            av_packet_unref(packet);
+            lastTaken = seconds;
+            due = seconds + interval;
+
+            // Long intervals: let the demuxer jump to the next keyframe due
+            if (seekAhead) {
+                const int64_t target = (int64_t)((due + origin) / timeBase);
+                seeked = av_seek_frame(formatContext, videoStreamIndex, target, 0) >= 0;
+                seekAhead = seeked;
+            }
+        }
+
+        // Keyframes the decoder still holds
+        if (!aborted) {
+            decodePacket(nullptr, result);
+        }
+        if (cell > 0) {
+            writeSheet(result);
+        }
+        if (result.thumbnails > 0 && !writeIndex()) {
+            std::cerr << "Could not write the thumbnail index for " << name << std::endl;
+        }
+        return !aborted && result.thumbnails > 0;
+    }
+
+    void ThumbnailJob::decodePacket(const AVPacket* input, ThumbnailResult& result) {
+        TraceScope trace("thumbnail decode");
+        if (avcodec_send_packet(decoder, input) < 0) {
+            return;
+        }
+        if (input) {
+            result.keyframesDecoded++;
+        }
+        while (avcodec_receive_frame(decoder, decoded) == 0) {
+            if (!full(result)) {
+                addThumbnail(decoded, result);
+            }
+            av_frame_unref(decoded);
+        }
+    }
+
+    void ThumbnailJob::addThumbnail(const AVFrame* frame, ThumbnailResult& result) {
+        // The encoder may still reference the previous sheet
+        if (av_frame_make_writable(sheet) < 0) {
+            return;
+        }
+        scaler = sws_getCachedContext(scaler, frame->width, frame->height, (AVPixelFormat)frame->format,
+                                      thumbWidth, thumbHeight, AV_PIX_FMT_YUVJ420P,
+                                      SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!scaler) {
+            return;
+        }
+
+        // Scaled straight into its cell; chroma is half size both ways
+        const int x = (cell % columns) * thumbWidth;
+        const int y = (cell / columns) * thumbHeight;
+        uint8_t* destination[4] = {
+            sheet->data[0] + y * sheet->linesize[0] + x,
+            sheet->data[1] + (y / 2) * sheet->linesize[1] + x / 2,
+            sheet->data[2] + (y / 2) * sheet->linesize[2] + x / 2,
+            nullptr
+        };
+        {
+            TraceScope trace("thumbnail scale");
+            sws_scale(scaler, frame->data, frame->linesize, 0, frame->height, destination, sheet->linesize);
+        }
+
+        const int64_t pts = frame->best_effort_timestamp;
+        Cue cue;
+        cue.seconds = pts != AV_NOPTS_VALUE ? (double)pts * timeBase - origin : 0.0;
+        cue.file = sheetIndex;
+        cue.cell = cell;
+        cues.push_back(cue);
+        result.thumbnails++;
+
+        if (++cell == columns * rows) {
+            writeSheet(result);
+        }
+    }
+
+    void ThumbnailJob::writeSheet(ThumbnailResult& result) {
+        TraceScope trace("thumbnail encode");
+        sheet->pts = sheetIndex;
+        sheet->quality = encoder->global_quality;
+
+        const std::string path = config.outputDirectory + "/" + fileName(sheetIndex);
+        bool written = false;
+        if (avcodec_send_frame(encoder, sheet) >= 0 && avcodec_receive_packet(encoder, encoded) >= 0) {
+            FILE* file = std::fopen(path.c_str(), "wb");
+            if (file) {
+                written = std::fwrite(encoded->data, 1, encoded->size, file) == (size_t)encoded->size;
+                written = std::fclose(file) == 0 && written;
+            }
+            av_packet_unref(encoded);
+        }
+        if (written) {
+            result.files++;
+        } else {
+            std::cerr << "Could not write " << path << std::endl;
+        }
+
+        sheetIndex++;
+        cell = 0;
+        clearSheet();
+    }
+
+    void ThumbnailJob::clearSheet() {
+        // Black, so that a last sheet not filled up has empty cells
+        if (av_frame_make_writable(sheet) < 0) {
+            return;
+        }
+        std::memset(sheet->data[0], 0, (size_t)sheet->linesize[0] * sheet->height);
+        std::memset(sheet->data[1], 128, (size_t)sheet->linesize[1] * (sheet->height / 2));
+        std::memset(sheet->data[2], 128, (size_t)sheet->linesize[2] * (sheet->height / 2));
+    }
+
+    bool ThumbnailJob::writeIndex() const {
+        // WebVTT thumbnail track: players show the cue's image (or sprite cell) while scrubbing
+        const std::string path = config.outputDirectory + "/" + name + ".vtt";
+        FILE* file = std::fopen(path.c_str(), "w");
+        if (!file) {
+            return false;
+        }
+
+        std::string text = "WEBVTT\n\n";
+        for (size_t i = 0; i < cues.size(); ++i) {
+            const Cue& cue = cues[i];
+            double end = i + 1 < cues.size() ? cues[i + 1].seconds : std::max(duration, cue.seconds + config.intervalSeconds);
+            text += vttTime(cue.seconds) + " --> " + vttTime(std::max(end, cue.seconds)) + "\n";
+            text += fileName(cue.file);
+            if (config.layout == ThumbnailLayout::SPRITE) {
+                text += "#xywh=" + std::to_string((cue.cell % columns) * thumbWidth) + "," +
+                        std::to_string((cue.cell / columns) * thumbHeight) + "," +
+                        std::to_string(thumbWidth) + "," + std::to_string(thumbHeight);
+            }
+            text += "\n\n";
+        }
+
+        bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+        return std::fclose(file) == 0 && written;
+    }
+
+    std::string ThumbnailJob::fileName(int index) const {
+        char number[16];
+        std::snprintf(number, sizeof(number), "_%03d.jpg", index);
+        return name + number;
+    }
+}
+
+ThumbnailExtractor::ThumbnailExtractor(ThumbnailConfig config) : config(std::move(config)) {}
+
+ThumbnailStats ThumbnailExtractor::run(const std::vector<std::string>& inputs) {
+    ThumbnailStats stats;
+    stats.inputs = inputs.size();
+    stats.results.resize(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        stats.results[i].input = inputs[i];
+    }
+
+    const int64_t start = StreamMetrics::now();
+    size_t threads = config.threads > 0
+        ? static_cast<size_t>(config.threads)
+        : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    threads = std::min(threads, inputs.size());
+
+    // Each worker takes the next input as soon as it is done with one
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        Tracer::setThreadName("thumbnails");
+        for (size_t i = next++; i < inputs.size() && !aborted; i = next++) {
+            stats.results[i] = extract(inputs[i], outputName(i, inputs[i]));
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    for (const ThumbnailResult& result : stats.results) {
+        stats.failed += result.ok ? 0 : 1;
+        stats.thumbnails += result.thumbnails;
+        stats.files += result.files;
+        stats.keyframesDecoded += result.keyframesDecoded;
+        stats.packetsSkipped += result.packetsSkipped;
+    }
+    stats.seconds = static_cast<double>(StreamMetrics::now() - start) / 1e9;
+    stats.thumbnailsPerSecond = stats.seconds > 0.0 ? static_cast<double>(stats.thumbnails) / stats.seconds : 0.0;
+
+    std::cout << "Extracted " << stats.thumbnails << " thumbnails from " << stats.inputs - stats.failed << " of "
+              << stats.inputs << " inputs in " << stats.seconds << " s (" << stats.thumbnailsPerSecond
+              << " thumbnails/s)." << std::endl;
+    return stats;
+}
+
+ThumbnailResult ThumbnailExtractor::extract(const std::string& input, const std::string& name) {
+    ThumbnailResult result;
+    result.input = input;
+    const int64_t start = StreamMetrics::now();
+
+    std::error_code error;
+    std::filesystem::create_directories(config.outputDirectory, error);
+
+    ThumbnailJob job(config, name, aborted);
+    result.ok = job.open(input) && job.run(result);
+    result.seconds = static_cast<double>(StreamMetrics::now() - start) / 1e9;
+    if (!result.ok && !aborted) {
+        std::cerr << "No thumbnails from " << input << std::endl;
+    }
+    return result;
+}
+
+std::string ThumbnailExtractor::outputName(size_t index, const std::string& input) {
+    // The input's file name without query or extension, safe for any file system
+    std::string stem = input.substr(0, input.find_first_of("?#"));
+    stem = stem.substr(stem.find_last_of("/\\") + 1);
+    stem = stem.substr(0, stem.find_last_of('.'));
+    for (char& c : stem) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') {
+            c = '_';
+        }
+    }
+
+    char prefix[24];
+    std::snprintf(prefix, sizeof(prefix), "%04zu", index);
+    return stem.empty() ? std::string(prefix) : std::string(prefix) + "_" + stem;
+}
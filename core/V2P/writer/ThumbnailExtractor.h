@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "V2P/writer/ThumbnailConfig.h"
+
+/**
+ * @brief Batch extraction of preview thumbnails and sprite sheets.
+ *
+ * Only video keyframes are ever decoded: other packets are dropped before
+ * the decoder, which is also told to discard non-key frames, and keyframes
+ * closer than the interval are skipped (or sought past, where the input
+ * allows it). Each picture is scaled straight into its cell of the sheet.
+ * Inputs are spread over a bounded set of worker threads, one input per
+ * worker at a time, each decoding single-threaded.
+ */
+class ThumbnailExtractor {
+public:
+    explicit ThumbnailExtractor(ThumbnailConfig config);
+
+    /**
+     * @brief Extracts every input, blocking until all are done or abort().
+     * Files are named after the input's position and name, e.g.
+     * "0003_talk_000.jpg" and "0003_talk.vtt".
+     */
+    ThumbnailStats run(const std::vector<std::string>& inputs);
+
+    /**
+     * @brief Extracts one input on the calling thread.
+     * @param name Prefix of the files written.
+     */
+    ThumbnailResult extract(const std::string& input, const std::string& name);
+
+    /**
+     * @brief Stops the extractions in progress at their next packet. Any thread.
+     */
+    void abort() { aborted = true; }
+
+private:
+    static std::string outputName(size_t index, const std::string& input);
+
+    ThumbnailConfig config;
+    std::atomic<bool> aborted{false};
+};
@@ -1,5 +1,8 @@
 #include "VideoWriter.h"
+#include "V2P/metrics/StreamMetrics.h"
+#include "V2P/metrics/Tracer.h"
 
+#include <algorithm>
 #include <iostream>
 
 extern "C" {
@@ -15,7 +18,19 @@ VideoWriter::VideoWriter()
       codecContext(nullptr),
       swsContext(nullptr),
       tmpFrame(nullptr),
-      nextPts(0) {}
+      nextPts(0),
+      headerWritten(false),
+      failed(false),
+      framesQueued(0),
+      framesDropped(0),
+      framesEncoded(0),
+      packetsWritten(0),
+      maxQueueDepth(0),
+      convertNs(0),
+      encodeNs(0),
+      muxNs(0),
+      firstEncodeNs(0),
+      lastEncodeNs(0) {}
 
 VideoWriter::~VideoWriter() {
     close();
@@ -56,8 +71,11 @@ bool VideoWriter::open(const std::string& filename, int width, int height, AVRat
     codecContext->framerate = av_inv_q(time_base);
     // H.264 requires YUV420p. We will convert frames to this format.
     codecContext->pix_fmt = AV_PIX_FMT_YUV420P;
-    codecContext->bit_rate = 400000; // Example bitrate
-    av_opt_set(codecContext->priv_data, "preset", "slow", 0);
+    codecContext->bit_rate = config.bitRate;
+    av_opt_set(codecContext->priv_data, "preset", config.preset.c_str(), 0);
+    if (config.encoderThreads > 0) {
+        codecContext->thread_count = config.encoderThreads;
+    }
 
     if (formatContext->oformat->flags & AVFMT_GLOBALHEADER) {
         codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
@@ -86,6 +104,7 @@ bool VideoWriter::open(const std::string& filename, int width, int height, AVRat
         std::cerr << "Error occurred when opening output file." << std::endl;
         return false;
     }
+    headerWritten = true;
 
     // 6. Setup pixel format converter if needed
     if (input_pix_fmt != codecContext->pix_fmt) {
@@ -106,16 +125,57 @@ bool VideoWriter::open(const std::string& filename, int width, int height, AVRat
         }
     }
 
+    if (config.async) {
+        startPipeline();
+    }
     return true;
 }
 
+void VideoWriter::FrameDeleter::operator()(AVFrame* frame) const {
+    av_frame_free(&frame);
+}
+
 bool VideoWriter::writeFrame(AVFrame* frame) {
+    if (!codecContext || failed) {
+        return false;
+    }
+
+    if (inputFrames) {
+        // A new reference, not a copy: the pixels stay shared with the caller,
+        // whose next write must go to a new buffer (see writeFrame() in the header)
+        FramePtr queued(av_frame_clone(frame));
+        if (!queued) {
+            std::cerr << "Could not reference frame for encoding." << std::endl;
+            return false;
+        }
+
+        // Dropped frames keep their pts, so the file's timing has a gap instead of a jump
+        queued->pts = nextPts++;
+        TraceScope trace("writer queue push"); // Blocks while the encoder is behind, under BLOCK
+        bool pushed = config.overflow == WriterOverflow::DROP
+            ? inputFrames->tryPush(std::move(queued))
+            : inputFrames->push(std::move(queued));
+        if (!pushed) {
+            framesDropped.fetch_add(1, std::memory_order_relaxed);
+            return config.overflow == WriterOverflow::DROP;
+        }
+
+        framesQueued.fetch_add(1, std::memory_order_relaxed);
+        size_t depth = inputFrames->size();
+        size_t deepest = maxQueueDepth.load(std::memory_order_relaxed);
+        while (depth > deepest && !maxQueueDepth.compare_exchange_weak(deepest, depth)) {}
+        return true;
+    }
+
+    framesQueued.fetch_add(1, std::memory_order_relaxed);
     AVFrame* frame_to_encode = frame;
 
     // If pixel formats don't match, we need to convert
     if (swsContext) {
+        int64_t convertStart = StreamMetrics::now();
         sws_scale(swsContext, frame->data, frame->linesize, 0, frame->height,
                   tmpFrame->data, tmpFrame->linesize);
+        convertNs.fetch_add(StreamMetrics::now() - convertStart, std::memory_order_relaxed);
         frame_to_encode = tmpFrame;
     }
 
@@ -125,12 +185,116 @@ bool VideoWriter::writeFrame(AVFrame* frame) {
     return encode(frame_to_encode);
 }
 
+void VideoWriter::startPipeline() {
+    inputFrames = std::make_unique<SpscRingBuffer<FramePtr>>(std::max<size_t>(config.queueFrames, 1));
+    convertedFrames = std::make_unique<SpscRingBuffer<FramePtr>>(CONVERTED_QUEUE_SIZE);
+    packets.flush();
+    failed = false;
+
+    muxThread = std::thread(&VideoWriter::muxLoop, this);
+    encodeThread = std::thread(&VideoWriter::encodeLoop, this);
+    convertThread = std::thread(&VideoWriter::convertLoop, this);
+}
+
+void VideoWriter::stopPipeline() {
+    // Each stage drains what it has and then ends the next one's input
+    inputFrames->stop();
+    if (convertThread.joinable()) {
+        convertThread.join();
+    }
+    if (encodeThread.joinable()) {
+        encodeThread.join();
+    }
+    if (muxThread.joinable()) {
+        muxThread.join();
+    }
+    inputFrames.reset();
+    convertedFrames.reset();
+    packets.flush();
+}
+
+void VideoWriter::convertLoop() {
+    Tracer::setThreadName("writer convert");
+
+    FramePtr frame;
+    while (inputFrames->pop(frame)) {
+        // After a failure the queue is still drained, so writeFrame() never waits forever
+        if (swsContext && !failed) {
+            TraceScope trace("writer sws_scale");
+            int64_t convertStart = StreamMetrics::now();
+
+            // Pooled buffers return once the encoder has taken its copy
+            FramePtr converted(av_frame_alloc());
+            if (!converted || !convertPool.acquire(converted.get(), codecContext->pix_fmt,
+                                                   codecContext->width, codecContext->height)) {
+                std::cerr << "Could not allocate conversion buffer." << std::endl;
+                failed = true;
+            } else {
+                sws_scale(swsContext, frame->data, frame->linesize, 0, frame->height,
+                          converted->data, converted->linesize);
+                converted->pts = frame->pts;
+                frame = std::move(converted);
+            }
+            convertNs.fetch_add(StreamMetrics::now() - convertStart, std::memory_order_relaxed);
+        }
+
+        if (failed) {
+            frame.reset();
+            continue;
+        }
+        convertedFrames->push(std::move(frame));
+    }
+    convertedFrames->stop();
+}
+
+void VideoWriter::encodeLoop() {
+    Tracer::setThreadName("writer encode");
+
+    FramePtr frame;
+    while (convertedFrames->pop(frame)) {
+        if (!failed && !encode(frame.get())) {
+            failed = true;
+        }
+        frame.reset();
+    }
+
+    if (!failed) {
+        encode(nullptr); // Drains the encoder
+    }
+    packets.finish();
+}
+
+void VideoWriter::muxLoop() {
+    Tracer::setThreadName("writer mux");
+
+    AVPacket* packet = nullptr;
+    while (packets.pop(&packet)) {
+        // After a failure the queue is still drained, so the encoder never waits forever
+        if (!failed && !writePacket(packet)) {
+            failed = true;
+        }
+        av_packet_free(&packet);
+    }
+}
+
 bool VideoWriter::close() {
-    // Flush the encoder
-    encode(nullptr);
+    if (!formatContext) {
+        return true; // Never opened, or already closed
+    }
+
+    bool ok = !failed;
+    if (inputFrames) {
+        stopPipeline();
+        ok = ok && !failed;
+    } else if (codecContext && headerWritten) {
+        // Flush the encoder
+        ok = encode(nullptr) && ok;
+    }
 
     // Write the trailer
-    av_write_trailer(formatContext);
+    if (headerWritten) {
+        av_write_trailer(formatContext);
+    }
 
     // Clean up
     if (codecContext) {
@@ -153,37 +317,100 @@ bool VideoWriter::close() {
     }
 
     nextPts = 0;
-    return true;
+    headerWritten = false;
+    failed = false;
+    return ok;
 }
 
 
 bool VideoWriter::encode(const AVFrame* frame) {
+    TraceScope trace("writer encode");
+    int64_t encodeStart = StreamMetrics::now();
     if (avcodec_send_frame(codecContext, frame) < 0) {
         std::cerr << "Error sending a frame for encoding." << std::endl;
         return false;
     }
+    if (frame) {
+        framesEncoded.fetch_add(1, std::memory_order_relaxed);
+    }
 
     AVPacket* packet = av_packet_alloc();
+    bool ok = true;
     while (true) {
         int ret = avcodec_receive_packet(codecContext, packet);
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             break; // Need more input or encoding is finished
         } else if (ret < 0) {
             std::cerr << "Error during encoding." << std::endl;
-            av_packet_free(&packet);
-            return false;
+            ok = false;
+            break;
         }
 
-        // Rescale timestamps
-        av_packet_rescale_ts(packet, codecContext->time_base, formatContext->streams[0]->time_base);
-        packet->stream_index = 0;
-
-        // Write the compressed frame to the media file
-        if (av_interleaved_write_frame(formatContext, packet) < 0) {
-             std::cerr << "Error while writing packet." << std::endl;
+        // The muxer's share is timed on its own
+        int64_t now = StreamMetrics::now();
+        encodeNs.fetch_add(now - encodeStart, std::memory_order_relaxed);
+        if (inputFrames) {
+            AVPacket* queued = av_packet_alloc();
+            if (!queued) {
+                ok = false;
+                break;
+            }
+            av_packet_move_ref(queued, packet);
+            packets.push(queued); // Blocks while the muxer is behind
+        } else if (!writePacket(packet)) {
+            ok = false;
         }
         av_packet_unref(packet);
+        encodeStart = StreamMetrics::now();
     }
     av_packet_free(&packet);
-    return true;
-}
\ No newline at end of file
+
+    int64_t encodeEnd = StreamMetrics::now();
+    encodeNs.fetch_add(encodeEnd - encodeStart, std::memory_order_relaxed);
+    if (frame) {
+        int64_t unset = 0;
+        firstEncodeNs.compare_exchange_strong(unset, encodeEnd, std::memory_order_relaxed);
+        lastEncodeNs.store(encodeEnd, std::memory_order_relaxed);
+    }
+    return ok;
+}
+
+bool VideoWriter::writePacket(AVPacket* packet) {
+    TraceScope trace("writer mux");
+    int64_t muxStart = StreamMetrics::now();
+
+    // Rescale timestamps
+    av_packet_rescale_ts(packet, codecContext->time_base, formatContext->streams[0]->time_base);
+    packet->stream_index = 0;
+
+    // Write the compressed frame to the media file
+    bool ok = av_interleaved_write_frame(formatContext, packet) >= 0;
+    if (!ok) {
+        std::cerr << "Error while writing packet." << std::endl;
+    } else {
+        packetsWritten.fetch_add(1, std::memory_order_relaxed);
+    }
+    muxNs.fetch_add(StreamMetrics::now() - muxStart, std::memory_order_relaxed);
+    return ok;
+}
+
+WriterStats VideoWriter::getStats() const {
+    WriterStats stats;
+    stats.framesQueued = framesQueued.load(std::memory_order_relaxed);
+    stats.framesDropped = framesDropped.load(std::memory_order_relaxed);
+    stats.framesEncoded = framesEncoded.load(std::memory_order_relaxed);
+    stats.packetsWritten = packetsWritten.load(std::memory_order_relaxed);
+    stats.queueDepth = inputFrames ? inputFrames->size() : 0;
+    stats.maxQueueDepth = maxQueueDepth.load(std::memory_order_relaxed);
+    stats.packetQueueDepth = packets.size();
+    stats.totalConvertMs = static_cast<double>(convertNs.load(std::memory_order_relaxed)) / 1e6;
+    stats.totalEncodeMs = static_cast<double>(encodeNs.load(std::memory_order_relaxed)) / 1e6;
+    stats.totalMuxMs = static_cast<double>(muxNs.load(std::memory_order_relaxed)) / 1e6;
+
+    int64_t first = firstEncodeNs.load(std::memory_order_relaxed);
+    int64_t last = lastEncodeNs.load(std::memory_order_relaxed);
+    if (stats.framesEncoded > 1 && last > first) {
+        stats.encodeFps = static_cast<double>(stats.framesEncoded - 1) / (static_cast<double>(last - first) / 1e9);
+    }
+    return stats;
+}
@@ -1,13 +1,22 @@
 #pragma once
 
 #include <string>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include <libavutil/pixfmt.h>
 #include <libavutil/rational.h>
 
+#include "V2P/writer/WriterConfig.h"
+#include "V2P/stream/FramePool.h"
+#include "V2P/stream/PacketQueue.h"
+#include "V2P/utils/SpscRingBuffer.h"
+
 // Forward-declare FFmpeg types
 struct AVFrame;
 struct AVFormatContext;
 struct AVCodecContext;
+struct AVPacket;
 struct SwsContext;
 
 class VideoWriter {
@@ -15,6 +24,11 @@ public:
     VideoWriter();
     ~VideoWriter();
 
+    /**
+    * @brief Sets how the writer encodes. Call before open().
+    */
+    void setConfig(WriterConfig config) { this->config = std::move(config); }
+
     /**
     * @brief Opens and prepares a video file for writing.
     * @param filename The output filename (e.g., "output.mp4").
@@ -28,24 +42,73 @@ public:
 
     /**
     * @brief Encodes and writes a single frame to the video file.
+    * In async mode the frame is only referenced and queued; a frame dropped
+    * under WriterOverflow::DROP still counts as success (see getStats()).
+    * The queued frame shares the caller's pixel buffers, so a caller that
+    * refills the same AVFrame must call av_frame_make_writable() on it
+    * first (or give it a new buffer); writing into a shared buffer changes
+    * frames that are still waiting. Call from one thread at a time.
     * @param frame The AVFrame to write. The frame's pixel format must match
     * the input_pix_fmt provided in open().
-    * @return True on success, false on failure.
+    * @return True on success, false on failure (in async mode, also once a
+    * background stage has failed).
     */
     bool writeFrame(AVFrame* frame);
 
     /**
     * @brief Finalizes the video file, flushing any buffered frames.
+    * In async mode this waits for the queued frames to be written.
     * @return True on success, false on failure.
     */
     bool close();
 
+    WriterStats getStats() const;
+
 private:
+    struct FrameDeleter {
+        void operator()(AVFrame* frame) const;
+    };
+    using FramePtr = std::unique_ptr<AVFrame, FrameDeleter>;
+
     bool encode(const AVFrame* frame);
+    bool writePacket(AVPacket* packet);
+
+    // Async pipeline: writeFrame() -> inputFrames -> convertLoop()
+    // -> convertedFrames -> encodeLoop() -> packets -> muxLoop()
+    void startPipeline();
+    void stopPipeline();
+    void convertLoop();
+    void encodeLoop();
+    void muxLoop();
 
+    WriterConfig config;
     AVFormatContext* formatContext;
     AVCodecContext* codecContext;
     SwsContext* swsContext;
     AVFrame* tmpFrame; // Used for pixel format conversion
     int64_t nextPts;
+    bool headerWritten;
+
+    static constexpr size_t CONVERTED_QUEUE_SIZE = 4;
+    static constexpr size_t PACKET_QUEUE_SIZE = 64;
+
+    std::unique_ptr<SpscRingBuffer<FramePtr>> inputFrames;
+    std::unique_ptr<SpscRingBuffer<FramePtr>> convertedFrames;
+    PacketQueue packets{PACKET_QUEUE_SIZE};
+    FramePool convertPool; // Recycles conversion buffers once the encoder lets go of them
+    std::thread convertThread;
+    std::thread encodeThread;
+    std::thread muxThread;
+    std::atomic<bool> failed;
+
+    std::atomic<uint64_t> framesQueued;
+    std::atomic<uint64_t> framesDropped;
+    std::atomic<uint64_t> framesEncoded;
+    std::atomic<uint64_t> packetsWritten;
+    std::atomic<size_t> maxQueueDepth;
+    std::atomic<int64_t> convertNs;
+    std::atomic<int64_t> encodeNs;
+    std::atomic<int64_t> muxNs;
+    std::atomic<int64_t> firstEncodeNs; // When the first frame was encoded; 0 before
+    std::atomic<int64_t> lastEncodeNs;
 };
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief What writeFrame() does when the async queue is full.
+ */
+enum class WriterOverflow {
+    BLOCK,  // Wait for the encoder; nothing is lost, the caller is held up
+    DROP    // Drop the new frame; the caller never waits
+};
+
+/**
+ * @brief How a VideoWriter encodes. Call VideoWriter::setConfig() before open().
+ */
+struct WriterConfig {
+    // Convert, encode and mux on background threads; writeFrame() then only
+    // queues a reference to the frame and returns
+    bool async = false;
+    size_t queueFrames = 8; // Frames waiting for conversion in async mode
+    WriterOverflow overflow = WriterOverflow::BLOCK;
+
+    // libx264 settings
+    std::string preset = "slow";
+    int64_t bitRate = 400000;
+    int encoderThreads = 0; // 0 lets the encoder decide
+};
+
+/**
+ * @brief Counters of a VideoWriter.
+ */
+struct WriterStats {
+    uint64_t framesQueued = 0;   // Accepted by writeFrame()
+    uint64_t framesDropped = 0;  // Refused by a full queue under WriterOverflow::DROP
+    uint64_t framesEncoded = 0;  // Handed to the encoder
+    uint64_t packetsWritten = 0;
+    size_t queueDepth = 0;       // Frames waiting for conversion right now
+    size_t maxQueueDepth = 0;
+    size_t packetQueueDepth = 0; // Encoded packets waiting for the muxer
+
+    double totalConvertMs = 0.0;
+    double totalEncodeMs = 0.0;  // Time spent in send_frame/receive_packet
+    double totalMuxMs = 0.0;
+    double encodeFps = 0.0;      // Frames encoded per second since the first one
+};